@@ -29,6 +29,7 @@
 #include "fty_sensor_gpio.h"
 #include "fty_sensor_gpio_server.h"
 #include "fty_sensor_gpio_assets.h"
+#include "fty_sensor_gpio_alerts.h"
 #include <fty_proto.h>
 #include <fty_log.h>
 
@@ -43,8 +44,6 @@
 // * cleanup, final cppcheck, fix all FIXMEs...
 // To be discussed:
 // * Check for convergence with other dry-contacts (on EMP001 and fty-sensor-env, EMP002,
-// * Add 'int last_state' to '_gpx_info_t' and only publish state change?
-//   (i.e. last_state != current_state)
 // * i18n for alerts and $status
 
 void
@@ -57,16 +56,6 @@ usage(){
 
 }
 
-// Send an update request over the MQ to check for GPIO status
-static int
-s_update_event (zloop_t *loop, int timer_id, void *output)
-{
-    // Please the compiler
-    if (loop && timer_id)
-        zstr_send (output, "UPDATE");
-    return 0;
-}
-
 // Schedule HW_CAP request to do the initial configuration for local GPI/GPO
 static int
 s_request_hwcap_event (zloop_t *loop, int timer_id, void *output)
@@ -102,6 +91,28 @@ int main (int argc, char *argv [])
     char* endpoint = NULL;
     const char* str_poll_interval = NULL;
     int poll_interval = DEFAULT_POLL_INTERVAL;
+    const char* persistent_pins = "true";
+    const char* batched_io = "false";
+    const char* backend = "sysfs";
+    const char* sim_gpi_count = "10";
+    const char* sim_gpo_count = "5";
+    const char* gpio_chip = "/dev/gpiochip0";
+    const char* edge_triggered = "false";
+    int sweep_interval = DEFAULT_SWEEP_INTERVAL;
+    const char* metric_ttl = NULL;
+    const char* publish_mode = "single";
+    const char* adaptive_polling = "false";
+    const char* adaptive_fast_interval = "100";
+    const char* adaptive_fast_window = "10000";
+    const char* adaptive_max_interval = "5000";
+    const char* sampler_interval = "0";
+    const char* sampler_depth = "256";
+    const char* alerts_enabled = "false";
+    const char* alert_ttl = "900";
+    const char* storm_threshold = "4";
+    const char* storm_window = "1000";
+    const char* storm_rate = "1";
+    const char* storm_burst = "4";
     bool verbose = false;
     int argn;
     char *log_config = NULL;
@@ -158,6 +169,35 @@ int main (int argc, char *argv [])
             poll_interval = atoi(str_poll_interval);
         }
         log_debug ("Polling interval set to %i", poll_interval);
+        // Keep pins exported with their value fd opened between accesses
+        persistent_pins = s_get (config, "hardware/persistent_pins", "true");
+        // Read and write the sysfs pins of a cycle at once, through io_uring
+        batched_io = s_get (config, "hardware/batched_io", "false");
+        // GPIO access backend, the simulated one being sized from the config
+        backend = s_get (config, "hardware/backend", "sysfs");
+        sim_gpi_count = s_get (config, "hardware/gpi_count", "10");
+        sim_gpo_count = s_get (config, "hardware/gpo_count", "5");
+        gpio_chip = s_get (config, "hardware/gpio_chip", "/dev/gpiochip0");
+        // Event driven GPI monitoring, with a slow safety sweep
+        edge_triggered = s_get (config, "server/edge_triggered", "false");
+        sweep_interval = atoi (s_get (config, "server/sweep_interval", "60000"));
+        // Metrics are published on change, and refreshed before they expire
+        metric_ttl = s_get (config, "server/metric_ttl", NULL);
+        // Statuses published one by one, and/or in one batch per cycle
+        publish_mode = s_get (config, "server/publish_mode", "single");
+        // GPIs polled fast after a change, and less and less often while stable
+        adaptive_polling = s_get (config, "server/adaptive_polling", "false");
+        adaptive_fast_interval = s_get (config, "server/adaptive_fast_interval", adaptive_fast_interval);
+        adaptive_fast_window = s_get (config, "server/adaptive_fast_window", adaptive_fast_window);
+        adaptive_max_interval = s_get (config, "server/adaptive_max_interval", adaptive_max_interval);
+        sampler_interval = s_get (config, "server/sampler_interval", sampler_interval);
+        sampler_depth = s_get (config, "server/sampler_depth", sampler_depth);
+        alerts_enabled = s_get (config, "server/alerts", alerts_enabled);
+        alert_ttl = s_get (config, "server/alert_ttl", alert_ttl);
+        storm_threshold = s_get (config, "server/storm_threshold", storm_threshold);
+        storm_window = s_get (config, "server/storm_window", storm_window);
+        storm_rate = s_get (config, "server/storm_rate", storm_rate);
+        storm_burst = s_get (config, "server/storm_burst", storm_burst);
         if (endpoint) zstr_free(&endpoint);
         endpoint = strdup(s_get (config, "malamute/endpoint", NULL));
         actor_name = strdup(s_get (config, "malamute/address", NULL));
@@ -223,6 +263,21 @@ int main (int argc, char *argv [])
     zstr_sendx (server, "CONNECT", endpoint, NULL);
     zstr_sendx (server, "PRODUCER", FTY_PROTO_STREAM_METRICS_SENSOR, NULL);
     zstr_sendx (server, "TEMPLATE_DIR", template_dir, NULL);
+    if (streq (backend, "sim"))
+        zstr_sendx (server, "BACKEND", backend, sim_gpi_count, sim_gpo_count, NULL);
+    else if (streq (backend, "cdev"))
+        zstr_sendx (server, "BACKEND", backend, gpio_chip, NULL);
+    else
+        zstr_sendx (server, "BACKEND", backend, NULL);
+    zstr_sendx (server, "PERSISTENT_PINS", persistent_pins, NULL);
+    zstr_sendx (server, "BATCHED_IO", batched_io, NULL);
+    zstr_sendx (server, "EDGE_TRIGGERED", edge_triggered, NULL);
+    if (metric_ttl)
+        zstr_sendx (server, "METRIC_TTL", metric_ttl, NULL);
+    zstr_sendx (server, "PUBLISH_MODE", publish_mode, NULL);
+    zstr_sendx (server, "ADAPTIVE_POLLING", adaptive_polling, adaptive_fast_interval, adaptive_fast_window,
+        adaptive_max_interval, NULL);
+    zstr_sendx (server, "SAMPLER", sampler_interval, sampler_depth, NULL);
     //zstr_sendx (server, "HW_CAP", NULL);
     zstr_sendx (server, "STATEFILE", state_file, NULL);
 
@@ -230,18 +285,46 @@ int main (int argc, char *argv [])
     zstr_sendx (assets, "TEMPLATE_DIR", template_dir, NULL);
     zstr_sendx (assets, "CONNECT", endpoint, NULL);
 
+    // 3rd stream, optional, to raise the sensors alerts from their statuses,
+    // which have to be published on the stream for it
+    zactor_t *alerts = NULL;
+    if (streq (alerts_enabled, "true") && !strstr (publish_mode, "single") && !strstr (publish_mode, "batched")
+        && !strstr (publish_mode, "both")) {
+        log_error ("Alerts need the statuses published on the stream (publish_mode '%s'), not raising them",
+            publish_mode);
+        alerts_enabled = "false";
+    }
+    if (streq (alerts_enabled, "true")) {
+        alerts = zactor_new (fty_sensor_gpio_alerts, const_cast<char*>("gpio-alerts"));
+        zstr_sendx (alerts, "CONNECT", endpoint, NULL);
+        zstr_sendx (alerts, "PRODUCER", FTY_PROTO_STREAM_ALERTS_SYS, NULL);
+        zstr_sendx (alerts, "CONSUMER", FTY_PROTO_STREAM_METRICS_SENSOR, "status.*", NULL);
+        zstr_sendx (alerts, "ALERT_TTL", alert_ttl, NULL);
+        zstr_sendx (alerts, "STORM_CONTROL", storm_threshold, storm_window, storm_rate, storm_burst, NULL);
+    }
+
+    // In edge triggered mode, GPI changes are signaled to the server actor,
+    // so the periodic update is only a safety sweep
+    if (streq (edge_triggered, "true")) {
+        log_debug ("Edge triggered monitoring, sweep interval set to %i", sweep_interval);
+        poll_interval = sweep_interval;
+    }
+
+    // The server actor checks the GPI status every x milliseconds, on its own
+    // monotonic deadlines, so that slow cycles are skipped and not queued
+    zstr_sendx (server, "CHECK_INTERVAL", std::to_string (poll_interval).c_str (), NULL);
+
     // Setup:
-    // * an update event message every x microseconds, to check GPI status
     // * a request event message every 5 seconds, to request local HW capabilities
     // * asset actor production/consumption when server actor has received local HW capabilities
     zloop_t *gpio_events = zloop_new();
-    zloop_timer (gpio_events, size_t(poll_interval), 0, s_update_event, server);
     zloop_timer (gpio_events, 5000, 0, s_request_hwcap_event, server);
     zloop_timer (gpio_events, 2000, 0, s_server_ready_event, assets);
     zloop_start (gpio_events);
 
     // Cleanup
     zloop_destroy (&gpio_events);
+    zactor_destroy (&alerts);
     zactor_destroy (&server);
     zactor_destroy (&assets);
     zstr_free(&template_dir);
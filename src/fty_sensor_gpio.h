@@ -29,13 +29,27 @@
 #include <sstream>
 
 //  Add your own public definitions here, if you need them
-#define FTY_SENSOR_GPIO_AGENT  "fty-sensor-gpio"
-#define DEFAULT_POLL_INTERVAL  2000
-#define DEFAULT_STATEFILE_PATH "/var/lib/fty/fty-sensor-gpio/state"
-#define DEFAULT_LOG_CONFIG     "/etc/fty/ftylog.cfg"
+#define FTY_SENSOR_GPIO_AGENT          "fty-sensor-gpio"
+#define DEFAULT_POLL_INTERVAL          2000
+#define DEFAULT_SWEEP_INTERVAL         60000
+#define DEFAULT_METRIC_TTL             300
+#define DEFAULT_WARM_UP_TIME           1000
+#define POLL_WHEEL_TICK                10
+#define DEFAULT_ADAPTIVE_FAST_INTERVAL 100
+#define DEFAULT_ADAPTIVE_FAST_WINDOW   10000
+#define DEFAULT_ADAPTIVE_MAX_INTERVAL  5000
+#define DEFAULT_SAMPLER_DEPTH          256
+#define DEFAULT_ALERT_TTL              900
+#define DEFAULT_STORM_THRESHOLD        4
+#define DEFAULT_STORM_WINDOW           1000
+#define DEFAULT_STORM_RATE             1
+#define DEFAULT_STORM_BURST            4
+#define BATCH_SUBJECT                  "status-batch"
+#define DEFAULT_STATEFILE_PATH         "/var/lib/fty/fty-sensor-gpio/state"
+#define DEFAULT_LOG_CONFIG             "/etc/fty/ftylog.cfg"
 
 // TODO: get from config
-#define TIMEOUT_MS -1 // wait infinitely
+#define TIMEOUT_MS                     -1 // wait infinitely
 
 //  Structure to store information on a monitored GPI
 //  This includes both the template and configuration information
@@ -43,22 +57,28 @@
 // Structure of unitary monitored GPx
 struct gpx_info_t
 {
-    char* manufacturer;    // sensor manufacturer name
-    char* asset_name;      // sensor asset name
-    char* ext_name;        // sensor name
-    char* part_number;     // GPI sensor part number
-    char* type;            // GPI sensor type (door-contact, ...)
-    char* parent;          // Parent name, i.e. IPC, to which the GPIO is attached (parent_name.1)
-    char* location;        // Location, i.e. Room/Row/Rack/..., where the GPIO is deployed (logical_asset)
-    int   normal_state;    // opened | closed
-    int   current_state;   // opened | closed
-    int   gpx_number;      // GPIO number
-    int   pin_number;      // Pin number for this GPIO
-    int   gpx_direction;   // GPI(n) or GPO(ut)
-    char* power_source;    // empty for internal, GPO number for externally powered
-    char* alarm_message;   // Alert message to publish
-    char* alarm_severity;  // Applied severity
-    bool  alert_triggered; // flag to remember if an alert has been fired
+    char*   manufacturer;    // sensor manufacturer name
+    char*   asset_name;      // sensor asset name
+    char*   ext_name;        // sensor name
+    char*   part_number;     // GPI sensor part number
+    char*   type;            // GPI sensor type (door-contact, ...)
+    char*   parent;          // Parent name, i.e. IPC, to which the GPIO is attached (parent_name.1)
+    char*   location;        // Location, i.e. Room/Row/Rack/..., where the GPIO is deployed (logical_asset)
+    int     normal_state;    // opened | closed
+    int     current_state;   // opened | closed
+    int     gpx_number;      // GPIO number
+    int     pin_number;      // Pin number for this GPIO
+    int     gpx_direction;   // GPI(n) or GPO(ut)
+    char*   power_source;    // empty for internal, GPO number for externally powered
+    int     warm_up;         // time (ms) to have the sensor powered and running, once its power source is activated
+    int     poll_interval;   // poll period (ms) of the sensor, 0 to follow the agent check interval
+    char*   alarm_message;   // Alert message to publish
+    char*   alarm_severity;  // Applied severity
+    int     alarm_delay;     // time (ms) the sensor has to be abnormal before its alert is raised
+    int     clear_delay;     // time (ms) the sensor has to be back to normal before its alert is resolved
+    bool    alert_triggered; // flag to remember if an alert has been fired
+    int     published_state; // last published state, GPIO_STATE_UNKNOWN if never published
+    int64_t published_at;    // monotonic time (ms) of the last publication
 };
 
 // Config file accessors
@@ -69,6 +89,9 @@ const char* s_get(zconfig_t* config, const char* key, const char* dfl);
 extern zlistx_t*       _gpx_list;
 extern zlistx_t*       get_gpx_list();
 extern pthread_mutex_t gpx_list_mutex;
+// Sensors lookups, with gpx_list_mutex held
+extern gpx_info_t* get_gpx_info(const char* asset_name);
+extern gpx_info_t* get_gpx_info_by_name(const char* name);
 
 // Implemented in server actor
 extern bool hw_cap_inited;
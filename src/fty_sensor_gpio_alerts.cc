@@ -0,0 +1,825 @@
+/*  =========================================================================
+    fty_sensor_gpio_alerts - 42ITy GPIO alerts handler
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_sensor_gpio_alerts - 42ITy GPIO alerts handler
+@discuss
+    The actor consumes the status metrics of the GPI sensors, either single
+    or batched, and keeps the alert state of each sensor in memory. A sensor
+    whose status differs from its normal state has an active alert, which is
+    published on the FTY_PROTO_STREAM_ALERTS_SYS stream when it becomes
+    active, and again when it resolves. A steady alert is only published
+    again at half its TTL, from its own timer, so that it never expires,
+    however seldom its sensor status is published.
+
+    A change of a sensor with an alarm-delay (to raise its alert) or a
+    clear-delay (to resolve it) is only qualified once it lasted that delay,
+    so that chattering sensors don't raise and resolve alerts over and over.
+    The changes being qualified wait on a timer wheel, and are dropped if the
+    sensor gets back to its previous state in the meantime.
+
+    When more than storm-threshold sensors of a same parent (i.e. IPC)
+    change within storm-window, as on a power fault of the parent, a single
+    "gpio-storm@<parent>" alert is published for the parent. The alerts of
+    its sensors are then held, coalesced by sensor (only the latest state of
+    each is kept, and none is published if it ends where it started), and
+    released through a token bucket of storm-burst alerts, refilled at
+    storm-rate alerts per second. The refreshes of its active alerts wait
+    too. The storm resolves once its alerts are all released and its
+    changes are back under the threshold.
+
+    The alerts are made of the sensor template alarm-message (with "$status"
+    and "$device_name" replaced) and alarm-severity, with rule
+    "<type>.state-change@<asset name>" and subject
+    "<rule>/<severity>@<asset name>".
+
+    The actor is only started when alerts are enabled in the configuration,
+    since fty-alert-flexible rules raise the same alerts otherwise. It
+    answers GPIO_STATS mailbox requests with its counters, in the format of
+    the agent ones.
+@end
+*/
+
+#include "fty_sensor_gpio_alerts.h"
+#include "libgpio.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <fty_log.h>
+#include <fty_proto.h>
+#include <inttypes.h>
+#include <string>
+
+#define QUALIFY_WHEEL_TICK 10
+#define REFRESH_WHEEL_TICK 1000
+
+//  Alert to publish
+
+struct alert_message_t
+{
+    char*   subject; // alert subject
+    zmsg_t* message; // encoded fty_proto alert
+    bool    active;  // true if the alert is active
+};
+
+static void s_alert_message_destroy(void** self_ptr)
+{
+    alert_message_t* self = static_cast<alert_message_t*>(*self_ptr);
+    zstr_free(&self->subject);
+    zmsg_destroy(&self->message);
+    free(self);
+    *self_ptr = nullptr;
+}
+
+static void s_key_destroy(void** self_ptr)
+{
+    char* key = static_cast<char*>(*self_ptr);
+    zstr_free(&key);
+    *self_ptr = nullptr;
+}
+
+//  Alert state of a sensor
+
+struct alert_state_t
+{
+    bool             active;       // true if the alert of the sensor is active
+    bool             published;  // true if the last published alert of the sensor is active
+    alert_message_t* refresh;    // last published alert of the sensor, if active, to publish again
+    alert_message_t* pending;    // alert of the change being qualified, if any
+    char*            parent;     // parent of the sensor, if any
+    int64_t          counted_at; // monotonic time (ms) the sensor was last counted in the storm window
+};
+
+static void s_alert_state_destroy(void** self_ptr)
+{
+    alert_state_t* self = static_cast<alert_state_t*>(*self_ptr);
+    if (self->refresh)
+        s_alert_message_destroy(reinterpret_cast<void**>(&self->refresh));
+    if (self->pending)
+        s_alert_message_destroy(reinterpret_cast<void**>(&self->pending));
+    zstr_free(&self->parent);
+    free(self);
+    *self_ptr = nullptr;
+}
+
+//  Storm state of a parent
+
+struct storm_state_t
+{
+    std::deque<int64_t> changes;     // monotonic times (ms) the sensors changed, within the storm window
+    bool                active;      // true while the parent is in storm
+    double              tokens;      // held alerts which can be released at once
+    int64_t             refilled_at; // monotonic time (ms) the tokens were last refilled
+    zlistx_t*           held;        // asset names of the held alerts, oldest first
+    zhashx_t*           messages;    // held alerts, by asset name
+};
+
+static storm_state_t* s_storm_state_new()
+{
+    storm_state_t* self = new (std::nothrow) storm_state_t();
+    assert(self);
+    self->held = zlistx_new();
+    zlistx_set_destructor(self->held, s_key_destroy);
+    self->messages = zhashx_new();
+    return self;
+}
+
+static void s_storm_state_destroy(void** self_ptr)
+{
+    storm_state_t* self    = static_cast<storm_state_t*>(*self_ptr);
+    void*          message = zhashx_first(self->messages);
+    while (message) {
+        s_alert_message_destroy(&message);
+        message = zhashx_next(self->messages);
+    }
+    zhashx_destroy(&self->messages);
+    zlistx_destroy(&self->held);
+    delete self;
+    *self_ptr = nullptr;
+}
+
+//  --------------------------------------------------------------------------
+//  Create a new fty_sensor_gpio_alerts
+
+fty_sensor_gpio_alerts_t* fty_sensor_gpio_alerts_new(const char* name)
+{
+    fty_sensor_gpio_alerts_t* self = static_cast<fty_sensor_gpio_alerts_t*>(zmalloc(sizeof(fty_sensor_gpio_alerts_t)));
+    assert(self);
+
+    //  Initialize class properties
+    self->mlm    = mlm_client_new();
+    self->name   = strdup(name);
+    self->alerts = zhashx_new();
+    zhashx_set_destructor(self->alerts, s_alert_state_destroy);
+    self->qualifying = fty_sensor_gpio_wheel_new(QUALIFY_WHEEL_TICK);
+    self->refreshing = fty_sensor_gpio_wheel_new(REFRESH_WHEEL_TICK);
+    self->outbox     = zlistx_new();
+    zlistx_set_destructor(self->outbox, s_alert_message_destroy);
+    self->alert_ttl        = DEFAULT_ALERT_TTL;
+    self->evaluations      = 0;
+    self->alerts_raised    = 0;
+    self->alerts_resolved  = 0;
+    self->alerts_refreshed = 0;
+    self->changes_filtered = 0;
+    self->storms           = zhashx_new();
+    zhashx_set_destructor(self->storms, s_storm_state_destroy);
+    self->storm_threshold  = DEFAULT_STORM_THRESHOLD;
+    self->storm_window     = DEFAULT_STORM_WINDOW;
+    self->storm_rate       = DEFAULT_STORM_RATE;
+    self->storm_burst      = DEFAULT_STORM_BURST;
+    self->storms_detected  = 0;
+    self->alerts_deferred  = 0;
+    self->alerts_coalesced = 0;
+    self->alerts_metered   = 0;
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the fty_sensor_gpio_alerts
+
+void fty_sensor_gpio_alerts_destroy(fty_sensor_gpio_alerts_t** self_p)
+{
+    assert(self_p);
+    if (*self_p) {
+        fty_sensor_gpio_alerts_t* self = *self_p;
+
+        //  Free class properties
+        zstr_free(&self->name);
+        mlm_client_destroy(&self->mlm);
+        zhashx_destroy(&self->alerts);
+        fty_sensor_gpio_wheel_destroy(&self->qualifying);
+        fty_sensor_gpio_wheel_destroy(&self->refreshing);
+        zhashx_destroy(&self->storms);
+        zlistx_destroy(&self->outbox);
+        //  Free object itself
+        free(self);
+        *self_p = nullptr;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Build the alert description from the sensor alarm message
+
+static std::string s_alert_description(gpx_info_t* sensor, int state)
+{
+    std::string description = (sensor->alarm_message) ? sensor->alarm_message : "";
+    std::string status      = libgpio_get_status_name(state);
+    std::string device_name = (sensor->ext_name) ? sensor->ext_name : sensor->asset_name;
+
+    size_t position;
+    while ((position = description.find("$status")) != std::string::npos)
+        description.replace(position, 7, status);
+    while ((position = description.find("$device_name")) != std::string::npos)
+        description.replace(position, 12, device_name);
+    while ((position = description.find("$location")) != std::string::npos)
+        description.replace(position, 9, (sensor->location) ? sensor->location : "");
+    return description;
+}
+
+//  --------------------------------------------------------------------------
+//  Build the alert of a sensor, in the given alert state
+
+static alert_message_t* s_alert_new(
+    fty_sensor_gpio_alerts_t* self, gpx_info_t* sensor, int state, bool active, uint64_t time)
+{
+    const char* severity    = (sensor->alarm_severity && !streq(sensor->alarm_severity, ""))
+        ? sensor->alarm_severity : "WARNING";
+    char*       rule        = zsys_sprintf("%s.state-change@%s", (sensor->type) ? sensor->type : "sensorgpio",
+        sensor->asset_name);
+    std::string description = s_alert_description(sensor, state);
+    zlist_t*    actions     = zlist_new();
+
+    alert_message_t* alert = static_cast<alert_message_t*>(zmalloc(sizeof(alert_message_t)));
+    alert->subject         = zsys_sprintf("%s/%s@%s", rule, severity, sensor->asset_name);
+    alert->message = fty_proto_encode_alert(nullptr, time, uint32_t(self->alert_ttl), rule, sensor->asset_name,
+        (active) ? "ACTIVE" : "RESOLVED", severity, description.c_str(), actions);
+    alert->active = active;
+
+    zlist_destroy(&actions);
+    zstr_free(&rule);
+    return alert;
+}
+
+//  --------------------------------------------------------------------------
+//  Build the storm alert of a parent
+
+static alert_message_t* s_storm_alert_new(
+    fty_sensor_gpio_alerts_t* self, const char* parent, bool active, size_t changes)
+{
+    char*    rule        = zsys_sprintf("gpio-storm@%s", parent);
+    char*    description = (active)
+        ? zsys_sprintf("%zu GPIO sensors of %s changed within %i ms, their alerts are rate limited", changes,
+            parent, self->storm_window)
+        : zsys_sprintf("GPIO sensors of %s are steady again", parent);
+    zlist_t* actions     = zlist_new();
+
+    alert_message_t* alert = static_cast<alert_message_t*>(zmalloc(sizeof(alert_message_t)));
+    alert->subject         = zsys_sprintf("%s/WARNING@%s", rule, parent);
+    alert->message = fty_proto_encode_alert(nullptr, uint64_t(zclock_time() / 1000), uint32_t(self->alert_ttl), rule,
+        parent, (active) ? "ACTIVE" : "RESOLVED", "WARNING", description, actions);
+    alert->active  = active;
+
+    zlist_destroy(&actions);
+    zstr_free(&description);
+    zstr_free(&rule);
+    return alert;
+}
+
+//  --------------------------------------------------------------------------
+//  Build a copy of an alert, stamped with the current time
+
+static alert_message_t* s_alert_dup(alert_message_t* alert)
+{
+    zmsg_t*      message = zmsg_dup(alert->message);
+    fty_proto_t* proto   = fty_proto_decode(&message);
+    fty_proto_set_time(proto, uint64_t(zclock_time() / 1000));
+
+    alert_message_t* copy = static_cast<alert_message_t*>(zmalloc(sizeof(alert_message_t)));
+    copy->subject         = strdup(alert->subject);
+    copy->message         = fty_proto_encode(&proto);
+    copy->active          = alert->active;
+    return copy;
+}
+
+//  --------------------------------------------------------------------------
+//  Queue the alert of a sensor for publication. An active alert is published
+//  again at half its TTL, from its own timer, so that it never expires while
+//  it lasts, whether statuses are published in the meantime or not
+
+static void s_publish(fty_sensor_gpio_alerts_t* self, const char* asset_name, alert_state_t* alert,
+    alert_message_t* message, int64_t now)
+{
+    alert->published = message->active;
+    if (alert->refresh)
+        s_alert_message_destroy(reinterpret_cast<void**>(&alert->refresh));
+    if (message->active) {
+        alert->refresh = s_alert_dup(message);
+        fty_sensor_gpio_wheel_schedule(self->refreshing, asset_name, now + int64_t(self->alert_ttl) * 1000 / 2);
+    } else {
+        fty_sensor_gpio_wheel_cancel(self->refreshing, asset_name);
+    }
+    zlistx_add_end(self->outbox, message);
+}
+
+//  --------------------------------------------------------------------------
+//  Drop the changes which left the storm window
+
+static void s_storm_prune(fty_sensor_gpio_alerts_t* self, storm_state_t* storm, int64_t now)
+{
+    while (!storm->changes.empty() && (now - storm->changes.front() >= self->storm_window))
+        storm->changes.pop_front();
+}
+
+//  --------------------------------------------------------------------------
+//  Count the change of a sensor in the storm window of its parent, and start
+//  a storm once more than storm_threshold sensors changed within it. Return
+//  the storm state of the parent, or nullptr if storms are not controlled
+
+static storm_state_t* s_storm_track(fty_sensor_gpio_alerts_t* self, alert_state_t* alert, int64_t now)
+{
+    if ((self->storm_threshold <= 0) || !alert->parent)
+        return nullptr;
+
+    storm_state_t* storm = static_cast<storm_state_t*>(zhashx_lookup(self->storms, alert->parent));
+    if (!storm) {
+        storm = s_storm_state_new();
+        zhashx_insert(self->storms, alert->parent, storm);
+    }
+    // A sensor is counted once per window, however often it changes
+    s_storm_prune(self, storm, now);
+    if (now - alert->counted_at >= self->storm_window) {
+        alert->counted_at = now;
+        storm->changes.push_back(now);
+    }
+    if (!storm->active && (storm->changes.size() > size_t(self->storm_threshold))) {
+        log_warning("%s: storm of %zu changes on %s, rate limiting its alerts", self->name, storm->changes.size(),
+            alert->parent);
+        storm->active      = true;
+        storm->tokens      = self->storm_burst;
+        storm->refilled_at = now;
+        self->storms_detected++;
+        zlistx_add_end(self->outbox, s_storm_alert_new(self, alert->parent, true, storm->changes.size()));
+    }
+    return storm;
+}
+
+//  --------------------------------------------------------------------------
+//  Release the held alerts of a parent in storm, as its tokens allow, and
+//  resolve the storm once they are all released and its changes are back
+//  under the threshold
+
+static void s_storm_release(fty_sensor_gpio_alerts_t* self, const char* parent, storm_state_t* storm, int64_t now)
+{
+    storm->tokens      = std::min(double(self->storm_burst),
+        storm->tokens + double(now - storm->refilled_at) * std::max(self->storm_rate, 1) / 1000);
+    storm->refilled_at = now;
+    while ((storm->tokens >= 1) && (zlistx_size(storm->held) > 0)) {
+        char*            asset_name = static_cast<char*>(zlistx_detach(storm->held, nullptr));
+        alert_message_t* message    = static_cast<alert_message_t*>(zhashx_lookup(storm->messages, asset_name));
+        alert_state_t*   alert      = static_cast<alert_state_t*>(zhashx_lookup(self->alerts, asset_name));
+        zhashx_delete(storm->messages, asset_name);
+        // A held alert which ends where the published one was changes nothing
+        if (alert && (message->active != alert->published)) {
+            s_publish(self, asset_name, alert, message, now);
+            storm->tokens -= 1;
+            self->alerts_metered++;
+        } else {
+            s_alert_message_destroy(reinterpret_cast<void**>(&message));
+            self->alerts_coalesced++;
+        }
+        zstr_free(&asset_name);
+    }
+
+    s_storm_prune(self, storm, now);
+    if ((zlistx_size(storm->held) == 0) && (storm->changes.size() <= size_t(self->storm_threshold))) {
+        log_info("%s: storm on %s resolved", self->name, parent);
+        storm->active = false;
+        zlistx_add_end(self->outbox, s_storm_alert_new(self, parent, false, storm->changes.size()));
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Queue the alert of a sensor, or hold it while its parent is in storm
+
+static void s_dispatch(fty_sensor_gpio_alerts_t* self, const char* asset_name, alert_state_t* alert,
+    alert_message_t* message, int64_t now)
+{
+    storm_state_t* storm = s_storm_track(self, alert, now);
+    if (!storm || !storm->active) {
+        s_publish(self, asset_name, alert, message, now);
+        return;
+    }
+    // Only the latest alert of a sensor is kept
+    alert_message_t* held = static_cast<alert_message_t*>(zhashx_lookup(storm->messages, asset_name));
+    if (held) {
+        s_alert_message_destroy(reinterpret_cast<void**>(&held));
+        zhashx_update(storm->messages, asset_name, message);
+        self->alerts_coalesced++;
+    } else {
+        zhashx_insert(storm->messages, asset_name, message);
+        zlistx_add_end(storm->held, strdup(asset_name));
+        self->alerts_deferred++;
+    }
+    s_storm_release(self, alert->parent, storm, now);
+}
+
+//  --------------------------------------------------------------------------
+//  Switch the alert state of a sensor, and queue its alert
+
+static void s_qualify(fty_sensor_gpio_alerts_t* self, const char* asset_name, alert_state_t* alert,
+    alert_message_t* message, int64_t now)
+{
+    alert->active = !alert->active;
+    if (alert->active)
+        self->alerts_raised++;
+    else
+        self->alerts_resolved++;
+    s_dispatch(self, asset_name, alert, message, now);
+}
+
+//  --------------------------------------------------------------------------
+//  Evaluate the state of a GPI sensor against its normal state
+
+int fty_sensor_gpio_alerts_evaluate(
+    fty_sensor_gpio_alerts_t* self, gpx_info_t* sensor, int state, uint64_t time, int64_t now)
+{
+    assert(self);
+    assert(sensor);
+    self->evaluations++;
+
+    // Only GPI sensors with a known normal state raise alerts
+    if ((sensor->gpx_direction != GPIO_DIRECTION_IN) || (sensor->normal_state == GPIO_STATE_UNKNOWN) ||
+        (state == GPIO_STATE_UNKNOWN))
+        return 0;
+
+    alert_state_t* alert = static_cast<alert_state_t*>(zhashx_lookup(self->alerts, sensor->asset_name));
+    if (!alert) {
+        alert             = static_cast<alert_state_t*>(zmalloc(sizeof(alert_state_t)));
+        alert->counted_at = now - self->storm_window;
+        zhashx_insert(self->alerts, sensor->asset_name, alert);
+    }
+    // The sensor may have been moved to another parent
+    const char* parent = (sensor->parent && !streq(sensor->parent, "")) ? sensor->parent : nullptr;
+    if (((parent == nullptr) != (alert->parent == nullptr)) || (parent && !streq(parent, alert->parent))) {
+        zstr_free(&alert->parent);
+        alert->parent = (parent) ? strdup(parent) : nullptr;
+    }
+
+    size_t queued   = zlistx_size(self->outbox);
+    bool   abnormal = (state != sensor->normal_state);
+    if (abnormal == alert->active) {
+        // Back to the previous state before the change lasted its delay
+        if (alert->pending) {
+            fty_sensor_gpio_wheel_cancel(self->qualifying, sensor->asset_name);
+            s_alert_message_destroy(reinterpret_cast<void**>(&alert->pending));
+            self->changes_filtered++;
+        }
+    } else if (!alert->pending) {
+        // The change is qualified at once, or once it lasted its delay
+        alert_message_t* message = s_alert_new(self, sensor, state, abnormal, time);
+        int              delay   = (abnormal) ? sensor->alarm_delay : sensor->clear_delay;
+        if (delay > 0) {
+            alert->pending = message;
+            fty_sensor_gpio_wheel_schedule(self->qualifying, sensor->asset_name, now + delay);
+        } else {
+            s_qualify(self, sensor->asset_name, alert, message, now);
+        }
+    }
+    // Qualified changes are reported at the next evaluation
+    sensor->alert_triggered = alert->active;
+    return int(zlistx_size(self->outbox) - queued);
+}
+
+//  --------------------------------------------------------------------------
+//  Qualify the changes which lasted their delay
+
+size_t fty_sensor_gpio_alerts_expire(fty_sensor_gpio_alerts_t* self, int64_t now)
+{
+    assert(self);
+    zlistx_t* expired = zlistx_new();
+    zlistx_set_destructor(expired, s_key_destroy);
+    fty_sensor_gpio_wheel_expire(self->qualifying, now, expired);
+
+    size_t queued     = zlistx_size(self->outbox);
+    char*  asset_name = static_cast<char*>(zlistx_first(expired));
+    while (asset_name) {
+        alert_state_t* alert = static_cast<alert_state_t*>(zhashx_lookup(self->alerts, asset_name));
+        if (alert && alert->pending) {
+            alert_message_t* message = alert->pending;
+            alert->pending           = nullptr;
+            s_qualify(self, asset_name, alert, message, now);
+        }
+        asset_name = static_cast<char*>(zlistx_next(expired));
+    }
+
+    // Publish the steady active alerts again, at half their TTL, but the ones
+    // of a parent in storm, which are retried once its changes left the window
+    zlistx_purge(expired);
+    fty_sensor_gpio_wheel_expire(self->refreshing, now, expired);
+    asset_name = static_cast<char*>(zlistx_first(expired));
+    while (asset_name) {
+        alert_state_t* alert = static_cast<alert_state_t*>(zhashx_lookup(self->alerts, asset_name));
+        storm_state_t* storm = nullptr;
+        if (alert && alert->parent)
+            storm = static_cast<storm_state_t*>(zhashx_lookup(self->storms, alert->parent));
+        if (alert && alert->refresh && storm && storm->active) {
+            fty_sensor_gpio_wheel_schedule(self->refreshing, asset_name, now + self->storm_window);
+        } else if (alert && alert->refresh) {
+            s_publish(self, asset_name, alert, s_alert_dup(alert->refresh), now);
+            self->alerts_refreshed++;
+        }
+        asset_name = static_cast<char*>(zlistx_next(expired));
+    }
+    zlistx_destroy(&expired);
+
+    // Release the held alerts of the parents in storm
+    storm_state_t* storm = static_cast<storm_state_t*>(zhashx_first(self->storms));
+    while (storm) {
+        if (storm->active)
+            s_storm_release(self, static_cast<const char*>(zhashx_cursor(self->storms)), storm, now);
+        storm = static_cast<storm_state_t*>(zhashx_next(self->storms));
+    }
+    return zlistx_size(self->outbox) - queued;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the monotonic deadline of the next change to qualify, of the next
+//  active alert to refresh, or of the next held alert to release
+
+int64_t fty_sensor_gpio_alerts_next_deadline(fty_sensor_gpio_alerts_t* self)
+{
+    assert(self);
+    int64_t deadline = fty_sensor_gpio_wheel_next_deadline(self->qualifying);
+    int64_t refresh  = fty_sensor_gpio_wheel_next_deadline(self->refreshing);
+    if ((deadline == -1) || ((refresh != -1) && (refresh < deadline)))
+        deadline = refresh;
+    storm_state_t* storm = static_cast<storm_state_t*>(zhashx_first(self->storms));
+    while (storm) {
+        if (storm->active) {
+            // Next token, or end of the storm once its changes left the window
+            int64_t release;
+            if (zlistx_size(storm->held) > 0)
+                release = storm->refilled_at +
+                    int64_t(std::ceil((1 - storm->tokens) * 1000 / std::max(self->storm_rate, 1)));
+            else
+                release = (storm->changes.empty()) ? storm->refilled_at
+                                                   : storm->changes.front() + self->storm_window;
+            if ((deadline == -1) || (release < deadline))
+                deadline = release;
+        }
+        storm = static_cast<storm_state_t*>(zhashx_next(self->storms));
+    }
+    return deadline;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of parents in storm
+
+size_t fty_sensor_gpio_alerts_storms(fty_sensor_gpio_alerts_t* self)
+{
+    assert(self);
+    size_t         count = 0;
+    storm_state_t* storm = static_cast<storm_state_t*>(zhashx_first(self->storms));
+    while (storm) {
+        if (storm->active)
+            count++;
+        storm = static_cast<storm_state_t*>(zhashx_next(self->storms));
+    }
+    return count;
+}
+
+//  --------------------------------------------------------------------------
+//  Forget the alert state of a sensor no longer monitored
+
+void fty_sensor_gpio_alerts_forget(fty_sensor_gpio_alerts_t* self, const char* asset_name)
+{
+    assert(self);
+    fty_sensor_gpio_wheel_cancel(self->qualifying, asset_name);
+    fty_sensor_gpio_wheel_cancel(self->refreshing, asset_name);
+    zhashx_delete(self->alerts, asset_name);
+}
+
+//  --------------------------------------------------------------------------
+//  Pop the oldest queued alert
+
+zmsg_t* fty_sensor_gpio_alerts_pop(fty_sensor_gpio_alerts_t* self, char** subject_p)
+{
+    assert(self);
+    assert(subject_p);
+    alert_message_t* alert = static_cast<alert_message_t*>(zlistx_detach(self->outbox, nullptr));
+    if (!alert)
+        return nullptr;
+    zmsg_t* message = alert->message;
+    *subject_p      = alert->subject;
+    free(alert);
+    return message;
+}
+
+//  --------------------------------------------------------------------------
+//  Evaluate a status metric against the monitored sensor it was published
+//  for, identified by its sname
+
+static void s_handle_metric(fty_sensor_gpio_alerts_t* self, fty_proto_t* metric)
+{
+    const char* asset_name = fty_proto_aux_string(metric, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, nullptr);
+    if (!asset_name || (strncmp(fty_proto_type(metric), "status.", 7) != 0))
+        return;
+    int state = libgpio_get_status_value(fty_proto_value(metric));
+
+    pthread_mutex_lock(&gpx_list_mutex);
+    gpx_info_t* gpx_info = get_gpx_info(asset_name);
+    if (gpx_info)
+        fty_sensor_gpio_alerts_evaluate(self, gpx_info, state, fty_proto_time(metric), zclock_mono());
+    pthread_mutex_unlock(&gpx_list_mutex);
+
+    if (!gpx_info)
+        fty_sensor_gpio_alerts_forget(self, asset_name);
+}
+
+//  --------------------------------------------------------------------------
+//  Publish the queued alerts
+
+static void s_publish_alerts(fty_sensor_gpio_alerts_t* self)
+{
+    char*   subject = nullptr;
+    zmsg_t* message = fty_sensor_gpio_alerts_pop(self, &subject);
+    while (message) {
+        log_debug("%s: publishing alert %s", self->name, subject);
+        if (mlm_client_send(self->mlm, subject, &message) != 0)
+            log_error("%s:\tFailed to publish alert %s", self->name, subject);
+        zmsg_destroy(&message);
+        zstr_free(&subject);
+        message = fty_sensor_gpio_alerts_pop(self, &subject);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Add a counter to a GPIO_STATS reply, as a name/value pair
+
+static void s_add_stat(zmsg_t* reply, const char* name, uint64_t value)
+{
+    zmsg_addstr(reply, name);
+    zmsg_addstrf(reply, "%" PRIu64, value);
+}
+
+//  --------------------------------------------------------------------------
+//  Answer a GPIO_STATS request with the alerts counters
+
+static void s_handle_stats(fty_sensor_gpio_alerts_t* self, zmsg_t* message)
+{
+    zmsg_t* reply = zmsg_new();
+    char*   zuuid = zmsg_popstr(message);
+    zmsg_addstr(reply, zuuid ? zuuid : "");
+    zmsg_addstr(reply, "OK");
+    s_add_stat(reply, "evaluations", self->evaluations);
+    s_add_stat(reply, "alerts_raised", self->alerts_raised);
+    s_add_stat(reply, "alerts_resolved", self->alerts_resolved);
+    s_add_stat(reply, "alerts_refreshed", self->alerts_refreshed);
+    s_add_stat(reply, "changes_filtered", self->changes_filtered);
+    s_add_stat(reply, "storms_detected", self->storms_detected);
+    s_add_stat(reply, "storms_active", uint64_t(fty_sensor_gpio_alerts_storms(self)));
+    s_add_stat(reply, "alerts_deferred", self->alerts_deferred);
+    s_add_stat(reply, "alerts_coalesced", self->alerts_coalesced);
+    s_add_stat(reply, "alerts_metered", self->alerts_metered);
+    if (mlm_client_sendto(self->mlm, mlm_client_sender(self->mlm), "GPIO_STATS", nullptr, 5000, &reply) != 0)
+        log_error("%s:\tmlm_client_sendto failed", self->name);
+    zmsg_destroy(&reply);
+    zstr_free(&zuuid);
+}
+
+//  --------------------------------------------------------------------------
+//  Create fty_sensor_gpio_alerts actor
+
+void fty_sensor_gpio_alerts(zsock_t* pipe, void* args)
+{
+    char* name = static_cast<char*>(args);
+    if (!name) {
+        log_error("Adress for fty-sensor-gpio-alerts actor is NULL");
+        return;
+    }
+
+    fty_sensor_gpio_alerts_t* self = fty_sensor_gpio_alerts_new(name);
+    assert(self);
+
+    zpoller_t* poller = zpoller_new(pipe, mlm_client_msgpipe(self->mlm), NULL);
+    assert(poller);
+
+    zsock_signal(pipe, 0);
+    log_info("%s_alerts: Started", self->name);
+
+    while (!zsys_interrupted) {
+        // Wake up when the next change is qualified, or alert refreshed
+        int     timeout  = TIMEOUT_MS;
+        int64_t deadline = fty_sensor_gpio_alerts_next_deadline(self);
+        if (deadline != -1)
+            timeout = int(std::max(deadline - zclock_mono(), int64_t(0)));
+        void* which = zpoller_wait(poller, timeout);
+        if (which == NULL) {
+            if (zpoller_terminated(poller) || zsys_interrupted) {
+                break;
+            }
+        }
+        if (fty_sensor_gpio_alerts_expire(self, zclock_mono()) > 0)
+            s_publish_alerts(self);
+        if (which == pipe) {
+            zmsg_t* message = zmsg_recv(pipe);
+            char*   cmd     = zmsg_popstr(message);
+            if (cmd) {
+                log_debug("received command %s", cmd);
+                if (streq(cmd, "$TERM")) {
+                    zstr_free(&cmd);
+                    zmsg_destroy(&message);
+                    goto exit;
+                } else if (streq(cmd, "CONNECT")) {
+                    char* endpoint = zmsg_popstr(message);
+                    if (!endpoint)
+                        log_error("%s:\tMissing endpoint", self->name);
+                    assert(endpoint);
+                    int r = mlm_client_connect(self->mlm, endpoint, 5000, self->name);
+                    if (r == -1)
+                        log_error("%s:\tConnection to endpoint '%s' failed", self->name, endpoint);
+                    log_debug("CONNECT %s/%s", endpoint, self->name);
+                    zstr_free(&endpoint);
+                } else if (streq(cmd, "PRODUCER")) {
+                    char* stream = zmsg_popstr(message);
+                    assert(stream);
+                    mlm_client_set_producer(self->mlm, stream);
+                    log_debug("setting PRODUCER on %s", stream);
+                    zstr_free(&stream);
+                } else if (streq(cmd, "CONSUMER")) {
+                    char* stream  = zmsg_popstr(message);
+                    char* pattern = zmsg_popstr(message);
+                    assert(stream && pattern);
+                    mlm_client_set_consumer(self->mlm, stream, pattern);
+                    log_debug("setting CONSUMER on %s/%s", stream, pattern);
+                    zstr_free(&stream);
+                    zstr_free(&pattern);
+                } else if (streq(cmd, "ALERT_TTL")) {
+                    char* alert_ttl = zmsg_popstr(message);
+                    if (alert_ttl && (atoi(alert_ttl) > 0))
+                        self->alert_ttl = atoi(alert_ttl);
+                    else
+                        log_error("%s:\tInvalid alert TTL '%s'", self->name, alert_ttl ? alert_ttl : "");
+                    log_debug("ALERT_TTL=%i", self->alert_ttl);
+                    zstr_free(&alert_ttl);
+                } else if (streq(cmd, "STORM_CONTROL")) {
+                    // <threshold> <window> <rate> <burst>, threshold 0 to disable
+                    char* threshold = zmsg_popstr(message);
+                    char* window    = zmsg_popstr(message);
+                    char* rate      = zmsg_popstr(message);
+                    char* burst     = zmsg_popstr(message);
+                    if (threshold && window && rate && burst && (atoi(threshold) >= 0) && (atoi(window) > 0) &&
+                        (atoi(rate) > 0) && (atoi(burst) > 0)) {
+                        self->storm_threshold = atoi(threshold);
+                        self->storm_window    = atoi(window);
+                        self->storm_rate      = atoi(rate);
+                        self->storm_burst     = atoi(burst);
+                    } else {
+                        log_error("%s:\tInvalid storm control settings", self->name);
+                    }
+                    log_debug("STORM_CONTROL=%i/%i ms, %i/s, burst %i", self->storm_threshold, self->storm_window,
+                        self->storm_rate, self->storm_burst);
+                    zstr_free(&threshold);
+                    zstr_free(&window);
+                    zstr_free(&rate);
+                    zstr_free(&burst);
+                } else {
+                    log_warning("\tUnknown API command=%s, ignoring", cmd);
+                }
+                zstr_free(&cmd);
+            }
+            zmsg_destroy(&message);
+        } else if (which == mlm_client_msgpipe(self->mlm)) {
+            zmsg_t* message = mlm_client_recv(self->mlm);
+            if (streq(mlm_client_command(self->mlm), "MAILBOX DELIVER")) {
+                if (streq(mlm_client_subject(self->mlm), "GPIO_STATS"))
+                    s_handle_stats(self, message);
+                else
+                    log_warning("%s: Received unexpected subject '%s' from '%s'", self->name,
+                        mlm_client_subject(self->mlm), mlm_client_sender(self->mlm));
+            } else if (streq(mlm_client_command(self->mlm), "STREAM DELIVER") &&
+                streq(mlm_client_subject(self->mlm), BATCH_SUBJECT)) {
+                // Each frame of a batch is an encoded metric
+                zframe_t* frame = zmsg_pop(message);
+                while (frame) {
+                    zmsg_t* metric = zmsg_new();
+                    zmsg_append(metric, &frame);
+                    fty_proto_t* fmetric = fty_proto_decode(&metric);
+                    if (fmetric && (fty_proto_id(fmetric) == FTY_PROTO_METRIC))
+                        s_handle_metric(self, fmetric);
+                    fty_proto_destroy(&fmetric);
+                    frame = zmsg_pop(message);
+                }
+            } else if (fty_proto_is(message)) {
+                fty_proto_t* fmessage = fty_proto_decode(&message);
+                if (fty_proto_id(fmessage) == FTY_PROTO_METRIC)
+                    s_handle_metric(self, fmessage);
+                fty_proto_destroy(&fmessage);
+            }
+            zmsg_destroy(&message);
+            s_publish_alerts(self);
+        }
+    }
+exit:
+    zpoller_destroy(&poller);
+    fty_sensor_gpio_alerts_destroy(&self);
+}
@@ -20,7 +20,74 @@
 */
 
 #pragma once
+#include "fty_sensor_gpio.h"
+#include "fty_sensor_gpio_wheel.h"
 #include <czmq.h>
+#include <malamute.h>
+
+///  Structure of our class
+struct fty_sensor_gpio_alerts_t
+{
+    char*                    name;             // actor name
+    mlm_client_t*            mlm;              // malamute client
+    zhashx_t*                alerts;           // alert states of the sensors, by asset name
+    fty_sensor_gpio_wheel_t* qualifying;       // timers of the changes waiting for their delay, by asset name
+    fty_sensor_gpio_wheel_t* refreshing;       // timers of the active alerts to publish again, by asset name
+    zlistx_t*                outbox;           // alerts to publish, oldest first
+    int                      alert_ttl;        // TTL (s) of the published alerts
+    uint64_t                 evaluations;      // number of sensor states evaluated
+    uint64_t                 alerts_raised;    // number of alerts which became active
+    uint64_t                 alerts_resolved;  // number of alerts which got resolved
+    uint64_t                 alerts_refreshed; // number of active alerts published again, before their TTL expired
+    uint64_t                 changes_filtered; // number of changes which didn't last their delay
+    zhashx_t*                storms;           // storm states of the sensors parents, by parent name
+    int                      storm_threshold;  // sensors of a parent changing in storm_window to start a storm, 0 off
+    int                      storm_window;     // window (ms) the changes of a parent are counted over
+    int                      storm_rate;       // alerts per second published for a parent in storm
+    int                      storm_burst;      // alerts published at once for a parent in storm
+    uint64_t                 storms_detected;  // number of storms started
+    uint64_t                 alerts_deferred;  // number of alerts held back during a storm
+    uint64_t                 alerts_coalesced; // number of held alerts superseded, or no longer changing anything
+    uint64_t                 alerts_metered;   // number of held alerts published as the storm rate allowed
+};
 
 /// fty_sensor_gpio_alerts actor
 void fty_sensor_gpio_alerts(zsock_t* pipe, void* args);
+
+///  Create a new fty_sensor_gpio_alerts
+fty_sensor_gpio_alerts_t* fty_sensor_gpio_alerts_new(const char* name);
+
+///  Destroy the fty_sensor_gpio_alerts
+void fty_sensor_gpio_alerts_destroy(fty_sensor_gpio_alerts_t** self_p);
+
+///  Evaluate the state of a GPI sensor against its normal state, at time (s)
+///  and monotonic now (ms). An alert is queued only when the alert of the
+///  sensor becomes active or resolves, and an active alert is refreshed at
+///  half its TTL by fty_sensor_gpio_alerts_expire. A change with a delay (alarm_delay or clear_delay) is only
+///  qualified once it lasted it, by fty_sensor_gpio_alerts_expire. When more
+///  than storm_threshold sensors of a parent change within storm_window, a
+///  storm alert is queued for the parent, and the alerts of its sensors are
+///  held, coalesced by sensor, and released at storm_rate by
+///  fty_sensor_gpio_alerts_expire. Return the number of alerts queued
+int fty_sensor_gpio_alerts_evaluate(
+    fty_sensor_gpio_alerts_t* self, gpx_info_t* sensor, int state, uint64_t time, int64_t now);
+
+///  Qualify the changes which lasted their delay, up to monotonic now (ms),
+///  and queue their alerts, along with the active alerts due for a refresh
+///  and the held alerts the storm rates allow. Return the number of alerts
+///  queued
+size_t fty_sensor_gpio_alerts_expire(fty_sensor_gpio_alerts_t* self, int64_t now);
+
+///  Get the monotonic deadline (ms) of the next change to qualify, of the next
+///  active alert to refresh, or of the next held alert to release, or -1
+int64_t fty_sensor_gpio_alerts_next_deadline(fty_sensor_gpio_alerts_t* self);
+
+///  Get the number of parents in storm
+size_t fty_sensor_gpio_alerts_storms(fty_sensor_gpio_alerts_t* self);
+
+///  Forget the alert state of a sensor no longer monitored
+void fty_sensor_gpio_alerts_forget(fty_sensor_gpio_alerts_t* self, const char* asset_name);
+
+///  Pop the oldest queued alert, as an encoded fty_proto alert, and its
+///  subject, which the caller has to destroy. Return nullptr if none
+zmsg_t* fty_sensor_gpio_alerts_pop(fty_sensor_gpio_alerts_t* self, char** subject_p);
@@ -23,12 +23,17 @@
 
 #include "fty_sensor_gpio_assets.h"
 #include "fty_sensor_gpio.h"
+#include "fty_sensor_gpio_catalog.h"
 #include "libgpio.h"
 #include <fty_log.h>
 #include <fty_proto.h>
 
 // List of monitored GPx
 zlistx_t* _gpx_list = NULL;
+// Index of the monitored GPx list handles, by asset name
+static zhashx_t* _gpx_by_asset_name = NULL;
+// Index of the monitored GPx, by ext name (zlistx of GPx, oldest first, as ext names may be shared)
+static zhashx_t* _gpx_by_ext_name = NULL;
 // GPx list protection mutex
 pthread_mutex_t gpx_list_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -44,6 +49,76 @@ zlistx_t* get_gpx_list()
     return _gpx_list;
 }
 
+//  --------------------------------------------------------------------------
+//  Return the monitored sensor with this asset name, or NULL
+
+gpx_info_t* get_gpx_info(const char* asset_name)
+{
+    void* handle = (_gpx_by_asset_name) ? zhashx_lookup(_gpx_by_asset_name, asset_name) : NULL;
+    return (handle) ? static_cast<gpx_info_t*>(zlistx_handle_item(handle)) : NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Return the monitored sensor with this asset name, or else the oldest one
+//  with this ext name, or NULL
+
+gpx_info_t* get_gpx_info_by_name(const char* name)
+{
+    gpx_info_t* gpx_info = get_gpx_info(name);
+    if (!gpx_info && _gpx_by_ext_name) {
+        zlistx_t* sensors = static_cast<zlistx_t*>(zhashx_lookup(_gpx_by_ext_name, name));
+        if (sensors)
+            gpx_info = static_cast<gpx_info_t*>(zlistx_first(sensors));
+    }
+    return gpx_info;
+}
+
+//  --------------------------------------------------------------------------
+//  Index a sensor just added to the list, at handle
+
+static void s_index_sensor(gpx_info_t* gpx_info, void* handle)
+{
+    zhashx_insert(_gpx_by_asset_name, gpx_info->asset_name, handle);
+    if (gpx_info->ext_name && !streq(gpx_info->ext_name, "")) {
+        zlistx_t* sensors = static_cast<zlistx_t*>(zhashx_lookup(_gpx_by_ext_name, gpx_info->ext_name));
+        if (!sensors) {
+            sensors = zlistx_new();
+            zhashx_insert(_gpx_by_ext_name, gpx_info->ext_name, sensors);
+        }
+        zlistx_add_end(sensors, gpx_info);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Remove a sensor from the indexes, before deleting it from the list
+
+static void s_unindex_sensor(gpx_info_t* gpx_info)
+{
+    zhashx_delete(_gpx_by_asset_name, gpx_info->asset_name);
+    zlistx_t* sensors = (gpx_info->ext_name)
+        ? static_cast<zlistx_t*>(zhashx_lookup(_gpx_by_ext_name, gpx_info->ext_name)) : NULL;
+    if (sensors) {
+        void* item = zlistx_first(sensors);
+        while (item) {
+            if (item == gpx_info) {
+                zlistx_delete(sensors, zlistx_cursor(sensors));
+                break;
+            }
+            item = zlistx_next(sensors);
+        }
+        if (zlistx_size(sensors) == 0)
+            zhashx_delete(_gpx_by_ext_name, gpx_info->ext_name);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  zhashx handling -- destroy a list of the ext name index
+
+static void s_sensors_destroy(void** item)
+{
+    zlistx_destroy(reinterpret_cast<zlistx_t**>(item));
+}
+
 //  --------------------------------------------------------------------------
 //  zlist handling -- destroy an item
 
@@ -101,14 +176,11 @@ static void* sensor_dup(const void* item)
 
 static int sensor_cmp(const void* item1, const void* item2)
 {
-    gpx_info_t* gpx_info1 = const_cast<gpx_info_t*>(reinterpret_cast<const gpx_info_t*>(item1));
-    gpx_info_t* gpx_info2 = const_cast<gpx_info_t*>(reinterpret_cast<const gpx_info_t*>(item2));
+    const gpx_info_t* gpx_info1 = reinterpret_cast<const gpx_info_t*>(item1);
+    const gpx_info_t* gpx_info2 = reinterpret_cast<const gpx_info_t*>(item2);
 
-    // Compare on asset_name
-    if (streq(gpx_info1->asset_name, gpx_info2->asset_name))
-        return 0;
-    else
-        return 1;
+    // Order on asset_name
+    return strcmp(gpx_info1->asset_name, gpx_info2->asset_name);
 }
 
 //  --------------------------------------------------------------------------
@@ -135,9 +207,15 @@ static gpx_info_t* sensor_new()
     gpx_info->pin_number      = -1;
     gpx_info->gpx_direction   = GPIO_DIRECTION_IN; // Default to GPI
     gpx_info->power_source    = NULL;
+    gpx_info->warm_up         = DEFAULT_WARM_UP_TIME;
+    gpx_info->poll_interval   = 0;
     gpx_info->alarm_message   = NULL;
     gpx_info->alarm_severity  = NULL;
+    gpx_info->alarm_delay     = 0;
+    gpx_info->clear_delay     = 0;
     gpx_info->alert_triggered = false;
+    gpx_info->published_state = GPIO_STATE_UNKNOWN;
+    gpx_info->published_at    = 0;
 
     return gpx_info;
 }
@@ -152,7 +230,8 @@ int add_sensor(fty_sensor_gpio_assets_t* self, const char* operation, const char
     const char* extname, const char* asset_subtype, const char* sensor_type, const char* sensor_normal_state,
     const char* sensor_gpx_number, const char* sensor_gpx_direction, const char* sensor_parent,
     const char* sensor_location, const char* sensor_power_source, const char* sensor_alarm_message,
-    const char* sensor_alarm_severity)
+    const char* sensor_alarm_severity, const char* sensor_warm_up, const char* sensor_poll_interval,
+    const char* sensor_alarm_delay, const char* sensor_clear_delay)
 {
     int gpx_number = atoi(sensor_gpx_number);
     // FIXME: libgpio should be shared with -asset too
@@ -170,8 +249,7 @@ int add_sensor(fty_sensor_gpio_assets_t* self, const char* operation, const char
             }
         }
     }
-    gpx_info_t* prev_gpx_info = NULL;
-    gpx_info_t* gpx_info      = sensor_new();
+    gpx_info_t* gpx_info = sensor_new();
     if (!gpx_info) {
         log_error("Can't allocate gpx_info!");
         return 1;
@@ -205,21 +283,30 @@ int add_sensor(fty_sensor_gpio_assets_t* self, const char* operation, const char
     // it in the next status update loop...
     if (sensor_power_source)
         gpx_info->power_source = strdup(sensor_power_source);
+    if (sensor_warm_up && !streq(sensor_warm_up, ""))
+        gpx_info->warm_up = atoi(sensor_warm_up);
+    if (sensor_poll_interval && !streq(sensor_poll_interval, ""))
+        gpx_info->poll_interval = atoi(sensor_poll_interval);
     if (sensor_alarm_message)
         gpx_info->alarm_message = strdup(sensor_alarm_message);
     if (sensor_alarm_severity)
         gpx_info->alarm_severity = strdup(sensor_alarm_severity);
+    if (sensor_alarm_delay && !streq(sensor_alarm_delay, ""))
+        gpx_info->alarm_delay = atoi(sensor_alarm_delay);
+    if (sensor_clear_delay && !streq(sensor_clear_delay, ""))
+        gpx_info->clear_delay = atoi(sensor_clear_delay);
 
     pthread_mutex_lock(&gpx_list_mutex);
 
     // Check for an already existing entry for this asset
-    prev_gpx_info = static_cast<gpx_info_t*>(zlistx_find(_gpx_list, static_cast<void*>(gpx_info)));
+    void* prev_handle = zhashx_lookup(_gpx_by_asset_name, assetname);
 
-    if (prev_gpx_info != NULL) {
+    if (prev_handle != NULL) {
         // In case of update, we remove the previous entry, and create a new one
         if (streq(operation, "update")) {
             // FIXME: we may lose some data, check for merging entries prior to deleting
-            if (zlistx_delete(_gpx_list, static_cast<void*>(prev_gpx_info)) == -1) {
+            s_unindex_sensor(static_cast<gpx_info_t*>(zlistx_handle_item(prev_handle)));
+            if (zlistx_delete(_gpx_list, prev_handle) == -1) {
                 log_error("Update: error deleting the previous GPx record for '%s'!", assetname);
                 pthread_mutex_unlock(&gpx_list_mutex);
                 return -1;
@@ -227,10 +314,11 @@ int add_sensor(fty_sensor_gpio_assets_t* self, const char* operation, const char
         } else {
             log_debug("Sensor '%s' is already monitored. Skipping!", assetname);
             pthread_mutex_unlock(&gpx_list_mutex);
+            sensor_free(reinterpret_cast<void**>(&gpx_info));
             return 0;
         }
     }
-    zlistx_add_end(_gpx_list, static_cast<void*>(gpx_info));
+    s_index_sensor(gpx_info, zlistx_add_end(_gpx_list, static_cast<void*>(gpx_info)));
 
     pthread_mutex_unlock(&gpx_list_mutex);
 
@@ -250,66 +338,48 @@ int add_sensor(fty_sensor_gpio_assets_t* self, const char* operation, const char
 //  --------------------------------------------------------------------------
 //  Sensors handling
 //  Delete an entry from our zlist of monitored sensors
-static int delete_sensor(fty_sensor_gpio_assets_t* self, const char* assetname)
+//  Returns 1 if the sensor is not monitored, 0 otherwise
+int delete_sensor(fty_sensor_gpio_assets_t* self, const char* assetname)
 {
-    int retval = 0;
-
-    // We need to find out GPx direction
-    // And we cannot use gpx_info_result because it contains garbage on `gpx_direction` position
-    gpx_info_t* info = static_cast<gpx_info_t*>(zlistx_first(_gpx_list));
-    while (info != NULL) {
-        char* info_name = info->asset_name;
-        if (streq(info_name, assetname)) {
-            int direction = info->gpx_direction;
-            if (direction == GPIO_DIRECTION_OUT) {
-                zmsg_t* request = zmsg_new();
-                zmsg_addstr(request, assetname);
-                zmsg_addstr(request, "-1");
-                mlm_client_sendto(self->mlm, FTY_SENSOR_GPIO_AGENT, "GPOSTATE", NULL, 1000, &request);
-            }
-            break;
-        }
-        info = static_cast<gpx_info_t*>(zlistx_next(_gpx_list));
-    }
-
-    gpx_info_t* gpx_info_result = NULL;
-    gpx_info_t* gpx_info        = sensor_new();
-
-    if (gpx_info)
-        gpx_info->asset_name = strdup(assetname);
-    else {
-        log_error("Can't allocate gpx_info!");
-        return 1;
-    }
+    int  retval = 0;
+    bool is_gpo = false;
 
     pthread_mutex_lock(&gpx_list_mutex);
 
-    gpx_info_result = static_cast<gpx_info_t*>(zlistx_find(_gpx_list, static_cast<void*>(gpx_info)));
-    sensor_free(reinterpret_cast<void**>(&gpx_info));
-
-    if (gpx_info_result == NULL) {
+    void* handle = zhashx_lookup(_gpx_by_asset_name, assetname);
+    if (handle == NULL) {
         retval = 1;
     } else {
+        gpx_info_t* gpx_info = static_cast<gpx_info_t*>(zlistx_handle_item(handle));
+        is_gpo               = (gpx_info->gpx_direction == GPIO_DIRECTION_OUT);
         log_debug("Deleting '%s'", assetname);
-        // Delete from zlist
-        zlistx_delete(_gpx_list, gpx_info_result);
+        // Delete from the indexes, then from zlist
+        s_unindex_sensor(gpx_info);
+        zlistx_delete(_gpx_list, handle);
     }
     pthread_mutex_unlock(&gpx_list_mutex);
+
+    // Let -server forget the GPO state
+    if (is_gpo) {
+        zmsg_t* request = zmsg_new();
+        zmsg_addstr(request, assetname);
+        zmsg_addstr(request, "-1");
+        mlm_client_sendto(self->mlm, FTY_SENSOR_GPIO_AGENT, "GPOSTATE", NULL, 1000, &request);
+    }
     return retval;
 }
 
 //  --------------------------------------------------------------------------
 //  Check if this asset is a GPIO sensor by
 //  * Checking the provided subtype
-//  * Checking for the existence of a template file according to the asset part
-//    nb (provided in model)
-//    If one exists, it's a GPIO sensor, so return the template filename
-//    Otherwise, it's not a GPIO sensor, so return an empty std::string
+//  * Checking for a template in the catalog according to the asset part nb
+//    (provided in model)
+//    If one exists, it's a GPIO sensor, so return the template
+//    Otherwise, it's not a GPIO sensor, so return NULL
 
-static std::string is_asset_gpio_sensor(fty_sensor_gpio_assets_t* self, const std::string& asset_subtype, const std::string& asset_model)
+static const fty_sensor_gpio_template_t* is_asset_gpio_sensor(
+    fty_sensor_gpio_assets_t* self, const std::string& asset_subtype, const std::string& asset_model)
 {
-    std::string template_filename = "";
-
     if ((asset_subtype == "") || (asset_subtype == "N_A")) {
         log_debug("Asset subtype is not available");
         log_debug("Verification will be limited to template existence!");
@@ -317,28 +387,24 @@ static std::string is_asset_gpio_sensor(fty_sensor_gpio_assets_t* self, const st
         // Check if it's a sensor, otherwise no need to continue!
         if (asset_subtype != "sensorgpio" && asset_subtype != "gpo") {
             log_debug("Asset is not a GPIO sensor, skipping!");
-            return "";
+            return NULL;
         }
     }
 
-    if (asset_model == "")
-        return "";
+    if ((asset_model == "") || !self->catalog)
+        return NULL;
 
     // Check if a sensor template exists
-    template_filename = std::string(self->template_dir) + asset_model + std::string(".tpl");
-
-    FILE* template_file = fopen(template_filename.c_str(), "r");
-    if (!template_file) {
-        log_debug("Template config file %s doesn't exist!", template_filename.c_str());
+    const fty_sensor_gpio_template_t* sensor_template =
+        fty_sensor_gpio_catalog_lookup(self->catalog, asset_model.c_str());
+    if (!sensor_template) {
+        log_debug("Template %s doesn't exist!", asset_model.c_str());
         log_debug("Asset is not a GPIO sensor, skipping!");
     } else {
-        log_debug("Template config file %s found!", template_filename.c_str());
+        log_debug("Template %s found!", asset_model.c_str());
         log_debug("Asset is a GPIO sensor, processing!");
-        fclose(template_file);
-        return template_filename;
     }
-
-    return "";
+    return sensor_template;
 }
 
 //  --------------------------------------------------------------------------
@@ -352,9 +418,8 @@ static void fty_sensor_gpio_handle_asset(fty_sensor_gpio_assets_t* self, fty_pro
     if (fty_proto_id(ftymessage) != FTY_PROTO_ASSET)
         return;
 
-    zconfig_t*  config_template = NULL;
-    const char* operation       = fty_proto_operation(ftymessage);
-    const char* assetname       = fty_proto_name(ftymessage);
+    const char* operation = fty_proto_operation(ftymessage);
+    const char* assetname = fty_proto_name(ftymessage);
 
     log_debug("'%s' operation on asset '%s'", operation, assetname);
 
@@ -379,8 +444,8 @@ static void fty_sensor_gpio_handle_asset(fty_sensor_gpio_assets_t* self, fty_pro
         if (streq(asset_subtype, "sensorgpio")) {
             const char* asset_model = fty_proto_ext_string(ftymessage, "model", "");
 
-            std::string config_template_filename = is_asset_gpio_sensor(self, asset_subtype, asset_model);
-            if (config_template_filename == "") {
+            const fty_sensor_gpio_template_t* sensor_template = is_asset_gpio_sensor(self, asset_subtype, asset_model);
+            if (!sensor_template) {
                 return;
             }
 
@@ -391,31 +456,35 @@ static void fty_sensor_gpio_handle_asset(fty_sensor_gpio_assets_t* self, fty_pro
             }
 
             // We have a GPI sensor, process it
-            config_template = zconfig_load(config_template_filename.c_str());
-            if (!config_template) {
-                log_debug("Can't load sensor template file"); // FIXME: error
-                return;
-            }
-
             // Get static info from template
-            const char* manufacturer = s_get(config_template, "manufacturer", "");
-            const char* sensor_type  = s_get(config_template, "type", "");
+            const char* manufacturer = sensor_template->manufacturer;
+            const char* sensor_type  = sensor_template->type;
             // FIXME: can come from user config
-            const char* sensor_alarm_message = s_get(config_template, "alarm-message", "");
+            const char* sensor_alarm_message = sensor_template->alarm_message;
             // Get from user config
             const char* sensor_gpx_number = fty_proto_ext_string(ftymessage, "port", "");
             const char* extname           = fty_proto_ext_string(ftymessage, "name", "");
             // Get normal state, direction and severity from user config, or fallback to template values
-            const char* sensor_normal_state  = s_get(config_template, "normal-state", "");
+            const char* sensor_normal_state  = sensor_template->normal_state;
             sensor_normal_state              = fty_proto_ext_string(ftymessage, "normal_state", sensor_normal_state);
-            const char* sensor_gpx_direction = s_get(config_template, "gpx-direction", "GPI");
+            const char* sensor_gpx_direction = sensor_template->gpx_direction;
             sensor_gpx_direction             = fty_proto_ext_string(ftymessage, "gpx_direction", sensor_gpx_direction);
             // And deployment location
             const char* sensor_location       = fty_proto_ext_string(ftymessage, "logical_asset", "");
-            const char* sensor_alarm_severity = s_get(config_template, "alarm-severity", "WARNING");
+            const char* sensor_alarm_severity = sensor_template->alarm_severity;
             sensor_alarm_severity = fty_proto_ext_string(ftymessage, "alarm_severity", sensor_alarm_severity);
             // Get the GPO which power us
             const char* power_source = fty_proto_ext_string(ftymessage, "gpo_powersource", "");
+            // And the time it needs to be running once powered
+            const char* sensor_warm_up = sensor_template->warm_up;
+            // Get the poll period from user config, or fallback to template value
+            const char* sensor_poll_interval = sensor_template->poll_interval;
+            sensor_poll_interval             = fty_proto_ext_string(ftymessage, "poll_interval", sensor_poll_interval);
+            // And how long a change has to last to raise or resolve its alert
+            const char* sensor_alarm_delay = sensor_template->alarm_delay;
+            sensor_alarm_delay             = fty_proto_ext_string(ftymessage, "alarm_delay", sensor_alarm_delay);
+            const char* sensor_clear_delay = sensor_template->clear_delay;
+            sensor_clear_delay             = fty_proto_ext_string(ftymessage, "clear_delay", sensor_clear_delay);
             // FIXME: need a power topology request, for latter expansion
             request_sensor_power_source(self, assetname);
 
@@ -423,20 +492,17 @@ static void fty_sensor_gpio_handle_asset(fty_sensor_gpio_assets_t* self, fty_pro
             if (streq(sensor_normal_state, "")) {
                 log_debug("No sensor normal state found in template nor provided by the user!");
                 log_debug("Skipping sensor");
-                zconfig_destroy(&config_template);
                 return;
             }
             if (streq(sensor_gpx_number, "")) {
                 log_debug("No sensor pin (port) provided! Skipping sensor");
-                zconfig_destroy(&config_template);
                 return;
             }
 
             add_sensor(self, operation, manufacturer, assetname, extname, asset_model, sensor_type, sensor_normal_state,
                 sensor_gpx_number, sensor_gpx_direction, asset_parent_name1, sensor_location, power_source,
-                sensor_alarm_message, sensor_alarm_severity);
-
-            zconfig_destroy(&config_template);
+                sensor_alarm_message, sensor_alarm_severity, sensor_warm_up, sensor_poll_interval, sensor_alarm_delay,
+                sensor_clear_delay);
         }
         if (streq(asset_subtype, "gpo")) {
             const char* asset_parent_name1 = fty_proto_aux_string(ftymessage, FTY_PROTO_ASSET_AUX_PARENT_NAME_1, "");
@@ -453,12 +519,10 @@ static void fty_sensor_gpio_handle_asset(fty_sensor_gpio_assets_t* self, fty_pro
             if (streq(sensor_normal_state, "")) {
                 log_debug("No sensor normal state found in template nor provided by the user!");
                 log_debug("Skipping sensor");
-                zconfig_destroy(&config_template);
                 return;
             }
             if (streq(sensor_gpx_number, "")) {
                 log_debug("No sensor pin (port) provided! Skipping sensor");
-                zconfig_destroy(&config_template);
                 return;
             }
 
@@ -591,6 +655,7 @@ fty_sensor_gpio_assets_t* fty_sensor_gpio_assets_new(const char* name)
     self->name         = strdup(name);
     self->test_mode    = false;
     self->template_dir = NULL;
+    self->catalog      = NULL;
     // Declare our zlist for GPIOs tracking
     // Instanciated here and provided to all actors
     _gpx_list = zlistx_new();
@@ -601,6 +666,13 @@ fty_sensor_gpio_assets_t* fty_sensor_gpio_assets_new(const char* name)
     zlistx_set_destructor(_gpx_list, static_cast<czmq_destructor*>(sensor_free));
     zlistx_set_comparator(_gpx_list, static_cast<czmq_comparator*>(sensor_cmp));
 
+    // And the indexes of its items, which it owns
+    _gpx_by_asset_name = zhashx_new();
+    assert(_gpx_by_asset_name);
+    _gpx_by_ext_name = zhashx_new();
+    assert(_gpx_by_ext_name);
+    zhashx_set_destructor(_gpx_by_ext_name, s_sensors_destroy);
+
     return self;
 }
 
@@ -614,6 +686,8 @@ void fty_sensor_gpio_assets_destroy(fty_sensor_gpio_assets_t** self_p)
     if (*self_p) {
         fty_sensor_gpio_assets_t* self = *self_p;
         //  Free class properties
+        zhashx_destroy(&_gpx_by_asset_name);
+        zhashx_destroy(&_gpx_by_ext_name);
         zlistx_purge(_gpx_list);
         zlistx_destroy(&_gpx_list);
         pthread_mutex_unlock(&gpx_list_mutex);
@@ -621,6 +695,7 @@ void fty_sensor_gpio_assets_destroy(fty_sensor_gpio_assets_t** self_p)
         mlm_client_destroy(&self->mlm);
         if (self->template_dir)
             zstr_free(&self->template_dir);
+        fty_sensor_gpio_catalog_destroy(&self->catalog);
 
         pthread_mutex_destroy(&gpx_list_mutex);
         //  Free object itself
@@ -643,20 +718,27 @@ void fty_sensor_gpio_assets(zsock_t* pipe, void* args)
     fty_sensor_gpio_assets_t* self = fty_sensor_gpio_assets_new(name);
     assert(self);
 
-    zpoller_t* poller = zpoller_new(pipe, mlm_client_msgpipe(self->mlm), NULL);
-    assert(poller);
+    // Poll items: actor pipe, malamute client, then the templates changes, if
+    // watched
+    zmq_pollitem_t items[3];
 
     zsock_signal(pipe, 0);
     log_info("%s_assets: Started", self->name);
 
     while (!zsys_interrupted) {
-        void* which = zpoller_wait(poller, TIMEOUT_MS);
-        if (which == NULL) {
-            if (zpoller_terminated(poller) || zsys_interrupted) {
+        int catalog_fd = (self->catalog) ? fty_sensor_gpio_catalog_fd(self->catalog) : -1;
+        items[0]       = {zsock_resolve(pipe), 0, ZMQ_POLLIN, 0};
+        items[1]       = {zsock_resolve(mlm_client_msgpipe(self->mlm)), 0, ZMQ_POLLIN, 0};
+        items[2]       = {nullptr, catalog_fd, ZMQ_POLLIN, 0};
+        if (zmq_poll(items, (catalog_fd != -1) ? 3 : 2, TIMEOUT_MS) == -1) {
+            if ((errno == ETERM) || zsys_interrupted) {
                 break;
             }
+            continue;
         }
-        if (which == pipe) {
+        if ((catalog_fd != -1) && (items[2].revents & ZMQ_POLLIN))
+            fty_sensor_gpio_catalog_refresh(self->catalog);
+        if (items[0].revents & ZMQ_POLLIN) {
             zmsg_t* message = zmsg_recv(pipe);
             char*   cmd     = zmsg_popstr(message);
             if (cmd) {
@@ -694,15 +776,19 @@ void fty_sensor_gpio_assets(zsock_t* pipe, void* args)
                     self->test_mode = true;
                     log_debug("TEST=true");
                 } else if (streq(cmd, "TEMPLATE_DIR")) {
+                    zstr_free(&self->template_dir);
+                    fty_sensor_gpio_catalog_destroy(&self->catalog);
                     self->template_dir = zmsg_popstr(message);
                     log_debug("fty_sensor_gpio: Using sensors template directory: %s", self->template_dir);
+                    if (self->template_dir)
+                        self->catalog = fty_sensor_gpio_catalog_new(self->template_dir);
                 } else {
                     log_warning("\tUnknown API command=%s, ignoring", cmd);
                 }
                 zstr_free(&cmd);
             }
             zmsg_destroy(&message);
-        } else if (which == mlm_client_msgpipe(self->mlm)) {
+        } else if (items[1].revents & ZMQ_POLLIN) {
             zmsg_t* message = mlm_client_recv(self->mlm);
             if (fty_proto_is(message)) {
                 fty_proto_t* fmessage = fty_proto_decode(&message);
@@ -717,6 +803,5 @@ void fty_sensor_gpio_assets(zsock_t* pipe, void* args)
         }
     }
 exit:
-    zpoller_destroy(&poller);
     fty_sensor_gpio_assets_destroy(&self);
 }
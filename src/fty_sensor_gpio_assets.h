@@ -20,16 +20,18 @@
 */
 
 #pragma once
+#include "fty_sensor_gpio_catalog.h"
 #include <malamute.h>
 
 ///  Structure of our class
 struct fty_sensor_gpio_assets_t
 {
-    char*         name;         // actor name
-    mlm_client_t* mlm;          // malamute client
-    zlistx_t*     gpx_list;     // List of monitored GPx _gpx_info_t (10xGPI / 5xGPO on IPC3000)
-    char*         template_dir; // Location of the template files
-    bool          test_mode;    // true if we are in test mode, false otherwise
+    char*                      name;         // actor name
+    mlm_client_t*              mlm;          // malamute client
+    zlistx_t*                  gpx_list;     // List of monitored GPx _gpx_info_t (10xGPI / 5xGPO on IPC3000)
+    char*                      template_dir; // Location of the template files
+    fty_sensor_gpio_catalog_t* catalog;      // Templates of template_dir, NULL until it is set
+    bool                       test_mode;    // true if we are in test mode, false otherwise
 };
 
 ///  fty_sensor_gpio_assets actor
@@ -49,6 +51,9 @@ int add_sensor(fty_sensor_gpio_assets_t* self, const char* operation, const char
     const char* extname, const char* asset_subtype, const char* sensor_type, const char* sensor_normal_state,
     const char* sensor_gpx_number, const char* sensor_gpx_direction, const char* sensor_parent,
     const char* sensor_location, const char* sensor_power_source, const char* sensor_alarm_message,
-    const char* sensor_alarm_severity);
+    const char* sensor_alarm_severity, const char* sensor_warm_up = "", const char* sensor_poll_interval = "",
+    const char* sensor_alarm_delay = "", const char* sensor_clear_delay = "");
+
+int delete_sensor(fty_sensor_gpio_assets_t* self, const char* assetname);
 
 void request_sensor_power_source(fty_sensor_gpio_assets_t* self, const char* asset_name);
@@ -0,0 +1,321 @@
+/*  =========================================================================
+    fty_sensor_gpio_catalog - Catalog of the GPIO sensors templates
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_sensor_gpio_catalog - Catalog of the GPIO sensors templates
+@discuss
+    Every <model>.tpl file of the template directory is parsed once, when
+    the catalog is created, into a template record, so that asset messages
+    are handled without any file access. The directory is then watched with
+    inotify: a template written, moved in, moved out or removed is parsed
+    again or dropped on its own at the next refresh, and an event queue
+    overflow (or a moved directory) parses the whole directory again.
+
+    If the directory goes away, the catalog tries to watch it again at each
+    lookup, and parses it again once it is back. If inotify is not available,
+    the catalog can't tell a template changed, and parses again the templates
+    it doesn't know of at lookup instead.
+@end
+*/
+
+#include "fty_sensor_gpio_catalog.h"
+#include "fty_sensor_gpio.h"
+#include <errno.h>
+#include <fty_log.h>
+#include <limits.h>
+#include <string>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define CATALOG_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+///  Structure of our class
+struct fty_sensor_gpio_catalog_t
+{
+    char*     template_dir; // directory of the templates, with a trailing '/'
+    zhashx_t* templates;    // parsed templates, by model
+    int       inotify_fd;   // inotify instance, -1 if not available
+    int       watch;        // watch descriptor of template_dir, -1 if not watched
+    uint64_t  loads;        // number of template files parsed
+};
+
+//  --------------------------------------------------------------------------
+//  Destroy a template
+
+static void s_template_destroy(void** self_ptr)
+{
+    fty_sensor_gpio_template_t* self = static_cast<fty_sensor_gpio_template_t*>(*self_ptr);
+    zstr_free(&self->model);
+    zstr_free(&self->manufacturer);
+    zstr_free(&self->type);
+    zstr_free(&self->normal_state);
+    zstr_free(&self->gpx_direction);
+    zstr_free(&self->power_source);
+    zstr_free(&self->alarm_severity);
+    zstr_free(&self->alarm_message);
+    zstr_free(&self->warm_up);
+    zstr_free(&self->poll_interval);
+    zstr_free(&self->alarm_delay);
+    zstr_free(&self->clear_delay);
+    free(self);
+    *self_ptr = nullptr;
+}
+
+//  --------------------------------------------------------------------------
+//  Parse the template of model, and replace its previous record, or drop it
+//  if its file is gone or invalid
+
+static void s_load(fty_sensor_gpio_catalog_t* self, const char* model)
+{
+    std::string filename = std::string(self->template_dir) + model + ".tpl";
+    zconfig_t*  config   = (zsys_file_exists(filename.c_str())) ? zconfig_load(filename.c_str()) : nullptr;
+    if (!config) {
+        if (zhashx_lookup(self->templates, model))
+            log_debug("Template %s removed from the catalog", model);
+        zhashx_delete(self->templates, model);
+        return;
+    }
+    self->loads++;
+
+    fty_sensor_gpio_template_t* record =
+        static_cast<fty_sensor_gpio_template_t*>(zmalloc(sizeof(fty_sensor_gpio_template_t)));
+    record->model          = strdup(model);
+    record->manufacturer   = strdup(s_get(config, "manufacturer", ""));
+    record->type           = strdup(s_get(config, "type", ""));
+    record->normal_state   = strdup(s_get(config, "normal-state", ""));
+    record->gpx_direction  = strdup(s_get(config, "gpx-direction", "GPI"));
+    record->power_source   = strdup(s_get(config, "power-source", ""));
+    record->alarm_severity = strdup(s_get(config, "alarm-severity", "WARNING"));
+    record->alarm_message  = strdup(s_get(config, "alarm-message", ""));
+    record->warm_up        = strdup(s_get(config, "warm-up-time", ""));
+    record->poll_interval  = strdup(s_get(config, "poll-interval", ""));
+    record->alarm_delay    = strdup(s_get(config, "alarm-delay", ""));
+    record->clear_delay    = strdup(s_get(config, "clear-delay", ""));
+    zconfig_destroy(&config);
+
+    zhashx_update(self->templates, model, record);
+    log_debug("Template %s loaded in the catalog", model);
+}
+
+//  --------------------------------------------------------------------------
+//  Get the model of a template file name, or an empty string if it isn't
+//  a template
+
+static std::string s_model(const char* filename)
+{
+    std::string model = filename;
+    if ((model.size() <= 4) || (model.compare(model.size() - 4, 4, ".tpl") != 0))
+        return "";
+    return model.erase(model.size() - 4);
+}
+
+//  --------------------------------------------------------------------------
+//  Parse all the templates of template_dir again
+
+static void s_load_all(fty_sensor_gpio_catalog_t* self)
+{
+    zhashx_purge(self->templates);
+
+    zdir_t* dir = zdir_new(self->template_dir, "-");
+    if (!dir) {
+        log_warning("Can't read the template directory %s", self->template_dir);
+        return;
+    }
+    zlist_t* files = zdir_list(dir);
+    zfile_t* item  = (files) ? static_cast<zfile_t*>(zlist_first(files)) : nullptr;
+    while (item) {
+        const char* filename = zfile_filename(item, nullptr);
+        const char* basename = strrchr(filename, '/');
+        std::string model    = s_model((basename) ? basename + 1 : filename);
+        if (model != "")
+            s_load(self, model.c_str());
+        item = static_cast<zfile_t*>(zlist_next(files));
+    }
+    zlist_destroy(&files);
+    zdir_destroy(&dir);
+    log_info("%zu templates loaded from %s", zhashx_size(self->templates), self->template_dir);
+}
+
+//  --------------------------------------------------------------------------
+//  Watch template_dir, if it isn't already. Return true if it just got
+//  watched
+
+static bool s_watch(fty_sensor_gpio_catalog_t* self)
+{
+    if ((self->inotify_fd == -1) || (self->watch != -1))
+        return false;
+    self->watch = inotify_add_watch(self->inotify_fd, self->template_dir, CATALOG_EVENTS);
+    return (self->watch != -1);
+}
+
+//  --------------------------------------------------------------------------
+//  Create a new fty_sensor_gpio_catalog
+
+fty_sensor_gpio_catalog_t* fty_sensor_gpio_catalog_new(const char* template_dir)
+{
+    assert(template_dir);
+    fty_sensor_gpio_catalog_t* self =
+        static_cast<fty_sensor_gpio_catalog_t*>(zmalloc(sizeof(fty_sensor_gpio_catalog_t)));
+    assert(self);
+
+    //  Initialize class properties
+    size_t length      = strlen(template_dir);
+    self->template_dir = (length && (template_dir[length - 1] == '/')) ? strdup(template_dir)
+                                                                       : zsys_sprintf("%s/", template_dir);
+    self->templates    = zhashx_new();
+    zhashx_set_destructor(self->templates, s_template_destroy);
+    self->loads = 0;
+
+    // Watch before parsing, so that no change gets lost in between
+    self->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    self->watch      = -1;
+    if (self->inotify_fd == -1) {
+        log_warning("Failed to initialize inotify (errno %i), templates will be parsed on demand", errno);
+    } else if (!s_watch(self)) {
+        log_warning("Can't watch the template directory %s (errno %i), templates will be parsed on demand",
+            self->template_dir, errno);
+    }
+    s_load_all(self);
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the fty_sensor_gpio_catalog
+
+void fty_sensor_gpio_catalog_destroy(fty_sensor_gpio_catalog_t** self_p)
+{
+    assert(self_p);
+    if (*self_p) {
+        fty_sensor_gpio_catalog_t* self = *self_p;
+
+        //  Free class properties
+        if (self->inotify_fd != -1)
+            close(self->inotify_fd);
+        zhashx_destroy(&self->templates);
+        zstr_free(&self->template_dir);
+        //  Free object itself
+        free(self);
+        *self_p = nullptr;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Get the template of model
+
+const fty_sensor_gpio_template_t* fty_sensor_gpio_catalog_lookup(fty_sensor_gpio_catalog_t* self, const char* model)
+{
+    assert(self);
+    assert(model);
+    // The template directory may be back since it went away
+    if (s_watch(self)) {
+        log_info("Watching the template directory %s again", self->template_dir);
+        s_load_all(self);
+    }
+    fty_sensor_gpio_template_t* record =
+        static_cast<fty_sensor_gpio_template_t*>(zhashx_lookup(self->templates, model));
+    // Unwatched, a template may have been added since
+    if (!record && (self->watch == -1) && !streq(model, "") && !strchr(model, '/')) {
+        s_load(self, model);
+        record = static_cast<fty_sensor_gpio_template_t*>(zhashx_lookup(self->templates, model));
+    }
+    return record;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the inotify file descriptor to poll for template changes
+
+int fty_sensor_gpio_catalog_fd(fty_sensor_gpio_catalog_t* self)
+{
+    assert(self);
+    return (self->watch != -1) ? self->inotify_fd : -1;
+}
+
+//  --------------------------------------------------------------------------
+//  Refresh the templates which changed
+
+size_t fty_sensor_gpio_catalog_refresh(fty_sensor_gpio_catalog_t* self)
+{
+    assert(self);
+    if (self->inotify_fd == -1)
+        return 0;
+
+    // Gather the changed models first, a template written is often reported
+    // more than once
+    zhashx_t* changed  = zhashx_new();
+    bool      load_all = false;
+    alignas(struct inotify_event) char events[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+    ssize_t length;
+    while ((length = read(self->inotify_fd, events, sizeof(events))) > 0) {
+        const struct inotify_event* event = nullptr;
+        for (char* position = events; position < events + length;
+             position += sizeof(struct inotify_event) + event->len) {
+            event = reinterpret_cast<const struct inotify_event*>(position);
+            if (event->mask & IN_Q_OVERFLOW) {
+                load_all = true;
+            } else if ((event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) && (event->wd == self->watch)) {
+                // The directory itself is gone, its templates go with it
+                log_warning("Template directory %s moved or removed", self->template_dir);
+                if (self->watch != -1)
+                    inotify_rm_watch(self->inotify_fd, self->watch);
+                self->watch = -1;
+                load_all    = true;
+            } else if (event->len > 0) {
+                std::string model = s_model(event->name);
+                if (model != "")
+                    zhashx_update(changed, model.c_str(), const_cast<char*>(""));
+            }
+        }
+    }
+
+    size_t refreshed = 0;
+    if (load_all) {
+        s_load_all(self);
+        refreshed = zhashx_size(self->templates);
+    } else {
+        void* item = zhashx_first(changed);
+        while (item) {
+            s_load(self, static_cast<const char*>(zhashx_cursor(changed)));
+            refreshed++;
+            item = zhashx_next(changed);
+        }
+    }
+    zhashx_destroy(&changed);
+    return refreshed;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of templates in the catalog
+
+size_t fty_sensor_gpio_catalog_size(fty_sensor_gpio_catalog_t* self)
+{
+    assert(self);
+    return zhashx_size(self->templates);
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of template files parsed so far
+
+uint64_t fty_sensor_gpio_catalog_loads(fty_sensor_gpio_catalog_t* self)
+{
+    assert(self);
+    return self->loads;
+}
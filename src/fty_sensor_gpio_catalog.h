@@ -0,0 +1,72 @@
+/*  =========================================================================
+    fty_sensor_gpio_catalog - Catalog of the GPIO sensors templates
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+#include <czmq.h>
+
+///  Template of a GPIO sensor model, as parsed from <template_dir>/<model>.tpl.
+///  Missing keys are empty, but gpx_direction ("GPI") and alarm_severity
+///  ("WARNING")
+struct fty_sensor_gpio_template_t
+{
+    char* model;          // part number of the sensor
+    char* manufacturer;   // manufacturer
+    char* type;           // sensor type
+    char* normal_state;   // normal state, "opened" or "closed"
+    char* gpx_direction;  // "GPI" or "GPO"
+    char* power_source;   // power source
+    char* alarm_severity; // severity of the alerts
+    char* alarm_message;  // message of the alerts
+    char* warm_up;        // warm up time (ms)
+    char* poll_interval;  // poll interval (ms)
+    char* alarm_delay;    // time (ms) a change has to last to raise its alert
+    char* clear_delay;    // time (ms) a change has to last to resolve its alert
+};
+
+///  Catalog of the templates (opaque)
+struct fty_sensor_gpio_catalog_t;
+
+///  Create a new catalog of the templates of template_dir, all parsed at
+///  once, and watched for changes with inotify
+fty_sensor_gpio_catalog_t* fty_sensor_gpio_catalog_new(const char* template_dir);
+
+///  Destroy the catalog
+void fty_sensor_gpio_catalog_destroy(fty_sensor_gpio_catalog_t** self_p);
+
+///  Get the template of model, or nullptr if there is none. Never reads the
+///  disk while template_dir is watched. Otherwise, tries to watch it again,
+///  and parses it again if it is back
+const fty_sensor_gpio_template_t* fty_sensor_gpio_catalog_lookup(fty_sensor_gpio_catalog_t* self, const char* model);
+
+///  Get the inotify file descriptor to poll for template changes, or -1 if
+///  template_dir is not watched
+int fty_sensor_gpio_catalog_fd(fty_sensor_gpio_catalog_t* self);
+
+///  Read the pending inotify events, and parse again the templates which
+///  changed, or drop the removed ones. Return the number of templates
+///  refreshed
+size_t fty_sensor_gpio_catalog_refresh(fty_sensor_gpio_catalog_t* self);
+
+///  Get the number of templates in the catalog
+size_t fty_sensor_gpio_catalog_size(fty_sensor_gpio_catalog_t* self);
+
+///  Get the number of template files parsed so far
+uint64_t fty_sensor_gpio_catalog_loads(fty_sensor_gpio_catalog_t* self);
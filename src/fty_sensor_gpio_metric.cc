@@ -0,0 +1,136 @@
+/*  =========================================================================
+    fty_sensor_gpio_metric - Prebuilt sensor status metrics
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+
+/*
+@header
+    fty_sensor_gpio_metric - Prebuilt sensor status metrics
+@discuss
+    The port, sname, type and topic of the status metrics of a sensor are
+    built once, so that publishing a status only fills the value, time and
+    TTL in.
+@end
+*/
+
+#include "fty_sensor_gpio_metric.h"
+#include "libgpio.h"
+#include <fty_proto.h>
+
+///  Structure of our class
+struct fty_sensor_gpio_metric_t
+{
+    int      gpx_number;    // GPx number the template was built for
+    int      gpx_direction; // GPx direction the template was built for
+    char*    parent;        // metric name, i.e. parent asset of the sensor
+    char*    type;          // "status.<port>"
+    char*    topic;         // "status.<port>@<parent>"
+    zhash_t* aux;           // port and sname
+};
+
+//  --------------------------------------------------------------------------
+//  Create the status metric template of a sensor
+
+fty_sensor_gpio_metric_t* fty_sensor_gpio_metric_new(const gpx_info_t* sensor)
+{
+    assert(sensor);
+    fty_sensor_gpio_metric_t* self =
+        static_cast<fty_sensor_gpio_metric_t*>(zmalloc(sizeof(fty_sensor_gpio_metric_t)));
+    assert(self);
+
+    char port[16]; // "GPI" + "xx" + '\0'
+    snprintf(&port[0], sizeof(port), "GP%c%i", ((sensor->gpx_direction == GPIO_DIRECTION_IN) ? 'I' : 'O'),
+        sensor->gpx_number);
+
+    self->gpx_number    = sensor->gpx_number;
+    self->gpx_direction = sensor->gpx_direction;
+    self->parent        = strdup((sensor->parent) ? sensor->parent : "");
+    self->type          = zsys_sprintf("status.%s", &port[0]);
+    self->topic         = zsys_sprintf("%s@%s", self->type, self->parent);
+    self->aux           = zhash_new();
+    zhash_autofree(self->aux);
+    zhash_insert(self->aux, FTY_PROTO_METRICS_SENSOR_AUX_PORT, static_cast<void*>(&port[0]));
+    zhash_insert(self->aux, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, static_cast<void*>(sensor->asset_name));
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the status metric template
+
+void fty_sensor_gpio_metric_destroy(fty_sensor_gpio_metric_t** self_p)
+{
+    assert(self_p);
+    if (*self_p) {
+        fty_sensor_gpio_metric_t* self = *self_p;
+        zstr_free(&self->parent);
+        zstr_free(&self->type);
+        zstr_free(&self->topic);
+        zhash_destroy(&self->aux);
+        free(self);
+        *self_p = nullptr;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Check whether the template still matches the sensor
+
+bool fty_sensor_gpio_metric_matches(fty_sensor_gpio_metric_t* self, const gpx_info_t* sensor)
+{
+    assert(self);
+    assert(sensor);
+    return (self->gpx_number == sensor->gpx_number) && (self->gpx_direction == sensor->gpx_direction) &&
+           streq(self->parent, (sensor->parent) ? sensor->parent : "");
+}
+
+//  --------------------------------------------------------------------------
+//  Get the metric name
+
+const char* fty_sensor_gpio_metric_name(fty_sensor_gpio_metric_t* self)
+{
+    assert(self);
+    return self->parent;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the metric type
+
+const char* fty_sensor_gpio_metric_type(fty_sensor_gpio_metric_t* self)
+{
+    assert(self);
+    return self->type;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the metric topic
+
+const char* fty_sensor_gpio_metric_topic(fty_sensor_gpio_metric_t* self)
+{
+    assert(self);
+    return self->topic;
+}
+
+//  --------------------------------------------------------------------------
+//  Encode the metric of the sensor state
+
+zmsg_t* fty_sensor_gpio_metric_encode(fty_sensor_gpio_metric_t* self, int state, uint64_t time, uint32_t ttl)
+{
+    assert(self);
+    return fty_proto_encode_metric(self->aux, time, ttl, self->type, self->parent, libgpio_get_status_name(state), "");
+}
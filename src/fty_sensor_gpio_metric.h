@@ -0,0 +1,52 @@
+/*  =========================================================================
+    fty_sensor_gpio_metric - Prebuilt sensor status metrics
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+#include "fty_sensor_gpio.h"
+#include <czmq.h>
+
+///  Status metric template of a sensor (opaque), holding the parts of its
+///  published metrics which only depend on the sensor: port, sname, type
+///  and topic
+struct fty_sensor_gpio_metric_t;
+
+///  Create the status metric template of a sensor
+fty_sensor_gpio_metric_t* fty_sensor_gpio_metric_new(const gpx_info_t* sensor);
+
+///  Destroy the status metric template
+void fty_sensor_gpio_metric_destroy(fty_sensor_gpio_metric_t** self_p);
+
+///  Check whether the template still matches the sensor (GPx, direction and
+///  parent), i.e. whether it has to be built again
+bool fty_sensor_gpio_metric_matches(fty_sensor_gpio_metric_t* self, const gpx_info_t* sensor);
+
+///  Get the metric name, i.e. the parent asset of the sensor
+const char* fty_sensor_gpio_metric_name(fty_sensor_gpio_metric_t* self);
+
+///  Get the metric type, i.e. "status.<port>"
+const char* fty_sensor_gpio_metric_type(fty_sensor_gpio_metric_t* self);
+
+///  Get the metric topic, i.e. "status.<port>@<parent>"
+const char* fty_sensor_gpio_metric_topic(fty_sensor_gpio_metric_t* self);
+
+///  Encode the metric of the sensor state, at time (s) with ttl (s).
+///  Return the message, or nullptr on error
+zmsg_t* fty_sensor_gpio_metric_encode(fty_sensor_gpio_metric_t* self, int state, uint64_t time, uint32_t ttl);
@@ -0,0 +1,146 @@
+/*  =========================================================================
+    fty_sensor_gpio_ring - Lock-free SPSC ring of GPI samples
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_sensor_gpio_ring - Lock-free SPSC ring of GPI samples
+@discuss
+    The producer only writes the tail, and the consumer only the head, each
+    one publishing its index with a release store once the slot is written,
+    or read, and reading the other one with an acquire load. Both indexes
+    grow forever, and are masked to address the slots. Each thread keeps a
+    cached copy of the other index, to only load it again when the ring
+    looks full, or empty, and the indexes live on their own cache lines.
+@end
+*/
+
+#include "fty_sensor_gpio_ring.h"
+#include <atomic>
+#include <new>
+
+#define RING_CACHE_LINE 64
+
+///  Structure of our class
+struct fty_sensor_gpio_ring_t
+{
+    // Written by the consumer
+    alignas(RING_CACHE_LINE) std::atomic<size_t> head;        // next slot to pop
+    size_t                                       cached_tail; // tail last seen by the consumer
+
+    // Written by the producer
+    alignas(RING_CACHE_LINE) std::atomic<size_t> tail;        // next slot to push
+    size_t                                       cached_head; // head last seen by the producer
+
+    // Read only
+    alignas(RING_CACHE_LINE) size_t mask;  // capacity - 1
+    fty_sensor_gpio_sample_t*       slots; // samples
+};
+
+//  --------------------------------------------------------------------------
+//  Create a new ring
+
+fty_sensor_gpio_ring_t* fty_sensor_gpio_ring_new(size_t capacity)
+{
+    size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+
+    fty_sensor_gpio_ring_t* self = new (std::nothrow) fty_sensor_gpio_ring_t();
+    assert(self);
+    self->head        = 0;
+    self->cached_tail = 0;
+    self->tail        = 0;
+    self->cached_head = 0;
+    self->mask        = size - 1;
+    self->slots       = static_cast<fty_sensor_gpio_sample_t*>(zmalloc(size * sizeof(fty_sensor_gpio_sample_t)));
+    assert(self->slots);
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the ring
+
+void fty_sensor_gpio_ring_destroy(fty_sensor_gpio_ring_t** self_p)
+{
+    assert(self_p);
+    if (*self_p) {
+        fty_sensor_gpio_ring_t* self = *self_p;
+        free(self->slots);
+        delete self;
+        *self_p = nullptr;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Push a sample, from the producer thread
+
+bool fty_sensor_gpio_ring_push(fty_sensor_gpio_ring_t* self, const fty_sensor_gpio_sample_t* sample)
+{
+    assert(self);
+    assert(sample);
+    size_t tail = self->tail.load(std::memory_order_relaxed);
+    if (tail - self->cached_head > self->mask) {
+        self->cached_head = self->head.load(std::memory_order_acquire);
+        if (tail - self->cached_head > self->mask)
+            return false;
+    }
+    self->slots[tail & self->mask] = *sample;
+    self->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+//  --------------------------------------------------------------------------
+//  Pop the oldest sample, from the consumer thread
+
+bool fty_sensor_gpio_ring_pop(fty_sensor_gpio_ring_t* self, fty_sensor_gpio_sample_t* sample)
+{
+    assert(self);
+    assert(sample);
+    size_t head = self->head.load(std::memory_order_relaxed);
+    if (head == self->cached_tail) {
+        self->cached_tail = self->tail.load(std::memory_order_acquire);
+        if (head == self->cached_tail)
+            return false;
+    }
+    *sample = self->slots[head & self->mask];
+    self->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of samples in the ring
+
+size_t fty_sensor_gpio_ring_depth(fty_sensor_gpio_ring_t* self)
+{
+    assert(self);
+    size_t head = self->head.load(std::memory_order_acquire);
+    size_t tail = self->tail.load(std::memory_order_acquire);
+    return (tail >= head) ? tail - head : 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the capacity of the ring
+
+size_t fty_sensor_gpio_ring_capacity(fty_sensor_gpio_ring_t* self)
+{
+    assert(self);
+    return self->mask + 1;
+}
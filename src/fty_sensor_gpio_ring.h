@@ -0,0 +1,55 @@
+/*  =========================================================================
+    fty_sensor_gpio_ring - Lock-free SPSC ring of GPI samples
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+#include <czmq.h>
+
+///  Sample of a GPI state
+struct fty_sensor_gpio_sample_t
+{
+    int     gpx_number; // GPI number
+    int     state;      // GPIO_STATE_xxx read
+    int64_t sampled_at; // monotonic time (us) of the read
+};
+
+///  Ring (opaque) of GPI samples, with a single producer and a single
+///  consumer thread, without locks
+struct fty_sensor_gpio_ring_t;
+
+///  Create a new ring, holding at least capacity samples
+fty_sensor_gpio_ring_t* fty_sensor_gpio_ring_new(size_t capacity);
+
+///  Destroy the ring
+void fty_sensor_gpio_ring_destroy(fty_sensor_gpio_ring_t** self_p);
+
+///  Push a sample, from the producer thread. Return false if the ring is full
+bool fty_sensor_gpio_ring_push(fty_sensor_gpio_ring_t* self, const fty_sensor_gpio_sample_t* sample);
+
+///  Pop the oldest sample, from the consumer thread. Return false if the ring
+///  is empty
+bool fty_sensor_gpio_ring_pop(fty_sensor_gpio_ring_t* self, fty_sensor_gpio_sample_t* sample);
+
+///  Get the number of samples in the ring (exact from either thread, when the
+///  other one is idle)
+size_t fty_sensor_gpio_ring_depth(fty_sensor_gpio_ring_t* self);
+
+///  Get the capacity of the ring
+size_t fty_sensor_gpio_ring_capacity(fty_sensor_gpio_ring_t* self);
@@ -0,0 +1,272 @@
+/*  =========================================================================
+    fty_sensor_gpio_sampler - GPI sampler thread
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_sensor_gpio_sampler - GPI sampler thread
+@discuss
+    The sampler thread reads the GPIs at once every interval, on deadlines of
+    the monotonic clock, and pushes the timestamped state changes into a
+    lock-free SPSC ring, then signals them through an eventfd. So sampling
+    is neither delayed by the publication, nor by the mailbox requests of
+    the server actor, which only shares the GPIO library with it, through
+    gpio_mutex. Rounds which can't keep up with the interval are skipped.
+@end
+*/
+
+#include "fty_sensor_gpio_sampler.h"
+#include <algorithm>
+#include <atomic>
+#include <fty_log.h>
+#include <new>
+#include <sys/eventfd.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+///  Structure of our class
+struct fty_sensor_gpio_sampler_t
+{
+    libgpio_t*              gpio_lib;   // GPIO library, shared with the server actor
+    pthread_mutex_t*        gpio_mutex; // lock of the GPIO library (and of gpis)
+    int                     interval;   // sampling period (ms)
+    fty_sensor_gpio_ring_t* ring;       // state changes, from the sampler thread to the server actor
+    int                     event_fd;   // signals the state changes pushed
+    std::vector<int>        gpis;       // GPIs to sample
+    bool                    gpis_reset; // true if the GPIs changed since the last round
+    std::atomic<bool>       stop;       // true to stop the sampler thread
+    std::atomic<uint64_t>   rounds;     // number of sampling rounds
+    std::atomic<uint64_t>   changes;    // number of state changes pushed
+    std::atomic<uint64_t>   drops;      // number of state changes dropped
+    std::thread             thread;     // sampler thread
+};
+
+//  --------------------------------------------------------------------------
+//  Sleep until a deadline of the monotonic clock (ms)
+
+static void s_sleep_until(int64_t deadline)
+{
+    struct timespec wake_at;
+    wake_at.tv_sec  = time_t(deadline / 1000);
+    wake_at.tv_nsec = long((deadline % 1000) * 1000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_at, nullptr) == EINTR)
+        ;
+}
+
+//  --------------------------------------------------------------------------
+//  Monotonic clock (ms), as used by clock_nanosleep
+
+static int64_t s_monotonic_ms()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return int64_t(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+//  --------------------------------------------------------------------------
+//  Sampler thread
+
+static void s_sampler_run(fty_sensor_gpio_sampler_t* self)
+{
+    std::vector<int>                      last_states; // last state pushed, by GPI number
+    std::vector<fty_sensor_gpio_sample_t> samples;
+    int64_t                               deadline = s_monotonic_ms();
+
+    while (!self->stop.load(std::memory_order_relaxed)) {
+        // Read all the GPIs at once
+        samples.clear();
+        pthread_mutex_lock(self->gpio_mutex);
+        if (self->gpis_reset) {
+            last_states.assign(last_states.size(), GPIO_STATE_UNKNOWN);
+            self->gpis_reset = false;
+        }
+        if (!self->gpis.empty()) {
+            libgpio_snapshot_t* snapshot = libgpio_snapshot_new(self->gpio_lib);
+            for (int gpi : self->gpis)
+                libgpio_snapshot_select(snapshot, gpi, GPIO_DIRECTION_IN);
+            libgpio_read_all(self->gpio_lib, snapshot);
+            int64_t sampled_at = zclock_usecs();
+            for (int gpi : self->gpis)
+                samples.push_back({gpi, libgpio_snapshot_get(snapshot, gpi, GPIO_DIRECTION_IN), sampled_at});
+            libgpio_snapshot_destroy(&snapshot);
+        }
+        pthread_mutex_unlock(self->gpio_mutex);
+
+        // Then push the changes, which are pushed again next round if dropped
+        bool pushed = false;
+        for (const fty_sensor_gpio_sample_t& sample : samples) {
+            if (sample.state == GPIO_STATE_UNKNOWN)
+                continue;
+            if (size_t(sample.gpx_number) >= last_states.size())
+                last_states.resize(size_t(sample.gpx_number) + 1, GPIO_STATE_UNKNOWN);
+            if (last_states[size_t(sample.gpx_number)] == sample.state)
+                continue;
+            if (fty_sensor_gpio_ring_push(self->ring, &sample)) {
+                last_states[size_t(sample.gpx_number)] = sample.state;
+                self->changes++;
+                pushed = true;
+            } else
+                self->drops++;
+        }
+        if (pushed) {
+            uint64_t one = 1;
+            if (write(self->event_fd, &one, sizeof(one)) != sizeof(one))
+                log_debug("Can't signal the GPI samples: %s", strerror(errno));
+        }
+        self->rounds++;
+
+        // Stay on the interval grid, skipping the rounds already missed
+        deadline += self->interval;
+        int64_t now = s_monotonic_ms();
+        if (deadline <= now)
+            deadline += ((now - deadline) / self->interval + 1) * self->interval;
+        s_sleep_until(deadline);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Create a sampler, and start its thread
+
+fty_sensor_gpio_sampler_t* fty_sensor_gpio_sampler_new(
+    libgpio_t* gpio_lib, pthread_mutex_t* gpio_mutex, int interval, size_t depth)
+{
+    assert(gpio_lib);
+    assert(gpio_mutex);
+    assert(interval > 0);
+    fty_sensor_gpio_sampler_t* self = new (std::nothrow) fty_sensor_gpio_sampler_t();
+    assert(self);
+
+    self->gpio_lib   = gpio_lib;
+    self->gpio_mutex = gpio_mutex;
+    self->interval   = interval;
+    self->ring       = fty_sensor_gpio_ring_new(depth);
+    self->event_fd   = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    self->gpis_reset = false;
+    self->stop       = false;
+    self->rounds     = 0;
+    self->changes    = 0;
+    self->drops      = 0;
+    if (self->event_fd == -1) {
+        log_error("Can't create the GPI sampler eventfd: %s", strerror(errno));
+        fty_sensor_gpio_ring_destroy(&self->ring);
+        delete self;
+        return nullptr;
+    }
+    self->thread = std::thread(s_sampler_run, self);
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Stop the sampler thread, and destroy the sampler
+
+void fty_sensor_gpio_sampler_destroy(fty_sensor_gpio_sampler_t** self_p)
+{
+    assert(self_p);
+    if (*self_p) {
+        fty_sensor_gpio_sampler_t* self = *self_p;
+        self->stop = true;
+        self->thread.join();
+        close(self->event_fd);
+        fty_sensor_gpio_ring_destroy(&self->ring);
+        delete self;
+        *self_p = nullptr;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Set the GPIs to sample
+
+void fty_sensor_gpio_sampler_set_gpis(fty_sensor_gpio_sampler_t* self, const int* gpis, size_t count)
+{
+    assert(self);
+    pthread_mutex_lock(self->gpio_mutex);
+    if ((count != self->gpis.size()) || !std::equal(self->gpis.begin(), self->gpis.end(), gpis)) {
+        self->gpis.assign(gpis, gpis + count);
+        self->gpis_reset = true;
+    }
+    pthread_mutex_unlock(self->gpio_mutex);
+}
+
+//  --------------------------------------------------------------------------
+//  Get the fd, readable when samples were pushed into the ring
+
+int fty_sensor_gpio_sampler_fd(fty_sensor_gpio_sampler_t* self)
+{
+    assert(self);
+    return self->event_fd;
+}
+
+//  --------------------------------------------------------------------------
+//  Acknowledge the readable fd
+
+void fty_sensor_gpio_sampler_acknowledge(fty_sensor_gpio_sampler_t* self)
+{
+    assert(self);
+    uint64_t count;
+    if (read(self->event_fd, &count, sizeof(count)) != sizeof(count) && (errno != EAGAIN))
+        log_debug("Can't acknowledge the GPI samples: %s", strerror(errno));
+}
+
+//  --------------------------------------------------------------------------
+//  Pop the oldest state change from the ring
+
+bool fty_sensor_gpio_sampler_pop(fty_sensor_gpio_sampler_t* self, fty_sensor_gpio_sample_t* sample)
+{
+    assert(self);
+    return fty_sensor_gpio_ring_pop(self->ring, sample);
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of sampling rounds
+
+uint64_t fty_sensor_gpio_sampler_rounds(fty_sensor_gpio_sampler_t* self)
+{
+    assert(self);
+    return self->rounds;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of state changes pushed into the ring
+
+uint64_t fty_sensor_gpio_sampler_changes(fty_sensor_gpio_sampler_t* self)
+{
+    assert(self);
+    return self->changes;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of state changes dropped
+
+uint64_t fty_sensor_gpio_sampler_drops(fty_sensor_gpio_sampler_t* self)
+{
+    assert(self);
+    return self->drops;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of state changes in the ring
+
+size_t fty_sensor_gpio_sampler_depth(fty_sensor_gpio_sampler_t* self)
+{
+    assert(self);
+    return fty_sensor_gpio_ring_depth(self->ring);
+}
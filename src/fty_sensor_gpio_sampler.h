@@ -0,0 +1,63 @@
+/*  =========================================================================
+    fty_sensor_gpio_sampler - GPI sampler thread
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+#include "fty_sensor_gpio_ring.h"
+#include "libgpio.h"
+#include <czmq.h>
+#include <pthread.h>
+
+///  Sampler (opaque), reading GPIs from its own thread, and pushing their
+///  state changes into a ring drained by the server actor
+struct fty_sensor_gpio_sampler_t;
+
+///  Create a sampler, and start its thread, reading the GPIs every interval
+///  (ms), with gpio_lib locked by gpio_mutex, into a ring of depth samples
+fty_sensor_gpio_sampler_t* fty_sensor_gpio_sampler_new(
+    libgpio_t* gpio_lib, pthread_mutex_t* gpio_mutex, int interval, size_t depth);
+
+///  Stop the sampler thread, and destroy the sampler
+void fty_sensor_gpio_sampler_destroy(fty_sensor_gpio_sampler_t** self_p);
+
+///  Set the GPIs to sample. A GPI added is pushed once read, even unchanged
+void fty_sensor_gpio_sampler_set_gpis(fty_sensor_gpio_sampler_t* self, const int* gpis, size_t count);
+
+///  Get the fd, readable when samples were pushed into the ring
+int fty_sensor_gpio_sampler_fd(fty_sensor_gpio_sampler_t* self);
+
+///  Acknowledge the readable fd, before draining the ring
+void fty_sensor_gpio_sampler_acknowledge(fty_sensor_gpio_sampler_t* self);
+
+///  Pop the oldest state change from the ring. Return false if it is empty
+bool fty_sensor_gpio_sampler_pop(fty_sensor_gpio_sampler_t* self, fty_sensor_gpio_sample_t* sample);
+
+///  Get the number of sampling rounds
+uint64_t fty_sensor_gpio_sampler_rounds(fty_sensor_gpio_sampler_t* self);
+
+///  Get the number of state changes pushed into the ring
+uint64_t fty_sensor_gpio_sampler_changes(fty_sensor_gpio_sampler_t* self);
+
+///  Get the number of state changes dropped, since the ring was full. They
+///  are pushed again at the next round
+uint64_t fty_sensor_gpio_sampler_drops(fty_sensor_gpio_sampler_t* self);
+
+///  Get the number of state changes in the ring
+size_t fty_sensor_gpio_sampler_depth(fty_sensor_gpio_sampler_t* self);
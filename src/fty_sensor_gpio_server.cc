@@ -131,17 +131,85 @@ sensor_partnumber/manufacturer/type/normal_state/gpx_direction/alarm_severity/al
 
     REP:
         none
+
+     ------------------------------------------------------------------------
+    ## GPIO_STATS
+
+    REQ:
+        subject: "GPIO_STATS"
+        Message is a multipart std::string message: <zuuid>
+
+              - get the agent internal counters
+
+    REP:
+        subject: "GPIO_STATS"
+        Message is a multipart message:
+
+        * <zuuid>/OK/<name 1>/<value 1>/.../<name N>/<value N>
+
+        where:
+            <zuuid> = info for REST API so it could match response to request
+            <name>  = direction_writes / direction_writes_avoided / pins_quarantined / io_batches
+                      metrics_published / metrics_suppressed / power_activations / sensors_deferred
+                      lock_holds / lock_hold_time_us / lock_hold_max_us
+                      cycles / cycle_overruns / cycles_skipped
+                      cycle_duration/lt_<2^n>ms / cycle_duration/ge_<2^14>ms (check cycles, by duration)
+                      batches_published / batched_metrics / shm_writes / shm_failures
+                      sampler_rounds / sampler_changes / sampler_drops / ring_depth (with a sampler)
+                      ring_depth_max / samples_published / sample_latency_avg_us / sample_latency_max_us
+                      quarantined/<GPI|GPO><n> (value = ms before the next retry)
+                      poll_rate/<asset> / poll_speedups/<asset> / poll_backoffs/<asset>
+                      (adaptive polling effective period in ms, and decisions taken)
+
+     ------------------------------------------------------------------------
+    ## Status metrics
+
+    The sensors status are published according to the publish mode
+    (PUBLISH_MODE command), a comma separated list of:
+
+    * single (default): one fty_proto metric per status, with subject
+      "status.<GPI|GPO><n>@<parent>", on the FTY_PROTO_STREAM_METRICS_SENSOR
+      stream
+    * batched: one message per check cycle, with subject "status-batch",
+      on the same stream, holding one frame per status, each one being an
+      encoded fty_proto metric (fty_proto_decode it as a single frame message)
+    * shm: the "status.<GPI|GPO><n>" metric of the parent asset is written in
+      fty_shm, with the metrics TTL, for local consumers
+
+    "both" stands for "single,batched".
+
+     ------------------------------------------------------------------------
+    ## GPI sampler
+
+    With a sampler (SAMPLER <interval ms> [<depth>] command), the GPIs of the
+    sensors without a power source are read by a dedicated thread at a fixed
+    interval. Their state changes are pushed, timestamped, into a lock-free
+    single producer/single consumer ring of <depth> entries, which the actor
+    drains to publish them, so that a slow publication never delays the
+    sampling. Both share the GPIO library, under a lock held only for the
+    reads and writes. Changes which don't fit in a full ring are pushed again
+    at the next round. Check cycles still run, as a safety sweep, and hand
+    the monitored GPIs over to the sampler.
 @end
 */
 
 #include "fty_sensor_gpio_server.h"
 #include "libgpio.h"
+#include "libgpio_cdev.h"
+#include "libgpio_sim.h"
 #include "fty_sensor_gpio.h"
+#include "fty_sensor_gpio_metric.h"
+#include "fty_sensor_gpio_sampler.h"
+#include "fty_sensor_gpio_wheel.h"
+#include <algorithm>
 #include <fty_log.h>
 #include <fty_proto.h>
+#include <fty_shm.h>
+#include <inttypes.h>
 #include <malamute.h>
 #include <regex>
 #include <stdio.h>
+#include <vector>
 
 // Structure for GPO state
 
@@ -153,16 +221,90 @@ struct gpo_state_t
     int in_alert;
 };
 
+// Structure of a group of sensors powered by the same GPO
+
+struct power_group_t
+{
+    int     gpo_number; // GPO power source of the group
+    bool    powered;    // true once the GPO power source is activated
+    int64_t powered_at; // monotonic time (ms) of the activation, 0 if it was already on
+    int64_t wake_at;    // monotonic time (ms) at which deferred sensors are warmed up, 0 if none
+    bool    due;        // true if the deferred sensors have to be sampled
+};
+
+// Structure of the adaptive polling state of a GPI sensor
+
+struct adaptive_state_t
+{
+    int      poll_rate;  // effective poll period (ms)
+    int64_t  changed_at; // monotonic time (ms) of the last state change, 0 if none
+    int      last_state; // state read at the previous sample
+    uint64_t speedups;   // number of switches to the fast poll rate
+    uint64_t backoffs;   // number of poll rate back offs
+};
+
+// Check cycles durations are counted in power of 2 buckets (ms): the first
+// one for cycles shorter than 1 ms, the last one for cycles of 2^14 ms or more
+
+#define CYCLE_BUCKETS 16
+
+// Status publication modes, which can be combined
+
+#define PUBLISH_SINGLE  1 // one message per status, on "status.<port>@<parent>"
+#define PUBLISH_BATCHED 2 // one message per cycle, on BATCH_SUBJECT
+#define PUBLISH_SHM     4 // status written in fty_shm
+
 //  Structure of our class
 
 struct _fty_sensor_gpio_server_t
 {
-    char*         name;         // actor name
-    mlm_client_t* mlm;          // malamute client
-    libgpio_t*    gpio_lib;     // GPIO library handle
-    bool          test_mode;    // true if we are in test mode, false otherwise
-    char*         template_dir; // Location of the template files
-    zhashx_t*     gpo_states;
+    char*                      name;         // actor name
+    mlm_client_t*              mlm;          // malamute client
+    libgpio_t*                 gpio_lib;     // GPIO library handle
+    bool                       test_mode;    // true if we are in test mode, false otherwise
+    char*                      template_dir; // Location of the template files
+    zhashx_t*                  gpo_states;
+    zhashx_t*                  power_groups;       // groups of sensors, by GPO power source
+    fty_sensor_gpio_wheel_t*   poll_wheel;         // poll timers of the sensors with their own interval, by asset name
+    bool                       adaptive_polling;   // true to adapt the poll rate of the GPIs to their activity
+    int                        adaptive_fast;      // poll period (ms) of the GPIs which just changed
+    int                        adaptive_window;    // time (ms) the GPIs are polled fast after a change
+    int                        adaptive_max;       // poll period (ms) up to which stable GPIs back off
+    zhashx_t*                  adaptive_states;    // adaptive polling state of the GPIs, by asset name
+    bool                       edge_triggered;     // true to monitor GPIs through edge interrupts, false to poll them
+    int*                       edge_fds;           // value fds of the GPIs armed for edge interrupts
+    int*                       edge_gpis;          // GPI number of each armed value fd
+    size_t                     edge_count;         // number of armed GPIs
+    int                        metric_ttl;         // TTL of the published metrics (s)
+    zhashx_t*                  metrics;            // status metric templates of the sensors, by asset name
+    uint64_t                   publish_time;       // time (s) of the metrics published in the current cycle
+    int                        publish_mode;       // PUBLISH_SINGLE, PUBLISH_BATCHED and/or PUBLISH_SHM
+    zmsg_t*                    batch;              // metrics of the current cycle, to publish at once
+    uint64_t                   batches_published;  // number of batches of metrics published
+    uint64_t                   batched_metrics;    // number of metrics published in batches
+    uint64_t                   shm_writes;         // number of metrics written in fty_shm
+    uint64_t                   shm_failures;       // number of metrics which could not be written in fty_shm
+    pthread_mutex_t            gpio_mutex;         // lock of gpio_lib, shared with the sampler thread
+    fty_sensor_gpio_sampler_t* sampler;            // GPI sampler thread, if any
+    size_t                     ring_depth_max;     // most state changes found in the sampler ring at once
+    uint64_t                   samples_published;  // number of sampled state changes published
+    uint64_t                   sample_latency;     // total time (us) from the samples to their publication
+    uint64_t                   sample_latency_max; // longest time (us) from a sample to its publication
+    uint64_t                   metrics_published;  // number of statuses published
+    uint64_t                   metrics_suppressed; // number of unchanged statuses not published
+    uint64_t                   power_activations;  // number of GPO power sources activated
+    uint64_t                   sensors_deferred;   // number of sensor reads deferred until warmed up
+    uint64_t                   lock_holds;         // number of times gpx_list_mutex was held
+    uint64_t                   lock_hold_time;     // total time (us) gpx_list_mutex was held
+    uint64_t                   lock_hold_max;      // longest time (us) gpx_list_mutex was held
+    int                        check_interval;     // period (ms) of the check cycles, 0 if driven by UPDATE
+    int64_t                    next_cycle;         // monotonic deadline (ms) of the next check cycle
+    uint64_t                   cycles;             // number of check cycles run
+    uint64_t                   cycle_overruns;     // number of check cycles which ran past the next deadline
+    uint64_t                   cycles_skipped;     // number of check cycles skipped, due to overruns
+
+    // Check cycles, by duration bucket
+    uint64_t cycle_durations[CYCLE_BUCKETS];
 };
 typedef struct _fty_sensor_gpio_server_t fty_sensor_gpio_server_t;
 
@@ -228,118 +370,946 @@ void publish_status(fty_sensor_gpio_server_t* self, gpx_info_t* sensor, int ttl)
 {
     log_debug("Publishing GPIO sensor %i (%s) status", sensor->gpx_number, sensor->asset_name);
 
-    zhash_t* aux = zhash_new();
-    zhash_autofree(aux);
-    char port[6]; // "GPI" + "xx" + '\0'
-    memset(&port[0], 0, 6);
-    snprintf(&port[0], 6, "GP%c%i", ((sensor->gpx_direction == GPIO_DIRECTION_IN) ? 'I' : 'O'), sensor->gpx_number);
-    zhash_insert(aux, FTY_PROTO_METRICS_SENSOR_AUX_PORT, static_cast<void*>(&port[0]));
-    zhash_insert(aux, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, static_cast<void*>(sensor->asset_name));
-    std::string msg_type = std::string("status.") + &port[0];
-
-    zmsg_t* msg = fty_proto_encode_metric(aux, uint64_t(time(nullptr)), uint32_t(ttl), msg_type.c_str(),
-        sensor->parent, // sensor->asset_name
-        libgpio_get_status_string(sensor->current_state).c_str(), "");
-    zhash_destroy(&aux);
-    if (msg) {
-        std::string topic = msg_type + std::string("@") + sensor->parent;
-        //        "status." + port() + "@" + _location;
+    // The static parts of the metric are built once per sensor
+    fty_sensor_gpio_metric_t* metric =
+        static_cast<fty_sensor_gpio_metric_t*>(zhashx_lookup(self->metrics, sensor->asset_name));
+    if (!metric || !fty_sensor_gpio_metric_matches(metric, sensor)) {
+        metric = fty_sensor_gpio_metric_new(sensor);
+        zhashx_update(self->metrics, sensor->asset_name, metric);
+    }
 
-        log_debug("\tPort: %s, type: %s, status: %s", &port[0], msg_type.c_str(),
-            libgpio_get_status_string(sensor->current_state).c_str());
+    // Local consumers read the latest status from shared memory
+    if (self->publish_mode & PUBLISH_SHM) {
+        if (fty_shm_write_metric(fty_sensor_gpio_metric_name(metric), fty_sensor_gpio_metric_type(metric),
+                libgpio_get_status_name(sensor->current_state), "", ttl) == 0)
+            self->shm_writes++;
+        else {
+            log_debug("failed to write measurement %s in shm", fty_sensor_gpio_metric_topic(metric));
+            self->shm_failures++;
+        }
+    }
+    if (!(self->publish_mode & (PUBLISH_SINGLE | PUBLISH_BATCHED)))
+        return;
 
-        int r = mlm_client_send(self->mlm, topic.c_str(), &msg);
-        if (r != 0)
-            log_debug("failed to send measurement %s result %", topic.c_str(), r);
+    zmsg_t* msg =
+        fty_sensor_gpio_metric_encode(metric, sensor->current_state, self->publish_time, uint32_t(ttl));
+    if (msg) {
+        log_debug("\tType: %s, status: %s", fty_sensor_gpio_metric_type(metric),
+            libgpio_get_status_name(sensor->current_state));
+
+        // Batched metrics are sent at the end of the cycle
+        if (self->publish_mode & PUBLISH_BATCHED) {
+            if (!self->batch)
+                self->batch = zmsg_new();
+            zframe_t* frame =
+                (self->publish_mode & PUBLISH_SINGLE) ? zframe_dup(zmsg_first(msg)) : zmsg_pop(msg);
+            zmsg_append(self->batch, &frame);
+        }
+        if (self->publish_mode & PUBLISH_SINGLE) {
+            int r = mlm_client_send(self->mlm, fty_sensor_gpio_metric_topic(metric), &msg);
+            if (r != 0)
+                log_debug("failed to send measurement %s result %", fty_sensor_gpio_metric_topic(metric), r);
+        }
         zmsg_destroy(&msg);
     }
 }
 
 //  --------------------------------------------------------------------------
-//  Check GPIO status and generate alarms if needed
+//  Parse a publish mode, i.e. a comma separated list of single, batched
+//  (both stands for single,batched) and shm
+//  Return the PUBLISH_xxx flags, or -1 on error
+
+static int s_parse_publish_mode(const char* publish_mode)
+{
+    int               mode = 0;
+    std::stringstream modes(publish_mode);
+    std::string       item;
+    while (std::getline(modes, item, ',')) {
+        if (item == "single")
+            mode |= PUBLISH_SINGLE;
+        else if (item == "batched")
+            mode |= PUBLISH_BATCHED;
+        else if (item == "both")
+            mode |= PUBLISH_SINGLE | PUBLISH_BATCHED;
+        else if (item == "shm")
+            mode |= PUBLISH_SHM;
+        else
+            return -1;
+    }
+    return (mode) ? mode : -1;
+}
 
-static void s_check_gpio_status(fty_sensor_gpio_server_t* self)
+//  --------------------------------------------------------------------------
+//  Publish the metrics batched during the current cycle, if any, at once
+
+static void s_flush_batch(fty_sensor_gpio_server_t* self)
+{
+    if (!self->batch)
+        return;
+
+    size_t count = zmsg_size(self->batch);
+    if (mlm_client_send(self->mlm, BATCH_SUBJECT, &self->batch) == 0) {
+        self->batches_published++;
+        self->batched_metrics += count;
+    } else
+        log_debug("failed to send a batch of %zu measurements", count);
+    zmsg_destroy(&self->batch);
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy a status metric template, as a zhashx destructor
+
+static void s_metric_destroy(void** item)
+{
+    fty_sensor_gpio_metric_destroy(reinterpret_cast<fty_sensor_gpio_metric_t**>(item));
+}
+
+//  --------------------------------------------------------------------------
+//  Drop the status metric templates of the sensors no longer monitored, i.e.
+//  when there are more templates than sensors
+
+static void s_prune_metrics(fty_sensor_gpio_server_t* self, const std::vector<gpx_info_t>& sensors)
+{
+    if (zhashx_size(self->metrics) <= sensors.size())
+        return;
+
+    zhashx_t* monitored = zhashx_new();
+    for (const gpx_info_t& gpx_info : sensors)
+        zhashx_insert(monitored, gpx_info.asset_name, const_cast<char*>(gpx_info.asset_name));
+    std::vector<std::string> gone;
+    void*                    metric = zhashx_first(self->metrics);
+    while (metric) {
+        const char* asset_name = static_cast<const char*>(zhashx_cursor(self->metrics));
+        if (!zhashx_lookup(monitored, asset_name))
+            gone.push_back(asset_name);
+        metric = zhashx_next(self->metrics);
+    }
+    for (const std::string& asset_name : gone)
+        zhashx_delete(self->metrics, asset_name.c_str());
+    zhashx_destroy(&monitored);
+}
+
+//  --------------------------------------------------------------------------
+//  Read a GPx, with the GPIO library locked against the sampler thread
+
+static int s_gpio_read(fty_sensor_gpio_server_t* self, int gpx_number, int direction)
+{
+    pthread_mutex_lock(&self->gpio_mutex);
+    int value = libgpio_read(self->gpio_lib, gpx_number, direction);
+    pthread_mutex_unlock(&self->gpio_mutex);
+    return value;
+}
+
+//  --------------------------------------------------------------------------
+//  Write a GPO, with the GPIO library locked against the sampler thread
+
+static int s_gpio_write(fty_sensor_gpio_server_t* self, int gpo_number, int value)
+{
+    pthread_mutex_lock(&self->gpio_mutex);
+    int rv = libgpio_write(self->gpio_lib, gpo_number, value);
+    pthread_mutex_unlock(&self->gpio_mutex);
+    return rv;
+}
+
+//  --------------------------------------------------------------------------
+//  Check whether the status of a GPIO sensor has to be read: always for GPIs,
+//  and only when no status have been set to GPOs. Otherwise, that reinit GPOs!
+
+static bool s_sensor_needs_read(gpx_info_t* gpx_info)
+{
+    return (gpx_info->gpx_direction != GPIO_DIRECTION_OUT) || (gpx_info->current_state == GPIO_STATE_UNKNOWN);
+}
+
+//  --------------------------------------------------------------------------
+//  Check whether a GPIO sensor is powered by a GPO
+
+static bool s_sensor_has_power_source(gpx_info_t* gpx_info)
+{
+    return gpx_info->power_source && (!streq(gpx_info->power_source, ""));
+}
+
+//  --------------------------------------------------------------------------
+//  Get the group of sensors powered by a GPO, creating it if needed. A new
+//  group GPO is left alone if its last action already opened it
+
+static power_group_t* s_power_group(fty_sensor_gpio_server_t* self, const char* power_source)
+{
+    power_group_t* group = static_cast<power_group_t*>(zhashx_lookup(self->power_groups, power_source));
+    if (group)
+        return group;
+
+    group             = static_cast<power_group_t*>(zmalloc(sizeof(power_group_t)));
+    group->gpo_number = atoi(power_source);
+    gpo_state_t* state = static_cast<gpo_state_t*>(zhashx_first(self->gpo_states));
+    while (state) {
+        if ((state->gpo_number == group->gpo_number) && (state->last_action == GPIO_STATE_OPENED)) {
+            log_debug("GPO power source %s is already activated", power_source);
+            group->powered = true;
+        }
+        state = static_cast<gpo_state_t*>(zhashx_next(self->gpo_states));
+    }
+    zhashx_insert(self->power_groups, power_source, group);
+    return group;
+}
+
+//  --------------------------------------------------------------------------
+//  Track the writes to a GPO which may power a group of sensors, so that it
+//  is activated again if it was closed
+
+static void s_power_group_written(fty_sensor_gpio_server_t* self, int gpo_number, int value)
+{
+    power_group_t* group = static_cast<power_group_t*>(zhashx_first(self->power_groups));
+    while (group) {
+        if ((group->gpo_number == gpo_number) && (group->powered != (value == GPIO_STATE_OPENED))) {
+            group->powered    = (value == GPIO_STATE_OPENED);
+            group->powered_at = zclock_mono();
+        }
+        group = static_cast<power_group_t*>(zhashx_next(self->power_groups));
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Activate the GPO power source of a GPIO sensor, if any, only once for its
+//  whole group. Return true if the sensor is powered and running, and
+//  otherwise defer it, without blocking, until its warm-up time elapsed
+
+static bool s_power_sensor(fty_sensor_gpio_server_t* self, gpx_info_t* gpx_info, int64_t now)
+{
+    if (!s_sensor_has_power_source(gpx_info))
+        return true;
+
+    power_group_t* group = s_power_group(self, gpx_info->power_source);
+    if (!group->powered) {
+        log_debug("Activating GPO power source %s", gpx_info->power_source);
+
+        if (s_gpio_write(self, group->gpo_number, GPIO_STATE_OPENED) != 0) {
+            log_error("Failed to activate GPO power source!");
+            return true;
+        }
+        log_debug("GPO power source successfully activated.");
+        group->powered    = true;
+        group->powered_at = now;
+        self->power_activations++;
+    }
+
+    int64_t ready_at = group->powered_at + gpx_info->warm_up;
+    if (now < ready_at) {
+        log_debug("Deferring GPx sensor '%s' for %" PRIi64 " ms, while it warms up", gpx_info->asset_name,
+            ready_at - now);
+        if ((group->wake_at == 0) || (ready_at < group->wake_at))
+            group->wake_at = ready_at;
+        self->sensors_deferred++;
+        return false;
+    }
+    // Save the current state
+    gpx_info->current_state = gpx_info->normal_state;
+    return true;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the time (ms) before the next deferred sensors are warmed up, or
+//  TIMEOUT_MS if there is none
+
+static int s_power_groups_timeout(fty_sensor_gpio_server_t* self)
+{
+    int64_t        wake_at = 0;
+    power_group_t* group   = static_cast<power_group_t*>(zhashx_first(self->power_groups));
+    while (group) {
+        if ((group->wake_at != 0) && ((wake_at == 0) || (group->wake_at < wake_at)))
+            wake_at = group->wake_at;
+        group = static_cast<power_group_t*>(zhashx_next(self->power_groups));
+    }
+    if (wake_at == 0)
+        return TIMEOUT_MS;
+    return int(std::max(wake_at - zclock_mono(), int64_t(0)));
+}
+
+//  --------------------------------------------------------------------------
+//  Get the poll period (ms) of a GPIO sensor scheduled in the poll wheel,
+//  either its own poll interval or its adaptive poll rate, or 0 if it is
+//  checked at the agent check interval
+
+static int s_sensor_poll_interval(fty_sensor_gpio_server_t* self, const gpx_info_t* gpx_info)
+{
+    if (gpx_info->poll_interval > 0)
+        return gpx_info->poll_interval;
+    if (self->adaptive_polling && (gpx_info->gpx_direction == GPIO_DIRECTION_IN)) {
+        adaptive_state_t* state =
+            static_cast<adaptive_state_t*>(zhashx_lookup(self->adaptive_states, gpx_info->asset_name));
+        return (state) ? state->poll_rate : self->adaptive_fast;
+    }
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Adapt the poll rate of a GPI sensor to its activity, once read: poll it
+//  at the fast rate during the fast window following a state change, and
+//  otherwise back off geometrically, up to the maximum poll period
+
+static void s_adapt_sensor(fty_sensor_gpio_server_t* self, const gpx_info_t* gpx_info, int64_t now)
+{
+    if (!self->adaptive_polling || (gpx_info->poll_interval > 0) ||
+        (gpx_info->gpx_direction != GPIO_DIRECTION_IN) || (gpx_info->current_state == GPIO_STATE_UNKNOWN))
+        return;
+
+    adaptive_state_t* state =
+        static_cast<adaptive_state_t*>(zhashx_lookup(self->adaptive_states, gpx_info->asset_name));
+    if (!state) {
+        state             = static_cast<adaptive_state_t*>(zmalloc(sizeof(adaptive_state_t)));
+        state->poll_rate  = self->adaptive_fast;
+        state->last_state = gpx_info->current_state;
+        zhashx_insert(self->adaptive_states, gpx_info->asset_name, state);
+        return;
+    }
+
+    if (gpx_info->current_state != state->last_state) {
+        state->changed_at = now;
+        if (state->poll_rate != self->adaptive_fast) {
+            state->poll_rate = self->adaptive_fast;
+            state->speedups++;
+            log_debug("GPx sensor '%s' changed, polling it every %i ms", gpx_info->asset_name, state->poll_rate);
+        }
+    } else if (((state->changed_at == 0) || (now - state->changed_at >= self->adaptive_window)) &&
+               (state->poll_rate < self->adaptive_max)) {
+        state->poll_rate = std::min(state->poll_rate * 2, self->adaptive_max);
+        state->backoffs++;
+        log_debug("GPx sensor '%s' is stable, polling it every %i ms", gpx_info->asset_name, state->poll_rate);
+    }
+    state->last_state = gpx_info->current_state;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the time (ms) before the next sensors are due, either warmed up or at
+//  their own poll interval, or TIMEOUT_MS if there is none
+
+static int s_poll_timeout(fty_sensor_gpio_server_t* self)
+{
+    int     timeout  = s_power_groups_timeout(self);
+    int64_t deadline = fty_sensor_gpio_wheel_next_deadline(self->poll_wheel);
+    if ((self->check_interval > 0) && ((deadline == -1) || (self->next_cycle < deadline)))
+        deadline = self->next_cycle;
+    if (deadline != -1) {
+        int wheel_timeout = int(std::max(deadline - zclock_mono(), int64_t(0)));
+        if ((timeout == TIMEOUT_MS) || (wheel_timeout < timeout))
+            timeout = wheel_timeout;
+    }
+    return timeout;
+}
+
+//  --------------------------------------------------------------------------
+//  Prepare a GPIO sensor prior to reading its status
+//  Return true if its status has to be read
+
+static bool s_prepare_sensor(fty_sensor_gpio_server_t* self, gpx_info_t* gpx_info)
+{
+    log_debug("Checking status of GPx sensor '%s'", gpx_info->asset_name);
+
+    // get the correct GPO status if applicable
+    gpo_state_t* state =
+        static_cast<gpo_state_t*>(zhashx_lookup(self->gpo_states, static_cast<void*>(gpx_info->asset_name)));
+    if ((state && (gpx_info->current_state == GPIO_STATE_UNKNOWN))) {
+        gpx_info->current_state = state->last_action;
+        log_debug("changed GPO state from GPIO_STATE_UNKNOWN to %s",
+            libgpio_get_status_string(gpx_info->current_state).c_str());
+    }
+
+    return s_sensor_needs_read(gpx_info);
+}
+
+//  --------------------------------------------------------------------------
+//  Publish the status of a GPIO sensor when it changed, and otherwise only
+//  refresh it at half its TTL, so that it never expires
+
+static void s_publish_sensor(fty_sensor_gpio_server_t* self, gpx_info_t* gpx_info)
+{
+    int64_t now = zclock_mono();
+    if ((gpx_info->current_state == gpx_info->published_state) &&
+        (now - gpx_info->published_at < int64_t(self->metric_ttl) * 1000 / 2)) {
+        self->metrics_suppressed++;
+        return;
+    }
+    publish_status(self, gpx_info, self->metric_ttl);
+    gpx_info->published_state = gpx_info->current_state;
+    gpx_info->published_at    = now;
+    self->metrics_published++;
+}
+
+//  --------------------------------------------------------------------------
+//  Update the status of a GPIO sensor with the value read, if any, and
+//  publish it
+
+static void s_update_sensor(fty_sensor_gpio_server_t* self, gpx_info_t* gpx_info, bool read, int value)
+{
+    if (read) {
+        gpx_info->current_state = value;
+        gpo_state_t* state =
+            static_cast<gpo_state_t*>(zhashx_lookup(self->gpo_states, static_cast<void*>(gpx_info->asset_name)));
+        if (state)
+            state->last_action = gpx_info->current_state;
+    }
+    if (gpx_info->current_state == GPIO_STATE_UNKNOWN) {
+        log_error("Can't read GPx sensor #%i status", gpx_info->gpx_number);
+    } else {
+        log_debug("Read '%s' (value: %i) on GPx sensor #%i (%s/%s)",
+            libgpio_get_status_string(gpx_info->current_state).c_str(), gpx_info->current_state, gpx_info->gpx_number,
+            gpx_info->ext_name, gpx_info->asset_name);
+
+        s_publish_sensor(self, gpx_info);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Check the status of a single GPIO sensor and publish it
+//  Return true if its status was read
+
+static bool s_check_sensor(fty_sensor_gpio_server_t* self, gpx_info_t* gpx_info)
+{
+    // A deferred sensor is checked once warmed up
+    if (!s_power_sensor(self, gpx_info, zclock_mono()))
+        return false;
+
+    bool read  = s_prepare_sensor(self, gpx_info);
+    int  value = (read) ? s_gpio_read(self, gpx_info->gpx_number, gpx_info->gpx_direction)
+                        : GPIO_STATE_UNKNOWN;
+    s_update_sensor(self, gpx_info, read, value);
+    return read;
+}
+
+//  --------------------------------------------------------------------------
+//  Arm edge interrupts on all monitored GPIs, so that their value changes
+//  are signaled on their value fd
+
+static void s_arm_edges(fty_sensor_gpio_server_t* self, const std::vector<gpx_info_t>& sensors)
+{
+    size_t size      = sensors.size();
+    self->edge_fds   = static_cast<int*>(realloc(self->edge_fds, size * sizeof(int)));
+    self->edge_gpis  = static_cast<int*>(realloc(self->edge_gpis, size * sizeof(int)));
+    self->edge_count = 0;
+
+    for (const gpx_info_t& gpx_info : sensors) {
+        if (gpx_info.gpx_direction == GPIO_DIRECTION_IN) {
+            // Several sensors may share the same GPI
+            bool armed = false;
+            for (size_t i = 0; i < self->edge_count; i++)
+                armed = armed || (self->edge_gpis[i] == gpx_info.gpx_number);
+
+            pthread_mutex_lock(&self->gpio_mutex);
+            bool edge_set = !armed && (libgpio_set_edge(self->gpio_lib, gpx_info.gpx_number, GPIO_EDGE_BOTH) == 0);
+            int  edge_fd  = (edge_set) ? libgpio_get_value_fd(self->gpio_lib, gpx_info.gpx_number) : -1;
+            pthread_mutex_unlock(&self->gpio_mutex);
+            if (edge_set) {
+                self->edge_fds[self->edge_count]  = edge_fd;
+                self->edge_gpis[self->edge_count] = gpx_info.gpx_number;
+                self->edge_count++;
+            } else if (!armed)
+                log_warning("Can't arm edge on GPI #%i, relying on polling", gpx_info.gpx_number);
+        }
+    }
+    log_debug("%zu GPI(s) armed for edge interrupts", self->edge_count);
+}
+
+//  --------------------------------------------------------------------------
+//  Check that the GPIs armed for edge interrupts are still armed on their
+//  polled value fd. Read failures, circuit breaker trips, pin map rebuilds
+//  and backend changes close the pin sessions, and a reopened session has no
+//  edge set: re-arm these GPIs, or drop the ones which can't be re-armed, so
+//  that no closed (or reused) fd is polled. The dropped GPIs rely on polling
+//  until the next full check cycle arms them again
+
+static void s_check_edges(fty_sensor_gpio_server_t* self)
+{
+    size_t kept = 0;
+    pthread_mutex_lock(&self->gpio_mutex);
+    for (size_t i = 0; i < self->edge_count; i++) {
+        int gpi_number = self->edge_gpis[i];
+        int edge_fd    = libgpio_get_value_fd(self->gpio_lib, gpi_number);
+        if ((edge_fd == -1) || (edge_fd != self->edge_fds[i]) ||
+            (libgpio_get_edge(self->gpio_lib, gpi_number) != GPIO_EDGE_BOTH)) {
+            bool edge_set = (libgpio_set_edge(self->gpio_lib, gpi_number, GPIO_EDGE_BOTH) == 0);
+            edge_fd       = (edge_set) ? libgpio_get_value_fd(self->gpio_lib, gpi_number) : -1;
+            if (edge_fd == -1) {
+                log_warning("Can't re-arm edge on GPI #%i, relying on polling", gpi_number);
+                continue;
+            }
+            log_debug("GPI #%i re-armed for edge interrupts", gpi_number);
+        }
+        self->edge_fds[kept]  = edge_fd;
+        self->edge_gpis[kept] = gpi_number;
+        kept++;
+    }
+    pthread_mutex_unlock(&self->gpio_mutex);
+    self->edge_count = kept;
+}
+
+//  --------------------------------------------------------------------------
+//  Lock gpx_list_mutex, and return the time (us) at which it was acquired
+
+static int64_t s_lock_sensors(fty_sensor_gpio_server_t* /*self*/)
 {
     pthread_mutex_lock(&gpx_list_mutex);
+    return zclock_usecs();
+}
 
-    // number of sensors monitored in gpx_list
-    zlistx_t* gpx_list = get_gpx_list();
+//  --------------------------------------------------------------------------
+//  Unlock gpx_list_mutex, and account how long it was held
+
+static void s_unlock_sensors(fty_sensor_gpio_server_t* self, int64_t locked_at)
+{
+    uint64_t hold_time = uint64_t(zclock_usecs() - locked_at);
+    pthread_mutex_unlock(&gpx_list_mutex);
+
+    self->lock_holds++;
+    self->lock_hold_time += hold_time;
+    if (hold_time > self->lock_hold_max)
+        self->lock_hold_max = hold_time;
+}
+
+//  --------------------------------------------------------------------------
+//  Copy the monitored sensors, or only the ones attached to a GPI if
+//  gpi_number is not -1, or whose asset name is in asset_names if not NULL,
+//  in a short critical section. Only the descriptors needed to check and
+//  publish a sensor are copied, so that all the GPIO accesses and
+//  publications are done on the copies without holding gpx_list_mutex.
+//  Return false if the GPx list isn't initialized
+
+static bool s_copy_sensors(fty_sensor_gpio_server_t* self, std::vector<gpx_info_t>& sensors, int gpi_number = -1,
+    zhashx_t* asset_names = nullptr)
+{
+    int64_t   locked_at = s_lock_sensors(self);
+    zlistx_t* gpx_list  = get_gpx_list();
     if (!gpx_list) {
+        s_unlock_sensors(self, locked_at);
+        return false;
+    }
+
+    sensors.reserve(zlistx_size(gpx_list));
+    gpx_info_t* gpx_info = static_cast<gpx_info_t*>(zlistx_first(gpx_list));
+    while (gpx_info) {
+        if (((gpi_number == -1) ||
+                ((gpx_info->gpx_direction == GPIO_DIRECTION_IN) && (gpx_info->gpx_number == gpi_number))) &&
+            (!asset_names || zhashx_lookup(asset_names, gpx_info->asset_name))) {
+            gpx_info_t copy     = *gpx_info;
+            copy.manufacturer   = nullptr;
+            copy.asset_name     = strdup(gpx_info->asset_name);
+            copy.ext_name       = (gpx_info->ext_name) ? strdup(gpx_info->ext_name) : nullptr;
+            copy.part_number    = nullptr;
+            copy.type           = nullptr;
+            copy.parent         = (gpx_info->parent) ? strdup(gpx_info->parent) : nullptr;
+            copy.location       = nullptr;
+            copy.power_source   = (gpx_info->power_source) ? strdup(gpx_info->power_source) : nullptr;
+            copy.alarm_message  = nullptr;
+            copy.alarm_severity = nullptr;
+            sensors.push_back(copy);
+        }
+        gpx_info = static_cast<gpx_info_t*>(zlistx_next(gpx_list));
+    }
+    s_unlock_sensors(self, locked_at);
+    return true;
+}
+
+//  --------------------------------------------------------------------------
+//  Merge the states of the checked sensor copies back into the monitored
+//  sensors, by asset name, and destroy the copies. Sensors deleted or moved
+//  to another GPx in the meantime are left alone
+
+static void s_merge_sensors(fty_sensor_gpio_server_t* self, std::vector<gpx_info_t>& sensors)
+{
+    int64_t locked_at = s_lock_sensors(self);
+    for (gpx_info_t& copy : sensors) {
+        gpx_info_t* gpx_info = get_gpx_info(copy.asset_name);
+        if (gpx_info && (copy.gpx_number == gpx_info->gpx_number) && (copy.gpx_direction == gpx_info->gpx_direction)) {
+            gpx_info->current_state   = copy.current_state;
+            gpx_info->published_state = copy.published_state;
+            gpx_info->published_at    = copy.published_at;
+        }
+    }
+    s_unlock_sensors(self, locked_at);
+
+    for (gpx_info_t& copy : sensors) {
+        zstr_free(&copy.asset_name);
+        zstr_free(&copy.ext_name);
+        zstr_free(&copy.parent);
+        zstr_free(&copy.power_source);
+    }
+    sensors.clear();
+}
+
+//  --------------------------------------------------------------------------
+//  Hand the GPIs of the monitored sensors over to the sampler. GPIs of the
+//  sensors with a power source are left to the check cycles, which power them
+
+static void s_update_sampler_gpis(fty_sensor_gpio_server_t* self, std::vector<gpx_info_t>& sensors)
+{
+    std::vector<int> gpis;
+    for (gpx_info_t& gpx_info : sensors) {
+        if ((gpx_info.gpx_direction == GPIO_DIRECTION_IN) && !s_sensor_has_power_source(&gpx_info))
+            gpis.push_back(gpx_info.gpx_number);
+    }
+    std::sort(gpis.begin(), gpis.end());
+    gpis.erase(std::unique(gpis.begin(), gpis.end()), gpis.end());
+    fty_sensor_gpio_sampler_set_gpis(self->sampler, gpis.data(), gpis.size());
+}
+
+//  --------------------------------------------------------------------------
+//  Forget the adaptive poll states of the scheduled sensors no longer
+//  monitored, i.e. the ones still in scheduled
+
+static void s_forget_scheduled(fty_sensor_gpio_server_t* self, zhashx_t* scheduled)
+{
+    char* asset_name = static_cast<char*>(zhashx_first(scheduled));
+    while (asset_name) {
+        zhashx_delete(self->adaptive_states, asset_name);
+        asset_name = static_cast<char*>(zhashx_next(scheduled));
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Check GPIO status and generate alarms if needed
+//  If deferred_only is true, only the sensors of the power groups which are
+//  due, i.e. warmed up, are checked. If scheduled is not NULL, only the
+//  sensors with their own poll interval whose asset name is in it are
+//  checked, and scheduled again. Otherwise, the sensors with their own poll
+//  interval, or polled adaptively, are left to the poll wheel
+
+static void s_check_gpio_status(
+    fty_sensor_gpio_server_t* self, bool deferred_only = false, zhashx_t* scheduled = nullptr)
+{
+    std::vector<gpx_info_t> sensors;
+    if (!s_copy_sensors(self, sensors, -1, scheduled)) {
         log_debug("GPx list not initialized, skipping");
-        pthread_mutex_unlock(&gpx_list_mutex);
         return;
     }
-    int          sensors_count = int(zlistx_size(gpx_list));
-    gpx_info_t* gpx_info      = nullptr;
 
-    if (sensors_count == 0) {
+    // number of sensors monitored in gpx_list
+    if (sensors.empty()) {
         log_debug("No sensors monitored");
-        pthread_mutex_unlock(&gpx_list_mutex);
+        // Stop watching and sampling the GPIs of the sensors deleted since
+        // the last sweep
+        if (self->edge_triggered && !scheduled)
+            s_arm_edges(self, sensors);
+        if (self->sampler && !deferred_only && !scheduled)
+            s_update_sampler_gpis(self, sensors);
+        if (scheduled)
+            s_forget_scheduled(self, scheduled);
         return;
     } else
-        log_debug("%i sensor(s) monitored", sensors_count);
+        log_debug("%zu sensor(s) monitored", sensors.size());
 
     if (!mlm_client_connected(self->mlm)) {
-        pthread_mutex_unlock(&gpx_list_mutex);
+        s_merge_sensors(self, sensors);
         return;
     }
 
-    // Acquire the current sensor
-    gpx_info = static_cast<gpx_info_t*>(zlistx_first(gpx_list));
+    // All the statuses of a cycle are published with the same timestamp
+    self->publish_time = uint64_t(time(nullptr));
+    if (!deferred_only && !scheduled)
+        s_prune_metrics(self, sensors);
+
+    // Power all sensors, and select the GPx of the ones powered and running
+    // to read in this cycle snapshot. Sensors still warming up are deferred
+    int64_t             now      = zclock_mono();
+    std::vector<bool>   checked;
+    libgpio_snapshot_t* snapshot = libgpio_snapshot_new(self->gpio_lib);
+    for (gpx_info_t& gpx_info : sensors) {
+        bool check = true;
+        if (deferred_only) {
+            power_group_t* group = (s_sensor_has_power_source(&gpx_info))
+                ? static_cast<power_group_t*>(zhashx_lookup(self->power_groups, gpx_info.power_source))
+                : nullptr;
+            check = group && group->due;
+        } else if (!scheduled && (s_sensor_poll_interval(self, &gpx_info) > 0)) {
+            if (fty_sensor_gpio_wheel_deadline(self->poll_wheel, gpx_info.asset_name) == -1)
+                fty_sensor_gpio_wheel_schedule(self->poll_wheel, gpx_info.asset_name, now);
+            check = false;
+        }
+        check = check && s_power_sensor(self, &gpx_info, now);
+        if (check && s_prepare_sensor(self, &gpx_info))
+            libgpio_snapshot_select(snapshot, gpx_info.gpx_number, gpx_info.gpx_direction);
+        checked.push_back(check);
+    }
 
-    // Loop on all sensors
-    for (int cur_sensor_num = 0; cur_sensor_num < sensors_count; cur_sensor_num++) {
+    // Take a consistent point-in-time view of all the selected GPx
+    pthread_mutex_lock(&self->gpio_mutex);
+    libgpio_read_all(self->gpio_lib, snapshot);
+    pthread_mutex_unlock(&self->gpio_mutex);
+
+    // Then update and publish all checked sensors from the snapshot
+    for (size_t index = 0; index < sensors.size(); index++) {
+        gpx_info_t* gpx_info = &sensors[index];
+        bool        read     = s_sensor_needs_read(gpx_info);
+        if (checked[index]) {
+            s_update_sensor(self, gpx_info, read,
+                (read) ? libgpio_snapshot_get(snapshot, gpx_info->gpx_number, gpx_info->gpx_direction)
+                       : GPIO_STATE_UNKNOWN);
+            s_adapt_sensor(self, gpx_info, now);
+        }
+    }
+    libgpio_snapshot_destroy(&snapshot);
+    s_flush_batch(self);
 
-        // No processing if not yet init'ed
-        if (gpx_info) {
+    power_group_t* group = static_cast<power_group_t*>(zhashx_first(self->power_groups));
+    while (group) {
+        group->due = false;
+        group = static_cast<power_group_t*>(zhashx_next(self->power_groups));
+    }
 
-            log_debug("Checking status of GPx sensor '%s'", gpx_info->asset_name);
+    // Sensors no longer monitored, or without their own poll interval
+    // anymore, are not scheduled again
+    if (scheduled) {
+        for (const gpx_info_t& gpx_info : sensors) {
+            int poll_interval = s_sensor_poll_interval(self, &gpx_info);
+            if (poll_interval > 0)
+                fty_sensor_gpio_wheel_schedule(self->poll_wheel, gpx_info.asset_name, now + poll_interval);
+            zhashx_delete(scheduled, gpx_info.asset_name);
+        }
+        // The remaining ones are gone
+        s_forget_scheduled(self, scheduled);
+    }
 
-            // If there is a GPO power source, then activate it prior to
-            // accessing the GPI!
-            if (gpx_info->power_source && (!streq(gpx_info->power_source, ""))) {
-                log_debug("Activating GPO power source %s", gpx_info->power_source);
+    // In edge triggered mode, this cycle is a safety sweep, which also arms
+    // the newly monitored GPIs. Scheduled checks only see a few sensors, and
+    // leave the armed GPIs alone
+    if (self->edge_triggered && !deferred_only && !scheduled)
+        s_arm_edges(self, sensors);
 
-                if (libgpio_write(self->gpio_lib, atoi(gpx_info->power_source), GPIO_STATE_OPENED) != 0) {
-                    log_error("Failed to activate GPO power source!");
-                } else {
-                    log_debug("GPO power source successfully activated.");
-                    // Save the current state
-                    gpx_info->current_state = gpx_info->normal_state;
-                    // Sleep for a second to have the GPx sensor powered and running
-                    zclock_sleep(1000);
-                }
-            }
+    // Likewise with a sampler, which is handed over the monitored GPIs
+    if (self->sampler && !deferred_only && !scheduled)
+        s_update_sampler_gpis(self, sensors);
 
-            // get the correct GPO status if applicable
-            gpo_state_t* state =
-                static_cast<gpo_state_t*>(zhashx_lookup(self->gpo_states, static_cast<void*>(gpx_info->asset_name)));
-            if ((state && (gpx_info->current_state == GPIO_STATE_UNKNOWN))) {
-                gpx_info->current_state = state->last_action;
-                log_debug("changed GPO state from GPIO_STATE_UNKNOWN to %s",
-                    libgpio_get_status_string(gpx_info->current_state).c_str());
-            }
+    s_merge_sensors(self, sensors);
+}
 
-            // Get the current sensor status, only for GPIs, or when no status
-            // have been set to GPOs. Otherwise, that reinit GPOs!
-            if ((gpx_info->gpx_direction != GPIO_DIRECTION_OUT) || (gpx_info->current_state == GPIO_STATE_UNKNOWN)) {
-                gpx_info->current_state = libgpio_read(self->gpio_lib, gpx_info->gpx_number, gpx_info->gpx_direction);
-                if (state)
-                    state->last_action = gpx_info->current_state;
-            }
-            if (gpx_info->current_state == GPIO_STATE_UNKNOWN) {
-                log_error("Can't read GPx sensor #%i status", gpx_info->gpx_number);
-            } else {
-                log_debug("Read '%s' (value: %i) on GPx sensor #%i (%s/%s)",
-                    libgpio_get_status_string(gpx_info->current_state).c_str(), gpx_info->current_state,
-                    gpx_info->gpx_number, gpx_info->ext_name, gpx_info->asset_name);
+//  --------------------------------------------------------------------------
+//  Check the sensors of the power groups which are now warmed up, at once
 
-                publish_status(self, gpx_info, 300);
-            }
+static void s_check_power_groups(fty_sensor_gpio_server_t* self)
+{
+    bool           due   = false;
+    int64_t        now   = zclock_mono();
+    power_group_t* group = static_cast<power_group_t*>(zhashx_first(self->power_groups));
+    while (group) {
+        if ((group->wake_at != 0) && (group->wake_at <= now)) {
+            group->wake_at = 0;
+            group->due     = true;
+            due            = true;
         }
-        gpx_info = static_cast<gpx_info_t*>(zlistx_next(gpx_list));
+        group = static_cast<power_group_t*>(zhashx_next(self->power_groups));
+    }
+    if (due)
+        s_check_gpio_status(self, true);
+}
+
+//  --------------------------------------------------------------------------
+//  Check the sensors whose own poll interval elapsed, at once
+
+static void s_check_scheduled_sensors(fty_sensor_gpio_server_t* self)
+{
+    zlistx_t* expired = zlistx_new();
+    zlistx_set_destructor(expired, free_fn);
+    if (fty_sensor_gpio_wheel_expire(self->poll_wheel, zclock_mono(), expired) > 0) {
+        zhashx_t* scheduled = zhashx_new();
+        char*     key       = static_cast<char*>(zlistx_first(expired));
+        while (key) {
+            zhashx_insert(scheduled, key, key);
+            key = static_cast<char*>(zlistx_next(expired));
+        }
+        s_check_gpio_status(self, false, scheduled);
+        zhashx_destroy(&scheduled);
+    }
+    zlistx_destroy(&expired);
+}
+
+//  --------------------------------------------------------------------------
+//  Run a check cycle of all the sensors, and account its duration
+//  Return the monotonic time (ms) at which the cycle ended
+
+static int64_t s_check_cycle(fty_sensor_gpio_server_t* self)
+{
+    int64_t started_at = zclock_usecs();
+    s_check_gpio_status(self);
+    int64_t ended_at = zclock_usecs();
+
+    int64_t duration = (ended_at - started_at) / 1000;
+    int     bucket   = 0;
+    while ((bucket < CYCLE_BUCKETS - 1) && (duration >= (int64_t(1) << bucket)))
+        bucket++;
+    self->cycle_durations[bucket]++;
+    self->cycles++;
+    return zclock_mono();
+}
+
+//  --------------------------------------------------------------------------
+//  Run the check cycle once its deadline is reached. Deadlines stay on the
+//  grid of the check interval, so that the sampling is phase stable, and the
+//  cycles whose deadline already passed when the previous one ends are
+//  skipped and counted, rather than run late back to back
+
+static void s_check_scheduled_cycle(fty_sensor_gpio_server_t* self)
+{
+    if ((self->check_interval == 0) || (zclock_mono() < self->next_cycle))
+        return;
+
+    int64_t ended_at = s_check_cycle(self);
+    self->next_cycle += self->check_interval;
+    if (ended_at >= self->next_cycle) {
+        int64_t skipped = (ended_at - self->next_cycle) / self->check_interval + 1;
+        self->next_cycle += skipped * self->check_interval;
+        self->cycle_overruns++;
+        self->cycles_skipped += uint64_t(skipped);
+        log_warning("%s:\tCheck cycle overran its %i ms interval, %" PRIi64 " cycle(s) skipped", self->name,
+            self->check_interval, skipped);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Handle an edge interrupt on a GPI: check and publish the status of the
+//  sensors attached to it
+
+static void s_handle_edge(fty_sensor_gpio_server_t* self, int gpi_number)
+{
+    bool handled = false;
+
+    std::vector<gpx_info_t> sensors;
+    if (mlm_client_connected(self->mlm) && s_copy_sensors(self, sensors, gpi_number)) {
+        self->publish_time = uint64_t(time(nullptr));
+        for (gpx_info_t& gpx_info : sensors) {
+            if (!s_check_sensor(self, &gpx_info))
+                continue;
+            handled = true;
+            // Poll the sensor fast from now on, if adaptive
+            s_adapt_sensor(self, &gpx_info, zclock_mono());
+            int poll_interval = s_sensor_poll_interval(self, &gpx_info);
+            if ((gpx_info.poll_interval == 0) && (poll_interval > 0))
+                fty_sensor_gpio_wheel_schedule(
+                    self->poll_wheel, gpx_info.asset_name, zclock_mono() + poll_interval);
+        }
+        s_flush_batch(self);
+        s_merge_sensors(self, sensors);
+    }
+
+    // Acknowledge the interrupt anyway, by reading the value
+    if (!handled)
+        s_gpio_read(self, gpi_number, GPIO_DIRECTION_IN);
+
+    // The kernel timestamp, when known, is only available once acknowledged
+    pthread_mutex_lock(&self->gpio_mutex);
+    int64_t timestamp = libgpio_get_edge_timestamp(self->gpio_lib, gpi_number);
+    pthread_mutex_unlock(&self->gpio_mutex);
+    if (timestamp != 0)
+        log_debug("Edge interrupt on GPI #%i (at %" PRIi64 ".%09" PRIi64 ")", gpi_number, timestamp / 1000000000,
+            timestamp % 1000000000);
+    else
+        log_debug("Edge interrupt on GPI #%i", gpi_number);
+}
+
+//  --------------------------------------------------------------------------
+//  Drain the sampler ring, and publish the status of the sensors attached to
+//  the GPIs which changed
+
+static void s_handle_samples(fty_sensor_gpio_server_t* self)
+{
+    fty_sensor_gpio_sampler_acknowledge(self->sampler);
+    self->ring_depth_max = std::max(self->ring_depth_max, fty_sensor_gpio_sampler_depth(self->sampler));
+
+    std::vector<fty_sensor_gpio_sample_t> samples;
+    fty_sensor_gpio_sample_t              sample;
+    while (fty_sensor_gpio_sampler_pop(self->sampler, &sample))
+        samples.push_back(sample);
+    if (samples.empty())
+        return;
+
+    std::vector<gpx_info_t> sensors;
+    if (!mlm_client_connected(self->mlm) || !s_copy_sensors(self, sensors))
+        return;
+
+    self->publish_time = uint64_t(time(nullptr));
+    int64_t now        = zclock_mono();
+    for (const fty_sensor_gpio_sample_t& changed : samples) {
+        for (gpx_info_t& gpx_info : sensors) {
+            if ((gpx_info.gpx_direction != GPIO_DIRECTION_IN) || (gpx_info.gpx_number != changed.gpx_number) ||
+                s_sensor_has_power_source(&gpx_info))
+                continue;
+            s_update_sensor(self, &gpx_info, true, changed.state);
+            s_adapt_sensor(self, &gpx_info, now);
+        }
+    }
+    s_flush_batch(self);
+    s_merge_sensors(self, sensors);
+
+    // Latency from the sampling to the publication
+    int64_t published_at = zclock_usecs();
+    for (const fty_sensor_gpio_sample_t& changed : samples) {
+        uint64_t latency = uint64_t(std::max(published_at - changed.sampled_at, int64_t(0)));
+        self->sample_latency += latency;
+        self->sample_latency_max = std::max(self->sample_latency_max, latency);
+        self->samples_published++;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Add a counter to a GPIO_STATS reply, as a name/value pair
+
+static void s_add_stat(zmsg_t* reply, const char* name, uint64_t value)
+{
+    zmsg_addstr(reply, name);
+    zmsg_addstrf(reply, "%" PRIu64, value);
+}
+
+//  --------------------------------------------------------------------------
+//  Add the check cycles duration histogram to a GPIO_STATS reply
+
+static void s_add_cycle_stats(fty_sensor_gpio_server_t* self, zmsg_t* reply)
+{
+    for (int bucket = 0; bucket < CYCLE_BUCKETS; bucket++) {
+        char* name = (bucket < CYCLE_BUCKETS - 1)
+                         ? zsys_sprintf("cycle_duration/lt_%" PRIi64 "ms", int64_t(1) << bucket)
+                         : zsys_sprintf("cycle_duration/ge_%" PRIi64 "ms", int64_t(1) << (bucket - 1));
+        s_add_stat(reply, name, self->cycle_durations[bucket]);
+        zstr_free(&name);
     }
-    pthread_mutex_unlock(&gpx_list_mutex);
+}
+
+//  --------------------------------------------------------------------------
+//  Add the adaptive polling rate and decisions of each GPI to a GPIO_STATS
+//  reply
+
+static void s_add_adaptive_stats(fty_sensor_gpio_server_t* self, zmsg_t* reply)
+{
+    adaptive_state_t* state = static_cast<adaptive_state_t*>(zhashx_first(self->adaptive_states));
+    while (state) {
+        const char* asset_name = static_cast<const char*>(zhashx_cursor(self->adaptive_states));
+        char*       name       = zsys_sprintf("poll_rate/%s", asset_name);
+        s_add_stat(reply, name, uint64_t(state->poll_rate));
+        zstr_free(&name);
+        name = zsys_sprintf("poll_speedups/%s", asset_name);
+        s_add_stat(reply, name, state->speedups);
+        zstr_free(&name);
+        name = zsys_sprintf("poll_backoffs/%s", asset_name);
+        s_add_stat(reply, name, state->backoffs);
+        zstr_free(&name);
+        state = static_cast<adaptive_state_t*>(zhashx_next(self->adaptive_states));
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Add the GPx quarantined by their circuit breaker to a GPIO_STATS reply
+
+static void s_add_quarantined_stats(fty_sensor_gpio_server_t* self, zmsg_t* reply)
+{
+    pthread_mutex_lock(&self->gpio_mutex);
+    for (int direction = GPIO_DIRECTION_IN; direction <= GPIO_DIRECTION_OUT; direction++) {
+        int count = (direction == GPIO_DIRECTION_IN) ? libgpio_get_gpi_count() : libgpio_get_gpo_count();
+        for (int gpx_number = 1; gpx_number <= count; gpx_number++) {
+            int64_t retry_in = 0;
+            if (libgpio_get_breaker_state(self->gpio_lib, gpx_number, direction, &retry_in) != GPIO_BREAKER_OPEN)
+                continue;
+            char* name = zsys_sprintf(
+                "quarantined/%s%d", (direction == GPIO_DIRECTION_IN) ? "GPI" : "GPO", gpx_number);
+            s_add_stat(reply, name, uint64_t(retry_in));
+            zstr_free(&name);
+        }
+    }
+    pthread_mutex_unlock(&self->gpio_mutex);
 }
 
 //  --------------------------------------------------------------------------
@@ -367,7 +1337,7 @@ void static s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t* message)
     // we assume all request command are MAILBOX DELIVER, and subject="gpio"
     if ((subject != "") && (subject != "GPO_INTERACTION") && (subject != "GPIO_TEMPLATE_ADD") &&
         (subject != "GPIO_MANIFEST") && (subject != "GPIO_MANIFEST_SUMMARY") && (subject != "GPIO_TEST") &&
-        (subject != "GPOSTATE") && (subject != "ERROR")) {
+        (subject != "GPOSTATE") && (subject != "GPIO_STATS") && (subject != "ERROR")) {
         log_warning("%s: Received unexpected subject '%s' from '%s'", self->name, subject.c_str(),
             mlm_client_sender(self->mlm));
         zmsg_t* reply = zmsg_new();
@@ -386,27 +1356,21 @@ void static s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t* message)
             char* sensor_name = zmsg_popstr(message);
             char* action_name = zmsg_popstr(message);
             log_debug("GPO_INTERACTION: do '%s' on '%s'", action_name, sensor_name);
-            // Get the GPO entry for details
-            pthread_mutex_lock(&gpx_list_mutex);
-            zlistx_t* gpx_list = get_gpx_list();
-            if (gpx_list) {
-                int          sensors_count = int(zlistx_size(gpx_list));
-                gpx_info_t* gpx_info      = static_cast<gpx_info_t*>(zlistx_first(gpx_list));
-                gpx_info                   = static_cast<gpx_info_t*>(zlistx_next(gpx_list));
-                for (int cur_sensor_num = 0; cur_sensor_num < sensors_count; cur_sensor_num++) {
-                    // Check both asset and ext name
-                    if (gpx_info && gpx_info->asset_name && gpx_info->ext_name) {
-                        log_debug("GPO_INTERACTION: checking sensor %s/%s", gpx_info->asset_name, gpx_info->ext_name);
-                        if (streq(gpx_info->asset_name, sensor_name) || streq(gpx_info->ext_name, sensor_name)) {
-                            break;
-                        }
-                    }
-                    gpx_info = static_cast<gpx_info_t*>(zlistx_next(gpx_list));
-                }
-                if ((gpx_info) && (gpx_info->gpx_direction == GPIO_DIRECTION_OUT) &&
-                    ((streq(gpx_info->asset_name, sensor_name)) || streq(gpx_info->ext_name, sensor_name))) {
-                    int status_value  = libgpio_get_status_value(action_name);
-                    int current_state = gpx_info->current_state;
+            // Get the GPO entry for details, by asset or ext name, and copy
+            // what is needed to act on it, so that the GPO is written without
+            // holding gpx_list_mutex
+            int64_t     locked_at     = s_lock_sensors(self);
+            bool        initialized   = (get_gpx_list() != nullptr);
+            gpx_info_t* gpx_info      = (initialized && sensor_name) ? get_gpx_info_by_name(sensor_name) : nullptr;
+            bool        found         = (gpx_info) && (gpx_info->gpx_direction == GPIO_DIRECTION_OUT);
+            int         gpo_number    = (found) ? gpx_info->gpx_number : -1;
+            int         current_state = (found) ? gpx_info->current_state : GPIO_STATE_UNKNOWN;
+            char*       asset_name    = (found) ? strdup(gpx_info->asset_name) : nullptr;
+            s_unlock_sensors(self, locked_at);
+
+            if (initialized) {
+                if (found) {
+                    int status_value = libgpio_get_status_value(action_name);
 
                     if (status_value != GPIO_STATE_UNKNOWN) {
                         // check whether this action is allowed in this state
@@ -417,17 +1381,25 @@ void static s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t* message)
                             zmsg_addstr(reply, "ERROR");
                             zmsg_addstr(reply, "ACTION_NOT_APPLICABLE");
                         } else {
-                            if (libgpio_write(self->gpio_lib, gpx_info->gpx_number, status_value) != 0) {
+                            if (s_gpio_write(self, gpo_number, status_value) != 0) {
                                 log_error("GPO_INTERACTION: failed to set value!");
                                 zmsg_addstr(reply, "ERROR");
                                 zmsg_addstr(reply, "SET_VALUE_FAILED");
                             } else {
                                 zmsg_addstr(reply, "OK");
-                                // Update the GPO state
-                                gpx_info->current_state = status_value;
+                                s_power_group_written(self, gpo_number, status_value);
+
+                                // Update the GPO state, unless it was deleted or
+                                // moved to another GPx in the meantime
+                                locked_at = s_lock_sensors(self);
+                                gpx_info  = get_gpx_info(asset_name);
+                                if (gpx_info && (gpx_info->gpx_number == gpo_number) &&
+                                    (gpx_info->gpx_direction == GPIO_DIRECTION_OUT))
+                                    gpx_info->current_state = status_value;
+                                s_unlock_sensors(self, locked_at);
 
                                 gpo_state_t* last_state =
-                                    static_cast<gpo_state_t*>(zhashx_lookup(self->gpo_states, gpx_info->asset_name));
+                                    static_cast<gpo_state_t*>(zhashx_lookup(self->gpo_states, asset_name));
                                 if (last_state == nullptr) {
                                     log_debug("GPO_INTERACTION: can't find sensor '%s'!", sensor_name);
                                     zmsg_addstr(reply, "ERROR");
@@ -450,13 +1422,15 @@ void static s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t* message)
                     zmsg_addstr(reply, "ERROR");
                     zmsg_addstr(reply, "ASSET_NOT_FOUND");
                 }
-                // send the reply
+            }
+            zstr_free(&asset_name);
+            // send the reply
+            if (initialized) {
                 int rv =
                     mlm_client_sendto(self->mlm, mlm_client_sender(self->mlm), subject.c_str(), nullptr, 5000, &reply);
                 if (rv == -1)
                     log_error("%s:\tgpio: mlm_client_sendto failed", self->name);
             }
-            pthread_mutex_unlock(&gpx_list_mutex);
             zstr_free(&sensor_name);
             zstr_free(&action_name);
             zstr_free(&zuuid);
@@ -682,42 +1656,46 @@ void static s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t* message)
                 if (state->default_state != num_default_state) {
                     state->default_state = num_default_state;
                     if (!state->in_alert) {
-                        int rv = libgpio_write(self->gpio_lib, state->gpo_number, num_default_state);
+                        int rv = s_gpio_write(self, state->gpo_number, num_default_state);
                         if (rv) {
                             log_error("Error during default action %s on GPO #%d", default_state, state->gpo_number);
                         }
                         state->last_action = num_default_state;
+                        s_power_group_written(self, state->gpo_number, num_default_state);
                     }
                 }
                 // did the port change?
                 if (state->gpo_number != num_gpo_number) {
                     // turn off the previous port
-                    int rv = libgpio_write(self->gpio_lib, state->gpo_number, GPIO_STATE_CLOSED);
+                    int rv = s_gpio_write(self, state->gpo_number, GPIO_STATE_CLOSED);
                     if (rv)
                         log_error("Error while closing no longer active GPO #%d", state->gpo_number);
+                    s_power_group_written(self, state->gpo_number, GPIO_STATE_CLOSED);
 
                     // do the default action on the new port
                     num_default_state = libgpio_get_status_value(default_state);
-                    rv                = libgpio_write(self->gpio_lib, num_gpo_number, num_default_state);
+                    rv                = s_gpio_write(self, num_gpo_number, num_default_state);
                     if (rv) {
                         log_error("Error during default action %s on GPO #%d", default_state, state->gpo_number);
                     }
                     state->gpo_number  = num_gpo_number;
                     state->last_action = num_default_state;
                     state->in_alert    = 0;
+                    s_power_group_written(self, state->gpo_number, num_default_state);
                 }
             } else {
                 state                = static_cast<gpo_state_t*>(zmalloc(sizeof(gpo_state_t)));
                 state->gpo_number    = atoi(gpo_number);
                 state->default_state = libgpio_get_status_value(default_state);
                 // do the default action
-                int rv = libgpio_write(self->gpio_lib, state->gpo_number, state->default_state);
+                int rv = s_gpio_write(self, state->gpo_number, state->default_state);
                 if (rv) {
                     log_error("Error during default action %s on GPO #%d", default_state, state->gpo_number);
                     state->last_action = GPIO_STATE_UNKNOWN;
                 } else
                     state->last_action = libgpio_get_status_value(default_state);
                 state->in_alert = 0;
+                s_power_group_written(self, state->gpo_number, state->last_action);
                 zhashx_update(self->gpo_states, static_cast<void*>(assetname), static_cast<void*>(state));
             }
 
@@ -726,6 +1704,50 @@ void static s_handle_mailbox(fty_sensor_gpio_server_t* self, zmsg_t* message)
             zstr_free(&default_state);
         }
 
+        else if (subject == "GPIO_STATS") {
+            char* zuuid = zmsg_popstr(message);
+            zmsg_addstr(reply, zuuid);
+            zmsg_addstr(reply, "OK");
+            pthread_mutex_lock(&self->gpio_mutex);
+            s_add_stat(reply, "direction_writes", libgpio_get_direction_writes(self->gpio_lib));
+            s_add_stat(reply, "direction_writes_avoided", libgpio_get_direction_writes_avoided(self->gpio_lib));
+            s_add_stat(reply, "pins_quarantined", uint64_t(libgpio_get_quarantined_count(self->gpio_lib)));
+            s_add_stat(reply, "io_batches", libgpio_get_io_batches(self->gpio_lib));
+            pthread_mutex_unlock(&self->gpio_mutex);
+            s_add_stat(reply, "metrics_published", self->metrics_published);
+            s_add_stat(reply, "metrics_suppressed", self->metrics_suppressed);
+            s_add_stat(reply, "power_activations", self->power_activations);
+            s_add_stat(reply, "sensors_deferred", self->sensors_deferred);
+            s_add_stat(reply, "lock_holds", self->lock_holds);
+            s_add_stat(reply, "lock_hold_time_us", self->lock_hold_time);
+            s_add_stat(reply, "lock_hold_max_us", self->lock_hold_max);
+            s_add_stat(reply, "cycles", self->cycles);
+            s_add_stat(reply, "cycle_overruns", self->cycle_overruns);
+            s_add_stat(reply, "cycles_skipped", self->cycles_skipped);
+            s_add_stat(reply, "batches_published", self->batches_published);
+            s_add_stat(reply, "batched_metrics", self->batched_metrics);
+            s_add_stat(reply, "shm_writes", self->shm_writes);
+            s_add_stat(reply, "shm_failures", self->shm_failures);
+            if (self->sampler) {
+                s_add_stat(reply, "sampler_rounds", fty_sensor_gpio_sampler_rounds(self->sampler));
+                s_add_stat(reply, "sampler_changes", fty_sensor_gpio_sampler_changes(self->sampler));
+                s_add_stat(reply, "sampler_drops", fty_sensor_gpio_sampler_drops(self->sampler));
+                s_add_stat(reply, "ring_depth", uint64_t(fty_sensor_gpio_sampler_depth(self->sampler)));
+            }
+            s_add_stat(reply, "ring_depth_max", uint64_t(self->ring_depth_max));
+            s_add_stat(reply, "samples_published", self->samples_published);
+            s_add_stat(reply, "sample_latency_avg_us",
+                (self->samples_published) ? self->sample_latency / self->samples_published : 0);
+            s_add_stat(reply, "sample_latency_max_us", self->sample_latency_max);
+            s_add_cycle_stats(self, reply);
+            s_add_quarantined_stats(self, reply);
+            s_add_adaptive_stats(self, reply);
+            int rv = mlm_client_sendto(self->mlm, mlm_client_sender(self->mlm), subject.c_str(), nullptr, 5000, &reply);
+            if (rv == -1)
+                log_error("%s:\tgpio: mlm_client_sendto failed", self->name);
+            zstr_free(&zuuid);
+        }
+
         else if (subject == "GPIO_TEST") {
             ;
         }
@@ -757,6 +1779,48 @@ fty_sensor_gpio_server_t* fty_sensor_gpio_server_new(const char* name)
     assert(self->gpio_lib);
     self->gpo_states = zhashx_new();
     zhashx_set_destructor(self->gpo_states, free_fn);
+    self->power_groups = zhashx_new();
+    zhashx_set_destructor(self->power_groups, free_fn);
+    self->poll_wheel       = fty_sensor_gpio_wheel_new(POLL_WHEEL_TICK);
+    self->adaptive_polling = false;
+    self->adaptive_fast    = DEFAULT_ADAPTIVE_FAST_INTERVAL;
+    self->adaptive_window  = DEFAULT_ADAPTIVE_FAST_WINDOW;
+    self->adaptive_max     = DEFAULT_ADAPTIVE_MAX_INTERVAL;
+    self->adaptive_states  = zhashx_new();
+    zhashx_set_destructor(self->adaptive_states, free_fn);
+    self->metrics = zhashx_new();
+    zhashx_set_destructor(self->metrics, s_metric_destroy);
+    self->edge_triggered     = false;
+    self->edge_fds           = nullptr;
+    self->edge_gpis          = nullptr;
+    self->edge_count         = 0;
+    self->metric_ttl         = DEFAULT_METRIC_TTL;
+    self->publish_time       = 0;
+    self->publish_mode       = PUBLISH_SINGLE;
+    self->batch              = nullptr;
+    self->batches_published  = 0;
+    self->batched_metrics    = 0;
+    self->shm_writes         = 0;
+    self->shm_failures       = 0;
+    pthread_mutex_init(&self->gpio_mutex, nullptr);
+    self->sampler            = nullptr;
+    self->ring_depth_max     = 0;
+    self->samples_published  = 0;
+    self->sample_latency     = 0;
+    self->sample_latency_max = 0;
+    self->metrics_published  = 0;
+    self->metrics_suppressed = 0;
+    self->power_activations  = 0;
+    self->sensors_deferred   = 0;
+    self->lock_holds         = 0;
+    self->lock_hold_time     = 0;
+    self->lock_hold_max      = 0;
+    self->check_interval     = 0;
+    self->next_cycle         = 0;
+    self->cycles             = 0;
+    self->cycle_overruns     = 0;
+    self->cycles_skipped     = 0;
+    memset(self->cycle_durations, 0, sizeof(self->cycle_durations));
     return self;
 }
 
@@ -771,18 +1835,74 @@ void fty_sensor_gpio_server_destroy(fty_sensor_gpio_server_t** self_p)
         fty_sensor_gpio_server_t* self = *self_p;
 
         //  Free class properties
+        //  The sampler thread shares the GPIO library
+        fty_sensor_gpio_sampler_destroy(&self->sampler);
         libgpio_destroy(&self->gpio_lib);
+        pthread_mutex_destroy(&self->gpio_mutex);
         zstr_free(&self->name);
         mlm_client_destroy(&self->mlm);
         if (self->template_dir)
             zstr_free(&self->template_dir);
         zhashx_destroy(&self->gpo_states);
+        zhashx_destroy(&self->power_groups);
+        fty_sensor_gpio_wheel_destroy(&self->poll_wheel);
+        zhashx_destroy(&self->adaptive_states);
+        zhashx_destroy(&self->metrics);
+        zmsg_destroy(&self->batch);
+        free(self->edge_fds);
+        free(self->edge_gpis);
         //  Free object itself
         free(self);
         *self_p = nullptr;
     }
 }
 
+//  --------------------------------------------------------------------------
+//  GPO write pending from the state file: a default action, or the closing
+//  of a no longer active port (no state)
+
+struct gpo_write_t
+{
+    int          gpo_number;
+    int          value;
+    gpo_state_t* state;
+};
+
+//  --------------------------------------------------------------------------
+//  Write the pending GPOs at once, and account the default actions results
+
+static void s_flush_gpo_writes(fty_sensor_gpio_server_t* self, std::vector<gpo_write_t>& writes)
+{
+    if (writes.empty())
+        return;
+
+    std::vector<int> gpo_numbers, values, results(writes.size());
+    for (const gpo_write_t& write : writes) {
+        gpo_numbers.push_back(write.gpo_number);
+        values.push_back(write.value);
+    }
+    pthread_mutex_lock(&self->gpio_mutex);
+    libgpio_write_many(self->gpio_lib, gpo_numbers.data(), values.data(), int(writes.size()), results.data());
+    pthread_mutex_unlock(&self->gpio_mutex);
+
+    for (size_t i = 0; i < writes.size(); i++) {
+        gpo_state_t* state = writes[i].state;
+        if (!state) {
+            if (results[i])
+                log_error("Error while closing no longer active GPO #%d", writes[i].gpo_number);
+        } else if (results[i]) {
+            log_error("Error during default action %s on GPO #%d", libgpio_get_status_string(writes[i].value).c_str(),
+                state->gpo_number);
+            state->last_action = GPIO_STATE_UNKNOWN;
+        } else
+            state->last_action = writes[i].value;
+    }
+    writes.clear();
+}
+
+//  --------------------------------------------------------------------------
+//  Load the GPO states from the state file, and restore them
+
 static void s_load_state_file(fty_sensor_gpio_server_t* self, const char* state_file)
 {
     if (!state_file)
@@ -798,38 +1918,40 @@ static void s_load_state_file(fty_sensor_gpio_server_t* self, const char* state_
     int  gpo_number    = -1;
     int  default_state = -1;
     int  last_action   = -1;
+    // GPO writes are batched, and only flushed early to keep the order of
+    // several writes to the same GPO
+    std::vector<gpo_write_t> writes;
     // line read successfully - all 4 items are there
     while (fscanf(f_state, "%14s %3d %d %d", asset_name, &gpo_number, &default_state, &last_action) == 4) {
+        for (const gpo_write_t& write : writes) {
+            if (write.gpo_number == gpo_number) {
+                s_flush_gpo_writes(self, writes);
+                break;
+            }
+        }
         // existing GPO entry came from fty-sensor-gpio-assets, which takes precendence
         gpo_state_t* state = static_cast<gpo_state_t*>(zhashx_lookup(self->gpo_states, static_cast<void*>(asset_name)));
 
         if (state != nullptr) {
             // did the port change?
-            if (state->gpo_number != gpo_number) {
+            if (state->gpo_number != gpo_number)
                 // turn off the port from state file
-                int rv = libgpio_write(self->gpio_lib, gpo_number, GPIO_STATE_CLOSED);
-                if (rv)
-                    log_error("Error while closing no longer active GPO #%d", state->gpo_number);
-                // default action on the new port was done when adding it
-            }
+                writes.push_back({gpo_number, GPIO_STATE_CLOSED, nullptr});
+            // default action on the new port was done when adding it
         } else {
             state                = static_cast<gpo_state_t*>(zmalloc(sizeof(gpo_state_t)));
             state->gpo_number    = gpo_number;
             state->default_state = default_state;
+            state->last_action   = GPIO_STATE_UNKNOWN;
+            state->in_alert      = 0;
             // do the default action
-            int rv = libgpio_write(self->gpio_lib, state->gpo_number, state->default_state);
-            if (rv) {
-                log_error("Error during default action %s on GPO #%d", libgpio_get_status_string(default_state).c_str(),
-                    state->gpo_number);
-                state->last_action = GPIO_STATE_UNKNOWN;
-            } else
-                state->last_action = default_state;
-            state->in_alert = 0;
+            writes.push_back({state->gpo_number, state->default_state, state});
 
             char* asset_name_key = strdup(asset_name);
             zhashx_update(self->gpo_states, static_cast<void*>(asset_name_key), static_cast<void*>(state));
         }
     }
+    s_flush_gpo_writes(self, writes);
 
     fclose(f_state);
 }
@@ -919,6 +2041,9 @@ int request_capabilities_info(fty_sensor_gpio_server_t* self, const char* type)
     }
     zstr_free(&value);
 
+    // The GPIO library is shared with the sampler thread
+    pthread_mutex_lock(&self->gpio_mutex);
+
     // Process the GPx count
     value      = zmsg_popstr(reply);
     int ivalue = atoi(value);
@@ -932,6 +2057,7 @@ int request_capabilities_info(fty_sensor_gpio_server_t* self, const char* type)
 
     if (ivalue == 0) {
         log_debug("%s count is 0, no further processing", type);
+        pthread_mutex_unlock(&self->gpio_mutex);
         return 0;
     }
 
@@ -958,10 +2084,9 @@ int request_capabilities_info(fty_sensor_gpio_server_t* self, const char* type)
     while (value) {
         // GPx pin name
         // drop the port descriptor because zconfig is stupid and
-        // doesn't allow number as a key
-        const std::string port_str(value + 1, 1);
-        // convert to int
-        int port_num = static_cast<int>(strtol(port_str.c_str(), nullptr, 10));
+        // doesn't allow number as a key, and convert the remaining
+        // digits to int (p1, ..., p10, ...)
+        int port_num = static_cast<int>(strtol(value + 1, nullptr, 10));
         zstr_free(&value);
         // GPx pin number
         value       = zmsg_popstr(reply);
@@ -974,6 +2099,7 @@ int request_capabilities_info(fty_sensor_gpio_server_t* self, const char* type)
         // Pop the next pin name
         value = zmsg_popstr(reply);
     }
+    pthread_mutex_unlock(&self->gpio_mutex);
     zmsg_destroy(&reply);
     return 0;
 }
@@ -993,20 +2119,62 @@ void fty_sensor_gpio_server(zsock_t* pipe, void* args)
     fty_sensor_gpio_server_t* self = fty_sensor_gpio_server_new(name);
     assert(self);
 
-    zpoller_t* poller = zpoller_new(pipe, mlm_client_msgpipe(self->mlm), nullptr);
-    assert(poller);
+    // Poll items: actor pipe, malamute client, GPIs armed for edge interrupts,
+    // then the sampler, if any
+    std::vector<zmq_pollitem_t> items;
+    std::vector<int>            edges;
 
     zsock_signal(pipe, 0);
     log_info("%s_server: Started", self->name);
 
     while (!zsys_interrupted) {
-        void* which = zpoller_wait(poller, TIMEOUT_MS);
-        if (which == nullptr) {
-            if (zpoller_terminated(poller) || zsys_interrupted) {
+        // Check cycles, edges and commands may have closed or reopened the
+        // sessions of the armed GPIs
+        s_check_edges(self);
+        items.assign(2 + self->edge_count, zmq_pollitem_t());
+        items[0] = {zsock_resolve(pipe), 0, ZMQ_POLLIN, 0};
+        items[1] = {zsock_resolve(mlm_client_msgpipe(self->mlm)), 0, ZMQ_POLLIN, 0};
+        short edge_events = libgpio_get_edge_events(self->gpio_lib);
+        for (size_t i = 0; i < self->edge_count; i++)
+            items[2 + i] = {nullptr, self->edge_fds[i], edge_events, 0};
+        if (self->sampler)
+            items.push_back({nullptr, fty_sensor_gpio_sampler_fd(self->sampler), ZMQ_POLLIN, 0});
+
+        // Wake up when deferred sensors are warmed up, sensors are due at
+        // their own poll interval, or the next check cycle is due
+        if (zmq_poll(items.data(), int(items.size()), s_poll_timeout(self)) == -1) {
+            if ((errno == ETERM) || zsys_interrupted) {
                 break;
             }
+            continue;
         }
-        if (which == pipe) {
+
+        // Collect the edge interrupts first, since check cycles and commands
+        // may re-arm GPIs, and so reorder the polled value fds.
+        // An error alone is no edge, but a value fd closed under the poll
+        // (POLLNVAL): its GPI is disarmed, to be re-armed on its new session
+        edges.clear();
+        for (size_t i = 0; i < self->edge_count; i++) {
+            if (items[2 + i].revents & edge_events)
+                edges.push_back(self->edge_gpis[i]);
+            else if (items[2 + i].revents & ZMQ_POLLERR) {
+                log_debug("Value fd of GPI #%i is invalid, re-arming", self->edge_gpis[i]);
+                pthread_mutex_lock(&self->gpio_mutex);
+                libgpio_set_edge(self->gpio_lib, self->edge_gpis[i], GPIO_EDGE_NONE);
+                pthread_mutex_unlock(&self->gpio_mutex);
+                self->edge_fds[i] = -1;
+            }
+        }
+        s_check_scheduled_cycle(self);
+        s_check_power_groups(self);
+        s_check_scheduled_sensors(self);
+
+        for (int gpi_number : edges)
+            s_handle_edge(self, gpi_number);
+        if (self->sampler && (items.back().revents & ZMQ_POLLIN))
+            s_handle_samples(self);
+
+        if (items[0].revents & ZMQ_POLLIN) {
             zmsg_t* message = zmsg_recv(pipe);
             char*   cmd     = zmsg_popstr(message);
             if (cmd) {
@@ -1041,10 +2209,22 @@ void fty_sensor_gpio_server(zsock_t* pipe, void* args)
                     zstr_free(&pattern);
                 } else if (streq(cmd, "TEST")) {
                     self->test_mode = true;
+                    pthread_mutex_lock(&self->gpio_mutex);
                     libgpio_set_test_mode(self->gpio_lib, self->test_mode);
+                    pthread_mutex_unlock(&self->gpio_mutex);
                     log_debug("fty_sensor_gpio: TEST=true");
                 } else if (streq(cmd, "UPDATE")) {
-                    s_check_gpio_status(self);
+                    s_check_cycle(self);
+                } else if (streq(cmd, "CHECK_INTERVAL")) {
+                    char* check_interval = zmsg_popstr(message);
+                    if (check_interval && (atoi(check_interval) >= 0)) {
+                        // The first cycle is due one interval from now
+                        self->check_interval = atoi(check_interval);
+                        self->next_cycle     = zclock_mono() + self->check_interval;
+                    } else
+                        log_error("%s:\tInvalid check interval '%s'", self->name, check_interval ? check_interval : "");
+                    log_debug("fty_sensor_gpio: CHECK_INTERVAL=%i", self->check_interval);
+                    zstr_free(&check_interval);
                 } else if (streq(cmd, "TEMPLATE_DIR")) {
                     self->template_dir = zmsg_popstr(message);
                     log_debug("fty_sensor_gpio: Using sensors template directory: %s", self->template_dir);
@@ -1057,6 +2237,136 @@ void fty_sensor_gpio_server(zsock_t* pipe, void* args)
                         log_debug("HW_CAP request succeeded");
                         hw_cap_inited = true;
                     }
+                } else if (streq(cmd, "EDGE_TRIGGERED")) {
+                    char* edge_triggered = zmsg_popstr(message);
+                    self->edge_triggered = edge_triggered && streq(edge_triggered, "true");
+                    // Edge interrupts are signaled on the opened value fds
+                    if (self->edge_triggered) {
+                        pthread_mutex_lock(&self->gpio_mutex);
+                        libgpio_set_persistent(self->gpio_lib, true);
+                        pthread_mutex_unlock(&self->gpio_mutex);
+                    } else
+                        self->edge_count = 0;
+                    log_debug("fty_sensor_gpio: EDGE_TRIGGERED=%s", self->edge_triggered ? "true" : "false");
+                    zstr_free(&edge_triggered);
+                } else if (streq(cmd, "ADAPTIVE_POLLING")) {
+                    char* adaptive_polling = zmsg_popstr(message);
+                    char* fast_interval    = zmsg_popstr(message);
+                    char* fast_window      = zmsg_popstr(message);
+                    char* max_interval     = zmsg_popstr(message);
+                    self->adaptive_polling = adaptive_polling && streq(adaptive_polling, "true");
+                    if (fast_interval && (atoi(fast_interval) > 0))
+                        self->adaptive_fast = atoi(fast_interval);
+                    if (fast_window && (atoi(fast_window) >= 0))
+                        self->adaptive_window = atoi(fast_window);
+                    if (max_interval && (atoi(max_interval) >= self->adaptive_fast))
+                        self->adaptive_max = atoi(max_interval);
+                    // Adaptive GPIs are back to the agent check interval
+                    if (!self->adaptive_polling)
+                        zhashx_purge(self->adaptive_states);
+                    log_debug("fty_sensor_gpio: ADAPTIVE_POLLING=%s (fast: %i ms for %i ms, max: %i ms)",
+                        self->adaptive_polling ? "true" : "false", self->adaptive_fast, self->adaptive_window,
+                        self->adaptive_max);
+                    zstr_free(&adaptive_polling);
+                    zstr_free(&fast_interval);
+                    zstr_free(&fast_window);
+                    zstr_free(&max_interval);
+                } else if (streq(cmd, "PUBLISH_MODE")) {
+                    char* publish_mode = zmsg_popstr(message);
+                    int   mode         = (publish_mode) ? s_parse_publish_mode(publish_mode) : -1;
+                    if (mode > 0)
+                        self->publish_mode = mode;
+                    else
+                        log_error("%s:\tInvalid publish mode '%s'", self->name, publish_mode ? publish_mode : "");
+                    log_debug("fty_sensor_gpio: PUBLISH_MODE=%i", self->publish_mode);
+                    zstr_free(&publish_mode);
+                } else if (streq(cmd, "SAMPLER")) {
+                    char* interval = zmsg_popstr(message);
+                    char* depth    = zmsg_popstr(message);
+                    fty_sensor_gpio_sampler_destroy(&self->sampler);
+                    if (interval && (atoi(interval) > 0)) {
+                        self->sampler = fty_sensor_gpio_sampler_new(self->gpio_lib, &self->gpio_mutex,
+                            atoi(interval), (depth && (atoi(depth) > 0)) ? size_t(atoi(depth)) : DEFAULT_SAMPLER_DEPTH);
+                        if (!self->sampler)
+                            log_error("%s:\tCan't start the GPI sampler", self->name);
+                    }
+                    log_debug("fty_sensor_gpio: SAMPLER=%s", (self->sampler) ? interval : "0");
+                    zstr_free(&interval);
+                    zstr_free(&depth);
+                } else if (streq(cmd, "METRIC_TTL")) {
+                    char* metric_ttl = zmsg_popstr(message);
+                    if (metric_ttl && (atoi(metric_ttl) > 0))
+                        self->metric_ttl = atoi(metric_ttl);
+                    else
+                        log_error("%s:\tInvalid metric TTL '%s'", self->name, metric_ttl ? metric_ttl : "");
+                    log_debug("fty_sensor_gpio: METRIC_TTL=%i", self->metric_ttl);
+                    zstr_free(&metric_ttl);
+                } else if (streq(cmd, "BACKEND")) {
+                    char*                    backend_name = zmsg_popstr(message);
+                    const libgpio_backend_t* backend =
+                        (backend_name) ? libgpio_lookup_backend(backend_name) : nullptr;
+                    pthread_mutex_lock(&self->gpio_mutex);
+                    if (backend) {
+                        libgpio_set_backend(self->gpio_lib, backend);
+                        log_debug("fty_sensor_gpio: BACKEND=%s", backend_name);
+                    } else
+                        log_error("%s:\tUnknown GPIO backend '%s'", self->name, backend_name ? backend_name : "");
+                    // The simulated backend doesn't need HW capabilities, but
+                    // is given its GPI and GPO counts
+                    if (backend == &libgpio_sim_backend) {
+                        char* gpi_count = zmsg_popstr(message);
+                        char* gpo_count = zmsg_popstr(message);
+                        if (gpi_count && gpo_count) {
+                            libgpio_set_gpi_count(self->gpio_lib, atoi(gpi_count));
+                            libgpio_set_gpo_count(self->gpio_lib, atoi(gpo_count));
+                            libgpio_set_gpo_offset(self->gpio_lib, atoi(gpi_count));
+                            hw_cap_inited = true;
+                        }
+                        zstr_free(&gpi_count);
+                        zstr_free(&gpo_count);
+                    }
+                    // The character device backend is given its GPIO chip
+                    if (backend == &libgpio_cdev_backend) {
+                        char* chip_path = zmsg_popstr(message);
+                        if (chip_path)
+                            libgpio_cdev_set_chip(self->gpio_lib, chip_path);
+                        zstr_free(&chip_path);
+                    }
+                    pthread_mutex_unlock(&self->gpio_mutex);
+                    zstr_free(&backend_name);
+                } else if (streq(cmd, "SIM_VALUE")) {
+                    // Set the status of a simulated GPx: GPx number, GPI|GPO, status name
+                    char* gpx_number    = zmsg_popstr(message);
+                    char* gpx_direction = zmsg_popstr(message);
+                    char* status        = zmsg_popstr(message);
+                    int   direction     = GPIO_DIRECTION_IN;
+                    int   sim_rv        = -1;
+                    if (gpx_direction && streq(gpx_direction, "GPO"))
+                        direction = GPIO_DIRECTION_OUT;
+                    pthread_mutex_lock(&self->gpio_mutex);
+                    if (gpx_number && status)
+                        sim_rv = libgpio_sim_set_value(
+                            self->gpio_lib, atoi(gpx_number), direction, libgpio_get_status_value(status));
+                    pthread_mutex_unlock(&self->gpio_mutex);
+                    if (sim_rv == -1)
+                        log_error("%s:\tCan't set simulated GPx value", self->name);
+                    zstr_free(&gpx_number);
+                    zstr_free(&gpx_direction);
+                    zstr_free(&status);
+                } else if (streq(cmd, "PERSISTENT_PINS")) {
+                    char* persistent = zmsg_popstr(message);
+                    pthread_mutex_lock(&self->gpio_mutex);
+                    if (persistent)
+                        libgpio_set_persistent(self->gpio_lib, streq(persistent, "true"));
+                    pthread_mutex_unlock(&self->gpio_mutex);
+                    zstr_free(&persistent);
+                } else if (streq(cmd, "BATCHED_IO")) {
+                    char* batched_io = zmsg_popstr(message);
+                    pthread_mutex_lock(&self->gpio_mutex);
+                    if (batched_io)
+                        libgpio_set_batched_io(self->gpio_lib, streq(batched_io, "true"));
+                    pthread_mutex_unlock(&self->gpio_mutex);
+                    zstr_free(&batched_io);
                 } else if (streq(cmd, "STATEFILE")) {
                     char* state_file = zmsg_popstr(message);
                     s_load_state_file(self, state_file);
@@ -1067,7 +2377,8 @@ void fty_sensor_gpio_server(zsock_t* pipe, void* args)
                 zstr_free(&cmd);
             }
             zmsg_destroy(&message);
-        } else if (which == mlm_client_msgpipe(self->mlm)) {
+        }
+        if (items[1].revents & ZMQ_POLLIN) {
             zmsg_t* message = mlm_client_recv(self->mlm);
             if (streq(mlm_client_command(self->mlm), "MAILBOX DELIVER")) {
                 // someone is addressing us directly
@@ -1080,6 +2391,5 @@ exit:
     if (!self->test_mode)
         s_save_state_file(self, state_file_path);
     zstr_free(&state_file_path);
-    zpoller_destroy(&poller);
     fty_sensor_gpio_server_destroy(&self);
 }
@@ -0,0 +1,293 @@
+/*  =========================================================================
+    fty_sensor_gpio_wheel - Hierarchical timer wheel
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_sensor_gpio_wheel - Hierarchical timer wheel
+@discuss
+    Timers are kept in WHEEL_LEVELS levels of WHEEL_SLOTS slots. A slot of
+    level 0 holds the timers expiring at one tick, and a slot of level n the
+    timers expiring within WHEEL_SLOTS^n ticks. Each time the wheel turns
+    over a level, the next slot of the level above is cascaded down, so that
+    scheduling, cancelling and expiring a timer are O(1), whatever the
+    number of timers and the spread of their deadlines.
+@end
+*/
+
+#include "fty_sensor_gpio_wheel.h"
+#include <algorithm>
+#include <vector>
+
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS   6
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+// Timers beyond the highest level are parked in its last slot, and cascaded
+// again until they get in range
+#define WHEEL_RANGE (int64_t(1) << (WHEEL_BITS * WHEEL_LEVELS))
+
+//  Structure of a timer
+
+struct wheel_timer_t
+{
+    char*     key;     // timer key
+    int64_t   expires; // tick at which the timer expires
+    int       level;   // level of the slot holding the timer
+    zlistx_t* slot;    // slot holding the timer
+    void*     handle;  // timer handle in its slot
+};
+
+///  Structure of our class
+struct fty_sensor_gpio_wheel_t
+{
+    int64_t   tick;                             // resolution (ms)
+    int64_t   current;                          // next tick to expire
+    zlistx_t* slots[WHEEL_LEVELS][WHEEL_SLOTS]; // timers, by level and slot
+    size_t    counts[WHEEL_LEVELS];             // number of timers, by level
+    zhashx_t* timers;                           // timers, by key
+};
+
+static void s_timer_destroy(void** self_ptr)
+{
+    wheel_timer_t* timer = static_cast<wheel_timer_t*>(*self_ptr);
+    zstr_free(&timer->key);
+    free(timer);
+    *self_ptr = nullptr;
+}
+
+//  --------------------------------------------------------------------------
+//  Put a timer in the slot matching its expiry
+
+static void s_place(fty_sensor_gpio_wheel_t* self, wheel_timer_t* timer)
+{
+    int64_t expires = timer->expires;
+    if (expires < self->current)
+        expires = self->current;
+    else if (expires - self->current >= WHEEL_RANGE)
+        expires = self->current + WHEEL_RANGE - 1;
+
+    int level = 0;
+    while ((level < WHEEL_LEVELS - 1) && (expires - self->current >= (int64_t(1) << (WHEEL_BITS * (level + 1)))))
+        level++;
+
+    timer->level  = level;
+    timer->slot   = self->slots[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    timer->handle = zlistx_add_end(timer->slot, timer);
+    self->counts[level]++;
+}
+
+//  --------------------------------------------------------------------------
+//  Remove a timer from its slot
+
+static void s_unplace(fty_sensor_gpio_wheel_t* self, wheel_timer_t* timer)
+{
+    zlistx_delete(timer->slot, timer->handle);
+    self->counts[timer->level]--;
+}
+
+//  --------------------------------------------------------------------------
+//  Move the timers of a slot to the levels below
+
+static void s_cascade(fty_sensor_gpio_wheel_t* self, int level, int index)
+{
+    zlistx_t*                   slot = self->slots[level][index];
+    std::vector<wheel_timer_t*> timers;
+    timers.reserve(zlistx_size(slot));
+    wheel_timer_t* timer = static_cast<wheel_timer_t*>(zlistx_first(slot));
+    while (timer) {
+        timers.push_back(timer);
+        timer = static_cast<wheel_timer_t*>(zlistx_next(slot));
+    }
+    zlistx_purge(slot);
+    self->counts[level] -= timers.size();
+    for (wheel_timer_t* cascaded : timers)
+        s_place(self, cascaded);
+}
+
+//  --------------------------------------------------------------------------
+//  Create a new timer wheel
+
+fty_sensor_gpio_wheel_t* fty_sensor_gpio_wheel_new(int tick)
+{
+    assert(tick > 0);
+    fty_sensor_gpio_wheel_t* self = static_cast<fty_sensor_gpio_wheel_t*>(zmalloc(sizeof(fty_sensor_gpio_wheel_t)));
+    assert(self);
+
+    self->tick    = tick;
+    self->current = zclock_mono() / tick;
+    for (int level = 0; level < WHEEL_LEVELS; level++)
+        for (int index = 0; index < WHEEL_SLOTS; index++)
+            self->slots[level][index] = zlistx_new();
+    self->timers = zhashx_new();
+    zhashx_set_destructor(self->timers, s_timer_destroy);
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the timer wheel
+
+void fty_sensor_gpio_wheel_destroy(fty_sensor_gpio_wheel_t** self_p)
+{
+    assert(self_p);
+    if (*self_p) {
+        fty_sensor_gpio_wheel_t* self = *self_p;
+        for (int level = 0; level < WHEEL_LEVELS; level++)
+            for (int index = 0; index < WHEEL_SLOTS; index++)
+                zlistx_destroy(&self->slots[level][index]);
+        zhashx_destroy(&self->timers);
+        free(self);
+        *self_p = nullptr;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Schedule the timer of key at deadline
+
+void fty_sensor_gpio_wheel_schedule(fty_sensor_gpio_wheel_t* self, const char* key, int64_t deadline)
+{
+    assert(self);
+    assert(key);
+    wheel_timer_t* timer = static_cast<wheel_timer_t*>(zhashx_lookup(self->timers, key));
+    if (timer)
+        s_unplace(self, timer);
+    else {
+        timer      = static_cast<wheel_timer_t*>(zmalloc(sizeof(wheel_timer_t)));
+        timer->key = strdup(key);
+        zhashx_insert(self->timers, key, timer);
+    }
+    // Round up, so that the timer never expires early
+    timer->expires = (deadline + self->tick - 1) / self->tick;
+    s_place(self, timer);
+}
+
+//  --------------------------------------------------------------------------
+//  Cancel the timer of key
+
+int fty_sensor_gpio_wheel_cancel(fty_sensor_gpio_wheel_t* self, const char* key)
+{
+    assert(self);
+    wheel_timer_t* timer = static_cast<wheel_timer_t*>(zhashx_lookup(self->timers, key));
+    if (!timer)
+        return -1;
+    s_unplace(self, timer);
+    zhashx_delete(self->timers, key);
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the deadline of the timer of key
+
+int64_t fty_sensor_gpio_wheel_deadline(fty_sensor_gpio_wheel_t* self, const char* key)
+{
+    assert(self);
+    wheel_timer_t* timer = static_cast<wheel_timer_t*>(zhashx_lookup(self->timers, key));
+    return (timer) ? timer->expires * self->tick : -1;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the earliest deadline of all timers. Within a level, the first slot
+//  holding timers, from the current one, holds the earliest ones. Above the
+//  level 0, the current slot may hold timers either due now (not cascaded
+//  yet), or a whole turn later, so that it is always checked too
+
+int64_t fty_sensor_gpio_wheel_next_deadline(fty_sensor_gpio_wheel_t* self)
+{
+    assert(self);
+    if (zhashx_size(self->timers) == 0)
+        return -1;
+
+    int64_t expires = -1;
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        int current = int((self->current >> (WHEEL_BITS * level)) & WHEEL_MASK);
+        for (int offset = 0; offset < WHEEL_SLOTS; offset++) {
+            zlistx_t*      slot  = self->slots[level][(current + offset) & WHEEL_MASK];
+            wheel_timer_t* timer = static_cast<wheel_timer_t*>(zlistx_first(slot));
+            bool           found = (timer != nullptr);
+            while (timer) {
+                if ((expires == -1) || (timer->expires < expires))
+                    expires = timer->expires;
+                timer = static_cast<wheel_timer_t*>(zlistx_next(slot));
+            }
+            if (found && ((level == 0) || (offset > 0)))
+                break;
+        }
+    }
+    return (expires < self->current) ? self->current * self->tick : expires * self->tick;
+}
+
+//  --------------------------------------------------------------------------
+//  Advance the wheel up to now, and hand the keys of the expired timers over
+
+size_t fty_sensor_gpio_wheel_expire(fty_sensor_gpio_wheel_t* self, int64_t now, zlistx_t* expired)
+{
+    assert(self);
+    assert(expired);
+    size_t  count  = 0;
+    int64_t target = now / self->tick;
+    while (self->current <= target) {
+        // Nothing to turn over
+        if (zhashx_size(self->timers) == 0) {
+            self->current = target + 1;
+            break;
+        }
+        // Cascade the levels turned over
+        for (int level = 1; level < WHEEL_LEVELS; level++) {
+            if (self->current & ((int64_t(1) << (WHEEL_BITS * level)) - 1))
+                break;
+            s_cascade(self, level, int((self->current >> (WHEEL_BITS * level)) & WHEEL_MASK));
+        }
+
+        zlistx_t*      slot  = self->slots[0][self->current & WHEEL_MASK];
+        wheel_timer_t* timer = static_cast<wheel_timer_t*>(zlistx_first(slot));
+        while (timer) {
+            s_unplace(self, timer);
+            char* key  = timer->key;
+            timer->key = nullptr;
+            zhashx_delete(self->timers, key);
+            zlistx_add_end(expired, key);
+            count++;
+            timer = static_cast<wheel_timer_t*>(zlistx_first(slot));
+        }
+        self->current++;
+
+        // Without timers in the levels below, skip to the next slot of the
+        // first level holding timers, since there is nothing to cascade nor
+        // expire until then
+        int level = 0;
+        while ((level < WHEEL_LEVELS - 1) && (self->counts[level] == 0))
+            level++;
+        if (level > 0) {
+            int64_t mask = (int64_t(1) << (WHEEL_BITS * level)) - 1;
+            if (self->current & mask)
+                self->current = std::min((self->current | mask) + 1, target + 1);
+        }
+    }
+    return count;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of scheduled timers
+
+size_t fty_sensor_gpio_wheel_size(fty_sensor_gpio_wheel_t* self)
+{
+    assert(self);
+    return zhashx_size(self->timers);
+}
@@ -0,0 +1,54 @@
+/*  =========================================================================
+    fty_sensor_gpio_wheel - Hierarchical timer wheel
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+#include <czmq.h>
+
+///  Timer wheel (opaque), holding timers identified by a key, with deadlines
+///  in monotonic time (ms)
+struct fty_sensor_gpio_wheel_t;
+
+///  Create a new timer wheel, with the given resolution (ms). Timers never
+///  expire before their deadline, and at most one tick after it
+fty_sensor_gpio_wheel_t* fty_sensor_gpio_wheel_new(int tick);
+
+///  Destroy the timer wheel
+void fty_sensor_gpio_wheel_destroy(fty_sensor_gpio_wheel_t** self_p);
+
+///  Schedule the timer of key at deadline, replacing its previous deadline
+void fty_sensor_gpio_wheel_schedule(fty_sensor_gpio_wheel_t* self, const char* key, int64_t deadline);
+
+///  Cancel the timer of key. Return -1 if it isn't scheduled, 0 otherwise
+int fty_sensor_gpio_wheel_cancel(fty_sensor_gpio_wheel_t* self, const char* key);
+
+///  Get the deadline of the timer of key, or -1 if it isn't scheduled
+int64_t fty_sensor_gpio_wheel_deadline(fty_sensor_gpio_wheel_t* self, const char* key);
+
+///  Get the earliest deadline of all timers, or -1 if there is none
+int64_t fty_sensor_gpio_wheel_next_deadline(fty_sensor_gpio_wheel_t* self);
+
+///  Advance the wheel up to now, and hand the keys of the expired timers
+///  over to expired, which has to destroy them (i.e. with zstr_free).
+///  Return the number of expired timers
+size_t fty_sensor_gpio_wheel_expire(fty_sensor_gpio_wheel_t* self, int64_t now, zlistx_t* expired);
+
+///  Get the number of scheduled timers
+size_t fty_sensor_gpio_wheel_size(fty_sensor_gpio_wheel_t* self);
@@ -35,32 +35,17 @@ int _gpi_count = 0;
 
 //  Private functions forward declarations
 
-static int libgpio_export(libgpio_t* self, int pin);
-static int libgpio_unexport(libgpio_t* self, int pin);
-static int libgpio_set_direction(libgpio_t* self, int pin, int dir);
-static int mkpath(char* file_path, mode_t mode);
-// FIXME: use zsys_dir_create (...);
-
-void* dup_int_ptr(const void* ptr)
-{
-    if (ptr == NULL) {
-        log_error("Attempt to dup NULL");
-        return NULL;
-    }
-    int* new_ptr = static_cast<int*>(zmalloc(sizeof(int)));
-    *new_ptr     = *(static_cast<const int*>(ptr));
-    return static_cast<void*>(new_ptr);
-}
-
-static void free_fn(void** self_ptr)
-{
-    if (!self_ptr || !*self_ptr) {
-        log_error("Attempt to free NULL");
-        return;
-    }
-    free(*self_ptr);
-}
-
+static inline libgpio_pin_t* libgpio_get_pin(libgpio_t* self, int GPx_number, int direction);
+static int libgpio_set_direction(libgpio_t* self, libgpio_pin_t* gpx_pin, int dir);
+static int libgpio_session_open(libgpio_t* self, libgpio_pin_t* gpx_pin, int direction);
+static int libgpio_session_setup(libgpio_t* self, libgpio_pin_t* gpx_pin, int direction);
+static void libgpio_session_close(libgpio_t* self, libgpio_pin_t* gpx_pin);
+static void libgpio_breaker_failure(libgpio_t* self, libgpio_pin_t* gpx_pin);
+static void libgpio_breaker_success(libgpio_pin_t* gpx_pin);
+static int libgpio_read_bulk(libgpio_t* self, libgpio_snapshot_t* snapshot);
+static void libgpio_update_pin(libgpio_t* self, libgpio_pin_t* gpx_pin, int pin);
+static void libgpio_update_pin_map(libgpio_t* self, int direction);
+static void libgpio_resize_pin_map(libgpio_t* self, int direction, int count);
 
 const char* SELFTEST_DIR_RO = "tests/selftest-ro";
 const char* SELFTEST_DIR_RW = ".";
@@ -73,26 +58,71 @@ libgpio_t* libgpio_new(void)
     libgpio_t* self = static_cast<libgpio_t*>(zmalloc(sizeof(libgpio_t)));
     assert(self);
     //  Initialize class properties here
+    self->backend           = &libgpio_sysfs_backend;
+    self->backend_data      = NULL;
     self->gpio_base_address = GPIO_BASE_INDEX;
     self->gpo_offset        = 0;
     self->gpi_offset        = 0;
     self->gpo_count         = 0;
     self->gpi_count         = 0;
     self->test_mode         = false;
-    self->gpi_mapping       = zhashx_new();
-    zhashx_set_key_duplicator(self->gpi_mapping, dup_int_ptr);
-    zhashx_set_duplicator(self->gpi_mapping, dup_int_ptr);
-    zhashx_set_destructor(self->gpi_mapping, free_fn);
-    assert(self->gpi_mapping);
-    self->gpo_mapping = zhashx_new();
-    zhashx_set_key_duplicator(self->gpo_mapping, dup_int_ptr);
-    zhashx_set_duplicator(self->gpo_mapping, dup_int_ptr);
-    zhashx_set_destructor(self->gpo_mapping, free_fn);
-    assert(self->gpo_mapping);
+    self->persistent        = true;
+    self->batched_io        = false;
+    self->gpi_pins          = NULL;
+    self->gpo_pins          = NULL;
+    // Circuit breaker
+    self->breaker_threshold   = GPIO_BREAKER_THRESHOLD;
+    self->breaker_backoff_min = GPIO_BREAKER_BACKOFF_MIN;
+    self->breaker_backoff_max = GPIO_BREAKER_BACKOFF_MAX;
+    // Statistics
+    self->direction_writes         = 0;
+    self->direction_writes_avoided = 0;
+    self->io_batches               = 0;
+    // Build the (empty) pin maps and the sysfs paths
+    libgpio_resize_pin_map(self, GPIO_DIRECTION_IN, 0);
+    libgpio_resize_pin_map(self, GPIO_DIRECTION_OUT, 0);
 
     return self;
 }
 
+//  --------------------------------------------------------------------------
+//  Set the GPIO access backend
+
+void libgpio_set_backend(libgpio_t* self, const libgpio_backend_t* backend)
+{
+    assert(backend);
+    if (backend == self->backend)
+        return;
+    log_debug("setting backend to '%s'", backend->name);
+    libgpio_close_sessions(self);
+    if (self->backend->destroy)
+        self->backend->destroy(self);
+    self->backend_data = NULL;
+    self->backend      = backend;
+}
+
+//  --------------------------------------------------------------------------
+//  Get a backend by its name
+
+const libgpio_backend_t* libgpio_lookup_backend(const char* name)
+{
+    if (streq(name, libgpio_sysfs_backend.name))
+        return &libgpio_sysfs_backend;
+    if (streq(name, libgpio_sim_backend.name))
+        return &libgpio_sim_backend;
+    if (streq(name, libgpio_cdev_backend.name))
+        return &libgpio_cdev_backend;
+    return NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the poll events signaling an edge on the value fds
+
+short libgpio_get_edge_events(libgpio_t* self)
+{
+    return self->backend->edge_events;
+}
+
 //  --------------------------------------------------------------------------
 //  Set the target address of the GPIO chipset
 
@@ -100,6 +130,8 @@ void libgpio_set_gpio_base_address(libgpio_t* self, int GPx_base_index)
 {
     log_debug("setting address to %i", GPx_base_index);
     self->gpio_base_address = GPx_base_index;
+    libgpio_update_pin_map(self, GPIO_DIRECTION_IN);
+    libgpio_update_pin_map(self, GPIO_DIRECTION_OUT);
 }
 
 //  --------------------------------------------------------------------------
@@ -109,6 +141,7 @@ void libgpio_set_gpo_offset(libgpio_t* self, int gpo_offset)
 {
     log_debug("setting GPO offset to %i", gpo_offset);
     self->gpo_offset = gpo_offset;
+    libgpio_update_pin_map(self, GPIO_DIRECTION_OUT);
 }
 
 //  --------------------------------------------------------------------------
@@ -118,6 +151,7 @@ void libgpio_set_gpi_offset(libgpio_t* self, int gpi_offset)
 {
     log_debug("setting GPI offset to %i", gpi_offset);
     self->gpi_offset = gpi_offset;
+    libgpio_update_pin_map(self, GPIO_DIRECTION_IN);
 }
 
 //  --------------------------------------------------------------------------
@@ -125,8 +159,8 @@ void libgpio_set_gpi_offset(libgpio_t* self, int gpi_offset)
 void libgpio_set_gpi_count(libgpio_t* self, int gpi_count)
 {
     log_debug("setting GPI count to %i", gpi_count);
-    self->gpi_count = gpi_count;
-    _gpi_count      = gpi_count;
+    libgpio_resize_pin_map(self, GPIO_DIRECTION_IN, gpi_count);
+    _gpi_count = gpi_count;
 }
 
 //  --------------------------------------------------------------------------
@@ -141,8 +175,8 @@ int libgpio_get_gpi_count()
 void libgpio_set_gpo_count(libgpio_t* self, int gpo_count)
 {
     log_debug("setting GPO count to %i", gpo_count);
-    self->gpo_count = gpo_count;
-    _gpo_count      = gpo_count;
+    libgpio_resize_pin_map(self, GPIO_DIRECTION_OUT, gpo_count);
+    _gpo_count = gpo_count;
 }
 
 //  --------------------------------------------------------------------------
@@ -157,15 +191,25 @@ int libgpio_get_gpo_count()
 void libgpio_add_gpi_mapping(libgpio_t* self, int port_num, int pin_num)
 {
     log_debug("adding GPI mapping from port %d to pin %d", port_num, pin_num);
-    zhashx_insert(self->gpi_mapping, static_cast<void*>(&port_num), static_cast<void*>(&pin_num));
+    if ((port_num < 0) || (port_num > self->gpi_count)) {
+        log_error("GPI mapping port %d is out of the supported GPI range!", port_num);
+        return;
+    }
+    self->gpi_pins[port_num].mapped = true;
+    libgpio_update_pin(self, &self->gpi_pins[port_num], pin_num);
 }
 
 //---------------------------------------------------------------------------
 // Add mapping GPO number -> HW pin number
 void libgpio_add_gpo_mapping(libgpio_t* self, int port_num, int pin_num)
 {
-    log_debug("adding GPIO mapping from port %d to pin %d", port_num, pin_num);
-    zhashx_insert(self->gpo_mapping, static_cast<void*>(&port_num), static_cast<void*>(&pin_num));
+    log_debug("adding GPO mapping from port %d to pin %d", port_num, pin_num);
+    if ((port_num < 0) || (port_num > self->gpo_count)) {
+        log_error("GPO mapping port %d is out of the supported GPO range!", port_num);
+        return;
+    }
+    self->gpo_pins[port_num].mapped = true;
+    libgpio_update_pin(self, &self->gpo_pins[port_num], pin_num);
 }
 //  --------------------------------------------------------------------------
 //  Set the test mode
@@ -174,210 +218,464 @@ void libgpio_set_test_mode(libgpio_t* self, bool test_mode)
 {
     log_debug("setting test_mode to '%s'", (test_mode == true) ? "True" : "False");
     self->test_mode = test_mode;
+    // sysfs paths depend on the test mode
+    libgpio_resize_pin_map(self, GPIO_DIRECTION_IN, self->gpi_count);
+    libgpio_resize_pin_map(self, GPIO_DIRECTION_OUT, self->gpo_count);
 }
 
 //  --------------------------------------------------------------------------
-//  Compute and store HW pin number
-int libgpio_compute_pin_number(libgpio_t* self, int GPx_number, int direction)
+//  Set the pin session mode
+
+void libgpio_set_persistent(libgpio_t* self, bool persistent)
 {
-    if (direction == GPIO_DIRECTION_IN) {
-        int* found_pin_ptr = static_cast<int*>(zhashx_lookup(self->gpi_mapping, static_cast<const void*>(&GPx_number)));
-        if (found_pin_ptr == NULL) {
-            int pin = self->gpio_base_address + self->gpi_offset + GPx_number;
-            zhashx_update(self->gpi_mapping, static_cast<const void*>(&GPx_number), static_cast<void*>(&pin));
-            return pin;
-        } else
-            return *found_pin_ptr;
-    } else {
-        int* found_pin_ptr = static_cast<int*>(zhashx_lookup(self->gpo_mapping, static_cast<const void*>(&GPx_number)));
-        if (found_pin_ptr == NULL) {
-            int pin = self->gpio_base_address + self->gpo_offset + GPx_number;
-            zhashx_update(self->gpo_mapping, static_cast<const void*>(&GPx_number), static_cast<void*>(&pin));
-            return pin;
-        } else
-            return *found_pin_ptr;
+    log_debug("setting persistent pin sessions to '%s'", (persistent == true) ? "True" : "False");
+    self->persistent = persistent;
+    if (!persistent)
+        libgpio_close_sessions(self);
+}
+
+//  --------------------------------------------------------------------------
+//  Set the batched I/O mode
+
+void libgpio_set_batched_io(libgpio_t* self, bool batched_io)
+{
+    log_debug("setting batched I/O to '%s'", (batched_io == true) ? "True" : "False");
+    self->batched_io = batched_io;
+}
+
+//  --------------------------------------------------------------------------
+//  Close all opened pin sessions
+
+void libgpio_close_sessions(libgpio_t* self)
+{
+    for (int GPx_number = 0; GPx_number <= self->gpi_count; GPx_number++)
+        libgpio_session_close(self, &self->gpi_pins[GPx_number]);
+    for (int GPx_number = 0; GPx_number <= self->gpo_count; GPx_number++)
+        libgpio_session_close(self, &self->gpo_pins[GPx_number]);
+}
+
+//  --------------------------------------------------------------------------
+//  Set the circuit breaker parameters
+
+void libgpio_set_breaker(libgpio_t* self, int threshold, int backoff_min, int backoff_max)
+{
+    log_debug("setting breaker threshold to %i, backoff from %i to %i ms", threshold, backoff_min, backoff_max);
+    self->breaker_threshold   = threshold;
+    self->breaker_backoff_min = backoff_min;
+    self->breaker_backoff_max = backoff_max;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the circuit breaker state of a GPI or GPO
+
+int libgpio_get_breaker_state(libgpio_t* self, int GPx_number, int direction, int64_t* retry_in)
+{
+    libgpio_pin_t* gpx_pin = libgpio_get_pin(self, GPx_number, direction);
+    if (!gpx_pin)
+        return -1;
+
+    if (gpx_pin->backoff == 0) {
+        if (retry_in)
+            *retry_in = 0;
+        return GPIO_BREAKER_CLOSED;
+    }
+    if (retry_in) {
+        int64_t remaining = gpx_pin->retry_at - zclock_mono();
+        *retry_in         = (remaining > 0) ? remaining : 0;
     }
+    return GPIO_BREAKER_OPEN;
 }
 
 //  --------------------------------------------------------------------------
-//  Read a GPI or GPO status
-int libgpio_read(libgpio_t* self, int GPx_number, int direction)
+//  Get the number of quarantined GPIs and GPOs
+
+int libgpio_get_quarantined_count(libgpio_t* self)
+{
+    int count = 0;
+    for (int GPx_number = 0; GPx_number <= self->gpi_count; GPx_number++)
+        count += (self->gpi_pins[GPx_number].backoff != 0) ? 1 : 0;
+    for (int GPx_number = 0; GPx_number <= self->gpo_count; GPx_number++)
+        count += (self->gpo_pins[GPx_number].backoff != 0) ? 1 : 0;
+    return count;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of writes to the pins 'direction' attribute
+
+uint64_t libgpio_get_direction_writes(libgpio_t* self)
 {
-    char path[GPIO_VALUE_MAX];
-    char value_str[3];
-    int  retvalue = -1;
-    int  fd;
-    int  retries = GPIO_MAX_RETRY;
+    return self->direction_writes;
+}
 
-    memset(&value_str[0], 0, 3);
+//  --------------------------------------------------------------------------
+//  Get the number of avoided writes to the pins 'direction' attribute
 
+uint64_t libgpio_get_direction_writes_avoided(libgpio_t* self)
+{
+    return self->direction_writes_avoided;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of batched I/O submissions
+
+uint64_t libgpio_get_io_batches(libgpio_t* self)
+{
+    return self->io_batches;
+}
+
+//  --------------------------------------------------------------------------
+//  Get a resolved GPI or GPO, or NULL if it is out of range
+
+static inline libgpio_pin_t* libgpio_get_pin(libgpio_t* self, int GPx_number, int direction)
+{
+    if (direction == GPIO_DIRECTION_IN)
+        return ((GPx_number >= 0) && (GPx_number <= self->gpi_count)) ? &self->gpi_pins[GPx_number] : NULL;
+    else
+        return ((GPx_number >= 0) && (GPx_number <= self->gpo_count)) ? &self->gpo_pins[GPx_number] : NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the HW pin number of a GPI or GPO
+int libgpio_compute_pin_number(libgpio_t* self, int GPx_number, int direction)
+{
+    libgpio_pin_t* gpx_pin = libgpio_get_pin(self, GPx_number, direction);
+    return (gpx_pin) ? gpx_pin->pin : -1;
+}
+
+//  --------------------------------------------------------------------------
+//  Read a GPI or GPO status
+int libgpio_read(libgpio_t* self, int GPx_number, int direction)
+{
     // Sanity check
-    if (GPx_number > ((direction == GPIO_DIRECTION_IN) ? self->gpi_count : self->gpo_count)) {
+    libgpio_pin_t* gpx_pin = libgpio_get_pin(self, GPx_number, direction);
+    if (!gpx_pin) {
         log_error("Requested GPx is higher than the count of supported GPIO!");
         return -1;
     }
+    log_debug("reading GPx #%i (pin %i)", GPx_number, gpx_pin->pin);
 
-    int  pin;
-    int* pin_ptr;
-    if (direction == GPIO_DIRECTION_IN)
-        pin_ptr = static_cast<int*>(zhashx_lookup(self->gpi_mapping, static_cast<const void*>(&GPx_number)));
-    else
-        pin_ptr = static_cast<int*>(zhashx_lookup(self->gpo_mapping, static_cast<const void*>(&GPx_number)));
-    if (pin_ptr == NULL)
-        pin = libgpio_compute_pin_number(self, GPx_number, direction);
-    else
-        pin = *pin_ptr;
-    log_debug("reading GPx #%i (pin %i)", GPx_number, pin);
-    // Enable the desired GPIO
-    if (libgpio_export(self, pin) == -1) {
-        log_debug("Failed to export, aborting...");
-        goto end;
+    if (libgpio_session_open(self, gpx_pin, direction) == -1)
+        return -1;
+
+    int retvalue = self->backend->read_value(self, gpx_pin);
+    if (retvalue == -1) {
+        log_error("Failed to read value!");
+        // Drop the session, so that the next access starts from scratch
+        libgpio_session_close(self, gpx_pin);
+        libgpio_breaker_failure(self, gpx_pin);
+        return -1;
     }
+    libgpio_breaker_success(gpx_pin);
+
+    if (!self->persistent)
+        libgpio_session_close(self, gpx_pin);
 
-    // Set its direction, with a possible delay
-    while (libgpio_set_direction(self, pin, direction) == -1) {
+    return retvalue;
+}
 
-        log_warning("Failed to set direction, retrying...");
+//  --------------------------------------------------------------------------
+//  Snapshot bitmaps helpers
 
-        // Wait a bit for the sysfs to be created and udev rules to be applied
-        // so that we get the right privileges applied
-        zclock_sleep(500);
+#define SNAPSHOT_WORDS(count) ((size_t(count) / 64) + 1)
 
-        if (retries-- > 0) {
-            continue;
-        }
+static inline void s_bit_set(uint64_t* bitmap, int index, bool value)
+{
+    if (value)
+        bitmap[index / 64] |= (uint64_t(1) << (index % 64));
+    else
+        bitmap[index / 64] &= ~(uint64_t(1) << (index % 64));
+}
 
-        log_error("Failed to set direction after %i tries. Aborting!", GPIO_MAX_RETRY);
-        goto end;
-    }
+static inline bool s_bit_get(const uint64_t* bitmap, int index)
+{
+    return (bitmap[index / 64] >> (index % 64)) & 1;
+}
 
-    snprintf(path, GPIO_VALUE_MAX, "%s/sys/class/gpio/gpio%d/value",
-        (self->test_mode) ? SELFTEST_DIR_RW : "", // trick #1 to allow testing
-        pin);
-    // trick #2 to allow testing
-    if (self->test_mode)
-        mkpath(path, 0777);
-    fd = open(path, O_RDONLY | ((self->test_mode) ? O_CREAT : 0), 0777);
-    if (fd == -1) {
-        log_error("Failed to open gpio '%s' for reading!", path);
-        goto end;
-    }
+//  --------------------------------------------------------------------------
+//  Create a new snapshot covering all supported GPIs and GPOs
 
-    if (read(fd, value_str, 3) <= 0) {
-        log_error("Failed to read value!");
-        close(fd);
-        goto end;
+libgpio_snapshot_t* libgpio_snapshot_new(libgpio_t* self)
+{
+    libgpio_snapshot_t* snapshot = static_cast<libgpio_snapshot_t*>(zmalloc(sizeof(libgpio_snapshot_t)));
+    assert(snapshot);
+    snapshot->gpi_count = self->gpi_count;
+    snapshot->gpo_count = self->gpo_count;
+    // GPx numbers start at 1, hence count + 1 bits
+    size_t gpi_words = SNAPSHOT_WORDS(self->gpi_count);
+    size_t gpo_words = SNAPSHOT_WORDS(self->gpo_count);
+    // One block for all the bitmaps
+    uint64_t* bitmaps = static_cast<uint64_t*>(zmalloc(3 * (gpi_words + gpo_words) * sizeof(uint64_t)));
+    assert(bitmaps);
+    snapshot->gpi_mask  = bitmaps;
+    snapshot->gpi_valid = snapshot->gpi_mask + gpi_words;
+    snapshot->gpi_state = snapshot->gpi_valid + gpi_words;
+    snapshot->gpo_mask  = snapshot->gpi_state + gpi_words;
+    snapshot->gpo_valid = snapshot->gpo_mask + gpo_words;
+    snapshot->gpo_state = snapshot->gpo_valid + gpo_words;
+    return snapshot;
+}
+
+//  --------------------------------------------------------------------------
+//  Select a GPI or GPO to be read in the snapshot
+
+void libgpio_snapshot_select(libgpio_snapshot_t* snapshot, int GPx_number, int direction)
+{
+    if ((GPx_number < 0) ||
+        (GPx_number > ((direction == GPIO_DIRECTION_IN) ? snapshot->gpi_count : snapshot->gpo_count))) {
+        log_error("Requested GPx is out of the snapshot range!");
+        return;
     }
-    retvalue = atoi(&value_str[0]);
+    s_bit_set((direction == GPIO_DIRECTION_IN) ? snapshot->gpi_mask : snapshot->gpo_mask, GPx_number, true);
+}
+
+//  --------------------------------------------------------------------------
+//  Select all GPIs and GPOs to be read in the snapshot
+
+void libgpio_snapshot_select_all(libgpio_snapshot_t* snapshot)
+{
+    for (int GPx_number = 1; GPx_number <= snapshot->gpi_count; GPx_number++)
+        s_bit_set(snapshot->gpi_mask, GPx_number, true);
+    for (int GPx_number = 1; GPx_number <= snapshot->gpo_count; GPx_number++)
+        s_bit_set(snapshot->gpo_mask, GPx_number, true);
+}
 
-    log_trace("read value '%c'", value_str[0]);
+//  --------------------------------------------------------------------------
+//  Get the state of a GPI or GPO from the snapshot
 
-    close(fd);
+int libgpio_snapshot_get(const libgpio_snapshot_t* snapshot, int GPx_number, int direction)
+{
+    if ((GPx_number < 0) ||
+        (GPx_number > ((direction == GPIO_DIRECTION_IN) ? snapshot->gpi_count : snapshot->gpo_count)))
+        return GPIO_STATE_UNKNOWN;
+
+    const uint64_t* valid = (direction == GPIO_DIRECTION_IN) ? snapshot->gpi_valid : snapshot->gpo_valid;
+    const uint64_t* state = (direction == GPIO_DIRECTION_IN) ? snapshot->gpi_state : snapshot->gpo_state;
+    if (!s_bit_get(valid, GPx_number))
+        return GPIO_STATE_UNKNOWN;
+    return s_bit_get(state, GPx_number) ? GPIO_STATE_OPENED : GPIO_STATE_CLOSED;
+}
 
-end:
-    if (libgpio_unexport(self, pin) == -1) {
-        log_error("Failed to unexport...");
-        return -1;
+//  --------------------------------------------------------------------------
+//  Destroy the snapshot
+
+void libgpio_snapshot_destroy(libgpio_snapshot_t** snapshot_p)
+{
+    assert(snapshot_p);
+    if (*snapshot_p) {
+        libgpio_snapshot_t* snapshot = *snapshot_p;
+        // gpi_mask is the head of the bitmaps block
+        free(snapshot->gpi_mask);
+        free(snapshot);
+        *snapshot_p = NULL;
     }
+}
 
-    return retvalue;
+//  --------------------------------------------------------------------------
+//  Read all the GPIs and GPOs selected in the snapshot
+
+int libgpio_read_all(libgpio_t* self, libgpio_snapshot_t* snapshot)
+{
+    int read_count = 0;
+
+    snapshot->timestamp = zclock_time();
+    if (self->backend->read_values) {
+        read_count = libgpio_read_bulk(self, snapshot);
+        log_trace("snapshot: %i GPx read at once", read_count);
+        return read_count;
+    }
+    for (int direction = GPIO_DIRECTION_IN; direction <= GPIO_DIRECTION_OUT; direction++) {
+        int       count = (direction == GPIO_DIRECTION_IN) ? snapshot->gpi_count : snapshot->gpo_count;
+        uint64_t* mask  = (direction == GPIO_DIRECTION_IN) ? snapshot->gpi_mask : snapshot->gpo_mask;
+        uint64_t* valid = (direction == GPIO_DIRECTION_IN) ? snapshot->gpi_valid : snapshot->gpo_valid;
+        uint64_t* state = (direction == GPIO_DIRECTION_IN) ? snapshot->gpi_state : snapshot->gpo_state;
+
+        for (int GPx_number = 0; GPx_number <= count; GPx_number++) {
+            // Skip empty words at once
+            if (mask[GPx_number / 64] == 0) {
+                GPx_number |= 63;
+                continue;
+            }
+            if (!s_bit_get(mask, GPx_number))
+                continue;
+            int value = libgpio_read(self, GPx_number, direction);
+            s_bit_set(valid, GPx_number, value != GPIO_STATE_UNKNOWN);
+            s_bit_set(state, GPx_number, value == GPIO_STATE_OPENED);
+            if (value != GPIO_STATE_UNKNOWN)
+                read_count++;
+        }
+    }
+    log_trace("snapshot: %i GPx read", read_count);
+    return read_count;
 }
+
 //  --------------------------------------------------------------------------
 //  Write a GPO (to enable or disable it)
 int libgpio_write(libgpio_t* self, int GPO_number, int value)
 {
-    static const char s_values_str[] = "01";
-    char              path[GPIO_VALUE_MAX];
-    int               fd      = -1;
-    int               retval  = -1;
-    int               retries = GPIO_MAX_RETRY;
+    int retval = -1;
 
     // Sanity check
-    if (GPO_number > self->gpo_count) {
+    libgpio_pin_t* gpx_pin = libgpio_get_pin(self, GPO_number, GPIO_DIRECTION_OUT);
+    if (!gpx_pin) {
         log_error("Requested GPx is higher than the count of supported GPIO!");
         return -1;
     }
 
-    int  pin;
-    int* pin_ptr = static_cast<int*>(zhashx_lookup(self->gpo_mapping, static_cast<const void*>(&GPO_number)));
-    if (pin_ptr == NULL)
-        pin = libgpio_compute_pin_number(self, GPO_number, GPIO_DIRECTION_OUT);
-    else
-        pin = *pin_ptr;
+    log_trace("writing GPO #%i (pin %i)", GPO_number, gpx_pin->pin);
 
-    log_trace("writing GPO #%i (pin %i)", GPO_number, pin);
+    if (libgpio_session_open(self, gpx_pin, GPIO_DIRECTION_OUT) == -1)
+        return -1;
 
-    // Enable the desired GPIO
-    if (libgpio_export(self, pin) == -1) {
-        log_error("Failed to export, aborting...");
-        goto end;
-    }
+    if (self->backend->write_value(self, gpx_pin, value) == -1) {
+        log_error("Failed to write value!");
+        libgpio_session_close(self, gpx_pin);
+        libgpio_breaker_failure(self, gpx_pin);
+        return -1;
+    } else
+        retval = 0;
+    libgpio_breaker_success(gpx_pin);
+
+    log_trace("wrote value '%i' with result %i", value, retval);
 
-    // Set its direction, with a possible delay
-    while (libgpio_set_direction(self, pin, GPIO_DIRECTION_OUT) == -1) {
+    if (!self->persistent)
+        libgpio_session_close(self, gpx_pin);
 
-        log_warning("Failed to set direction, retrying...");
+    return retval;
+}
 
-        // Wait a bit for the sysfs to be created and udev rules to be applied
-        // so that we get the right privileges applied
-        zclock_sleep(500);
+//  --------------------------------------------------------------------------
+//  Write several GPOs, at once if the backend supports it
+int libgpio_write_many(libgpio_t* self, const int* GPO_numbers, const int* values, int count, int* results)
+{
+    int write_count = 0;
+
+    if (!self->backend->write_values) {
+        for (int i = 0; i < count; i++) {
+            int retval = libgpio_write(self, GPO_numbers[i], values[i]);
+            if (results)
+                results[i] = retval;
+            write_count += (retval == 0) ? 1 : 0;
+        }
+        return write_count;
+    }
 
-        if (retries-- > 0) {
+    libgpio_pin_t** gpx_pins    = static_cast<libgpio_pin_t**>(zmalloc(size_t(count + 1) * sizeof(libgpio_pin_t*)));
+    int*            pin_values  = static_cast<int*>(zmalloc(size_t(count + 1) * sizeof(int)));
+    int*            pin_indexes = static_cast<int*>(zmalloc(size_t(count + 1) * sizeof(int)));
+    assert(gpx_pins && pin_values && pin_indexes);
+
+    // Open all the sessions first, then write all the values at once
+    int pin_count = 0;
+    for (int i = 0; i < count; i++) {
+        if (results)
+            results[i] = -1;
+        libgpio_pin_t* gpx_pin = libgpio_get_pin(self, GPO_numbers[i], GPIO_DIRECTION_OUT);
+        if (!gpx_pin) {
+            log_error("Requested GPx is higher than the count of supported GPIO!");
             continue;
         }
-
-        log_error("Failed to set direction after %i tries. Aborting!", GPIO_MAX_RETRY);
-        goto end;
+        if (libgpio_session_open(self, gpx_pin, GPIO_DIRECTION_OUT) == -1)
+            continue;
+        gpx_pins[pin_count]    = gpx_pin;
+        pin_values[pin_count]  = values[i];
+        pin_indexes[pin_count] = i;
+        pin_count++;
     }
 
-    // trick #2 to allow testing
-    snprintf(path, GPIO_VALUE_MAX, "%s/sys/class/gpio/gpio%d/value",
-        (self->test_mode) ? SELFTEST_DIR_RW : "", // trick #1 to allow testing
-        pin);
-    if (self->test_mode)
-        mkpath(path, 0777);
-    fd = open(path, O_WRONLY | ((self->test_mode) ? O_CREAT : 0), 0777);
-    if (fd == -1) {
-        log_error("Failed to open gpio value for writing (path: %s)!", path);
-        retval = -1;
-        goto end;
+    bool failed = (pin_count > 0) && (self->backend->write_values(self, gpx_pins, pin_count, pin_values) == -1);
+    for (int i = 0; i < pin_count; i++) {
+        if (failed) {
+            log_error("Failed to write value of pin %d!", gpx_pins[i]->pin);
+            libgpio_session_close(self, gpx_pins[i]);
+            libgpio_breaker_failure(self, gpx_pins[i]);
+            continue;
+        }
+        libgpio_breaker_success(gpx_pins[i]);
+        if (!self->persistent)
+            libgpio_session_close(self, gpx_pins[i]);
+        if (results)
+            results[pin_indexes[i]] = 0;
+        write_count++;
     }
+    log_trace("%i/%i GPO written at once", write_count, count);
 
-    if (write(fd, &s_values_str[GPIO_STATE_CLOSED == value ? 0 : 1], 1) != 1) {
-        log_error("Failed to write value!");
-        retval = -1;
-    } else
-        retval = 0;
+    free(pin_indexes);
+    free(pin_values);
+    free(gpx_pins);
+    return write_count;
+}
 
-    log_trace("wrote value '%i' with result %i", value, retval);
+//  --------------------------------------------------------------------------
+//  Get the kernel timestamp of the last edge signaled on a GPI
+int64_t libgpio_get_edge_timestamp(libgpio_t* self, int GPI_number)
+{
+    libgpio_pin_t* gpx_pin = libgpio_get_pin(self, GPI_number, GPIO_DIRECTION_IN);
+    return (gpx_pin) ? gpx_pin->edge_timestamp : 0;
+}
 
-    close(fd);
-end:
-    if (libgpio_unexport(self, pin) == -1) {
-        retval = -1;
+
+//  --------------------------------------------------------------------------
+//  Set the edge(s) on which a GPI value change is signaled
+int libgpio_set_edge(libgpio_t* self, int GPI_number, int edge)
+{
+    // Sanity check
+    libgpio_pin_t* gpx_pin = libgpio_get_pin(self, GPI_number, GPIO_DIRECTION_IN);
+    if (!gpx_pin) {
+        log_error("Requested GPx is higher than the count of supported GPIO!");
+        return -1;
     }
-    return retval;
+
+    // Edges are only supported on inputs
+    if (libgpio_session_open(self, gpx_pin, GPIO_DIRECTION_IN) == -1)
+        return -1;
+    if (gpx_pin->edge == edge)
+        return 0;
+
+    if (self->backend->set_edge(self, gpx_pin, edge) == -1)
+        return -1;
+    gpx_pin->edge = edge;
+
+    log_debug(
+        "edge '%s' set on GPI #%i (pin %i)", (GPIO_EDGE_NONE == edge) ? "none" : "both", GPI_number, gpx_pin->pin);
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the edge(s) signaled on a GPI value fd
+int libgpio_get_edge(libgpio_t* self, int GPI_number)
+{
+    libgpio_pin_t* gpx_pin = libgpio_get_pin(self, GPI_number, GPIO_DIRECTION_IN);
+    return (gpx_pin && gpx_pin->opened) ? gpx_pin->edge : GPIO_EDGE_NONE;
 }
 
+//  --------------------------------------------------------------------------
+//  Get the value fd of a GPI or GPO, for polling
+int libgpio_get_value_fd(libgpio_t* self, int GPx_number, int direction)
+{
+    libgpio_pin_t* gpx_pin = libgpio_get_pin(self, GPx_number, direction);
+    return (gpx_pin) ? gpx_pin->value_fd : -1;
+}
 
 //  --------------------------------------------------------------------------
 //  Get the textual name for a status
 std::string libgpio_get_status_string(int value)
 {
-    std::string status_str;
+    return std::string(libgpio_get_status_name(value));
+}
 
+//  --------------------------------------------------------------------------
+//  Get the textual name for a status, as a static string
+const char* libgpio_get_status_name(int value)
+{
     switch (value) {
         case GPIO_STATE_CLOSED:
-            status_str = "closed";
-            break;
+            return "closed";
         case GPIO_STATE_OPENED:
-            status_str = "opened";
-            break;
+            return "opened";
         case GPIO_STATE_UNKNOWN:
         default:
-            status_str = ""; // FIXME: return "unknown"?
+            return ""; // FIXME: return "unknown"?
     }
-    return status_str;
 }
 
 //  --------------------------------------------------------------------------
@@ -407,8 +705,11 @@ void libgpio_destroy(libgpio_t** self_p)
     if (*self_p) {
         libgpio_t* self = *self_p;
         //  Free class properties here
-        zhashx_destroy(&self->gpi_mapping);
-        zhashx_destroy(&self->gpo_mapping);
+        libgpio_close_sessions(self);
+        if (self->backend->destroy)
+            self->backend->destroy(self);
+        free(self->gpi_pins);
+        free(self->gpo_pins);
         //  Free object itself
         free(self);
         *self_p = NULL;
@@ -419,121 +720,263 @@ void libgpio_destroy(libgpio_t** self_p)
 //  Private functions
 
 //  --------------------------------------------------------------------------
-//  Set the current GPIO pin to act on
+//  Set the current GPIO direction to 'in' (read) or 'out' (write)
+
+static int libgpio_set_direction(libgpio_t* self, libgpio_pin_t* gpx_pin, int direction)
+{
+    if (self->backend->set_direction(self, gpx_pin, direction) == -1)
+        return -1;
+    self->direction_writes++;
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Open the session of a pin if needed: export the pin, set its direction and
+//  open its value fd, unless it is quarantined by its circuit breaker.
+//  Return 0 on success, -1 otherwise
 
-int libgpio_export(libgpio_t* self, int pin)
+static int libgpio_session_open(libgpio_t* self, libgpio_pin_t* gpx_pin, int direction)
 {
-    char    buffer[GPIO_BUFFER_MAX];
-    char    path[GPIO_VALUE_MAX];
-    ssize_t bytes_written;
-    int     fd;
-    int     retval = 0;
+    // Only write the direction when it differs from the configured one: this
+    // saves syscalls, and writing 'out' would also reset the output value
+    if (gpx_pin->opened) {
+        if (gpx_pin->direction != direction) {
+            if (libgpio_set_direction(self, gpx_pin, direction) == -1) {
+                libgpio_session_close(self, gpx_pin);
+                libgpio_breaker_failure(self, gpx_pin);
+                return -1;
+            }
+            gpx_pin->direction = direction;
+        } else
+            self->direction_writes_avoided++;
+        return 0;
+    }
 
-    snprintf(path, GPIO_VALUE_MAX, "%s/sys/class/gpio/export",
-        (self->test_mode) ? SELFTEST_DIR_RW : ""); // trick #1 to allow testing
-    // trick #2 to allow testing
-    if (self->test_mode)
-        mkpath(path, 0777);
-    fd = open(path, O_WRONLY | ((self->test_mode) ? O_CREAT : 0), 0777);
-    if (fd == -1) {
-        log_error("Failed to open %s for writing! %i", path, errno);
+    // Fail fast while the pin is quarantined
+    if ((gpx_pin->backoff != 0) && (zclock_mono() < gpx_pin->retry_at)) {
+        log_trace("pin %d is quarantined, skipping", gpx_pin->pin);
         return -1;
     }
-    log_debug("exporting pin %d", pin);
 
-    bytes_written = snprintf(buffer, GPIO_BUFFER_MAX, "%d", pin);
-    if (write(fd, buffer, size_t(bytes_written)) < bytes_written) {
-        log_error("wrote less than %i bytes (errno %i)", bytes_written, errno);
-        retval = -1;
+    if (libgpio_session_setup(self, gpx_pin, direction) == -1) {
+        libgpio_breaker_failure(self, gpx_pin);
+        return -1;
     }
-
-    close(fd);
-    return retval;
+    return 0;
 }
 
 //  --------------------------------------------------------------------------
-//  Unset the current GPIO pin to act on
+//  Setup a new session for a pin: export it, set its direction and open its
+//  value fd.
+//  Return 0 on success, -1 otherwise
 
-int libgpio_unexport(libgpio_t* self, int pin)
+static int libgpio_session_setup(libgpio_t* self, libgpio_pin_t* gpx_pin, int direction)
 {
-    char    buffer[GPIO_BUFFER_MAX];
-    char    path[GPIO_VALUE_MAX];
-    ssize_t bytes_written;
-    int     fd;
-    int     retval = 0;
+    // Enable the desired GPIO
+    if (self->backend->export_pin(self, gpx_pin) == -1) {
+        log_error("Failed to export, aborting...");
+        return -1;
+    }
 
-    snprintf(path, GPIO_VALUE_MAX, "%s/sys/class/gpio/unexport",
-        (self->test_mode) ? SELFTEST_DIR_RW : ""); // trick #1 to allow testing
-    // trick #2 to allow testing
-    if (self->test_mode)
-        mkpath(path, 0777);
-    fd = open(path, O_WRONLY | ((self->test_mode) ? O_CREAT : 0), 0777);
-    if (fd == -1) {
-        log_error("Failed to open unexport for writing!");
+    // Set its direction, unless the pin was already configured so
+    if (self->backend->get_direction(self, gpx_pin) == direction)
+        self->direction_writes_avoided++;
+    else if (libgpio_set_direction(self, gpx_pin, direction) == -1) {
+        self->backend->unexport_pin(self, gpx_pin);
         return -1;
     }
 
-    bytes_written = snprintf(buffer, GPIO_BUFFER_MAX, "%d", pin);
-    if (write(fd, buffer, size_t(bytes_written)) < bytes_written) {
-        log_error("wrote less than %i bytes", bytes_written);
-        retval = -1;
+    if (self->backend->open_value(self, gpx_pin) == -1) {
+        self->backend->unexport_pin(self, gpx_pin);
+        return -1;
     }
 
-    close(fd);
-    return retval;
+    gpx_pin->opened    = true;
+    gpx_pin->direction = direction;
+    gpx_pin->edge      = GPIO_EDGE_NONE;
+    return 0;
 }
 
-
 //  --------------------------------------------------------------------------
-//  Set the current GPIO direction to 'in' (read) or 'out' (write)
+//  Close the session of a pin, if opened: close its value fd and unexport it
 
-int libgpio_set_direction(libgpio_t* self, int pin, int direction)
+static void libgpio_session_close(libgpio_t* self, libgpio_pin_t* gpx_pin)
 {
-    static const char s_directions_str[] = "in\0out";
-    int               retval             = 0;
+    if (!gpx_pin->opened)
+        return;
+    self->backend->close_value(self, gpx_pin);
+    gpx_pin->opened = false;
+    if (self->backend->unexport_pin(self, gpx_pin) == -1)
+        log_error("Failed to unexport...");
+}
 
-    char path[GPIO_DIRECTION_MAX];
-    int  fd;
+//  --------------------------------------------------------------------------
+//  Read all the GPIs and GPOs selected in a snapshot with a single backend
+//  bulk access. Return the number of GPx successfully read
 
-    snprintf(path, GPIO_DIRECTION_MAX, "%s/sys/class/gpio/gpio%d/direction",
-        ((self->test_mode) ? SELFTEST_DIR_RW : ""), // trick #1 to allow testing
-        pin);
-    // trick #2 to allow testing
-    if (self->test_mode)
-        mkpath(path, 0777);
-    fd = open(path, O_WRONLY | ((self->test_mode) ? O_CREAT : 0), 0777);
-    if (fd == -1) {
-        log_error("Failed to open %s for writing!", path);
-        return -1;
+static int libgpio_read_bulk(libgpio_t* self, libgpio_snapshot_t* snapshot)
+{
+    size_t          size        = size_t(snapshot->gpi_count + snapshot->gpo_count + 2);
+    libgpio_pin_t** gpx_pins    = static_cast<libgpio_pin_t**>(zmalloc(size * sizeof(libgpio_pin_t*)));
+    int*            gpx_values  = static_cast<int*>(zmalloc(size * sizeof(int)));
+    int*            gpx_numbers = static_cast<int*>(zmalloc(size * sizeof(int)));
+    int*            gpx_dirs    = static_cast<int*>(zmalloc(size * sizeof(int)));
+    assert(gpx_pins && gpx_values && gpx_numbers && gpx_dirs);
+
+    // Open all the sessions first, then read all the values at once
+    int pin_count = 0;
+    for (int direction = GPIO_DIRECTION_IN; direction <= GPIO_DIRECTION_OUT; direction++) {
+        int       count = (direction == GPIO_DIRECTION_IN) ? snapshot->gpi_count : snapshot->gpo_count;
+        uint64_t* mask  = (direction == GPIO_DIRECTION_IN) ? snapshot->gpi_mask : snapshot->gpo_mask;
+        uint64_t* valid = (direction == GPIO_DIRECTION_IN) ? snapshot->gpi_valid : snapshot->gpo_valid;
+
+        for (int GPx_number = 0; GPx_number <= count; GPx_number++) {
+            if (mask[GPx_number / 64] == 0) {
+                GPx_number |= 63;
+                continue;
+            }
+            if (!s_bit_get(mask, GPx_number))
+                continue;
+            libgpio_pin_t* gpx_pin = libgpio_get_pin(self, GPx_number, direction);
+            if (!gpx_pin || (libgpio_session_open(self, gpx_pin, direction) == -1)) {
+                s_bit_set(valid, GPx_number, false);
+                continue;
+            }
+            gpx_pins[pin_count]    = gpx_pin;
+            gpx_numbers[pin_count] = GPx_number;
+            gpx_dirs[pin_count]    = direction;
+            pin_count++;
+        }
     }
 
-    if (write(fd, &s_directions_str[GPIO_DIRECTION_IN == direction ? 0 : 3], GPIO_DIRECTION_IN == direction ? 2 : 3) ==
-        -1) {
-        log_error("Failed to set direction!");
-        retval = -1;
+    if ((pin_count > 0) && (self->backend->read_values(self, gpx_pins, pin_count, gpx_values) == -1))
+        for (int i = 0; i < pin_count; i++)
+            gpx_values[i] = -1;
+
+    int read_count = 0;
+    for (int i = 0; i < pin_count; i++) {
+        int       value = gpx_values[i];
+        uint64_t* valid = (gpx_dirs[i] == GPIO_DIRECTION_IN) ? snapshot->gpi_valid : snapshot->gpo_valid;
+        uint64_t* state = (gpx_dirs[i] == GPIO_DIRECTION_IN) ? snapshot->gpi_state : snapshot->gpo_state;
+        if (value == -1) {
+            log_error("Failed to read value of pin %d!", gpx_pins[i]->pin);
+            libgpio_session_close(self, gpx_pins[i]);
+            libgpio_breaker_failure(self, gpx_pins[i]);
+        } else {
+            libgpio_breaker_success(gpx_pins[i]);
+            if (!self->persistent)
+                libgpio_session_close(self, gpx_pins[i]);
+            read_count++;
+        }
+        s_bit_set(valid, gpx_numbers[i], value != GPIO_STATE_UNKNOWN);
+        s_bit_set(state, gpx_numbers[i], value == GPIO_STATE_OPENED);
     }
 
-    close(fd);
-    return retval;
+    free(gpx_dirs);
+    free(gpx_numbers);
+    free(gpx_values);
+    free(gpx_pins);
+    return read_count;
 }
 
 //  --------------------------------------------------------------------------
-//  Helper function to recursively create directories
+//  Account a failed access to a pin, and quarantine it after too many
+//  consecutive failures, doubling the quarantine duration on each new failure
 
-// FIXME: replace with zsys_dir_create (const char *pathname, ...);
-static int mkpath(char* file_path, mode_t mode)
+static void libgpio_breaker_failure(libgpio_t* self, libgpio_pin_t* gpx_pin)
 {
-    assert(file_path && *file_path);
-    char* p;
-    for (p = strchr(file_path + 1, '/'); p; p = strchr(p + 1, '/')) {
-        *p = '\0';
-        if (mkdir(file_path, mode) == -1) {
-            if (errno != EEXIST) {
-                *p = '/';
-                return -1;
-            }
+    gpx_pin->failures++;
+    if (gpx_pin->failures < self->breaker_threshold)
+        return;
+
+    if (gpx_pin->backoff == 0)
+        gpx_pin->backoff = self->breaker_backoff_min;
+    else
+        gpx_pin->backoff = (gpx_pin->backoff > self->breaker_backoff_max / 2) ? self->breaker_backoff_max
+                                                                             : gpx_pin->backoff * 2;
+    gpx_pin->retry_at = zclock_mono() + gpx_pin->backoff;
+    log_warning("pin %d failed %i times, quarantined for %i ms", gpx_pin->pin, gpx_pin->failures, gpx_pin->backoff);
+}
+
+//  --------------------------------------------------------------------------
+//  Account a successful access to a pin, closing its breaker
+
+static void libgpio_breaker_success(libgpio_pin_t* gpx_pin)
+{
+    if (gpx_pin->failures == 0)
+        return;
+    if (gpx_pin->backoff != 0)
+        log_info("pin %d recovered after %i failures", gpx_pin->pin, gpx_pin->failures);
+    gpx_pin->failures = 0;
+    gpx_pin->backoff  = 0;
+    gpx_pin->retry_at = 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Set the HW pin number of a resolved GPx, and precompute its sysfs paths
+
+static void libgpio_update_pin(libgpio_t* self, libgpio_pin_t* gpx_pin, int pin)
+{
+    // The pin changed under an opened session, release it first, and start
+    // from a fresh health state
+    if (gpx_pin->pin != pin) {
+        libgpio_session_close(self, gpx_pin);
+        libgpio_breaker_success(gpx_pin);
+    }
+
+    gpx_pin->pin          = pin;
+    const char* sysfs_dir = (self->test_mode) ? SELFTEST_DIR_RW : ""; // trick #1 to allow testing
+    snprintf(gpx_pin->value_path, GPIO_VALUE_MAX, "%s/sys/class/gpio/gpio%d/value", sysfs_dir, pin);
+    snprintf(gpx_pin->direction_path, GPIO_DIRECTION_MAX, "%s/sys/class/gpio/gpio%d/direction", sysfs_dir, pin);
+    snprintf(gpx_pin->edge_path, GPIO_VALUE_MAX, "%s/sys/class/gpio/gpio%d/edge", sysfs_dir, pin);
+}
+
+//  --------------------------------------------------------------------------
+//  Resolve the HW pin number of all GPIs or GPOs, from the chipset base
+//  address and offset, unless explicitly mapped
+
+static void libgpio_update_pin_map(libgpio_t* self, int direction)
+{
+    int            count  = (direction == GPIO_DIRECTION_IN) ? self->gpi_count : self->gpo_count;
+    int            offset = (direction == GPIO_DIRECTION_IN) ? self->gpi_offset : self->gpo_offset;
+    libgpio_pin_t* pins   = (direction == GPIO_DIRECTION_IN) ? self->gpi_pins : self->gpo_pins;
+
+    for (int GPx_number = 0; GPx_number <= count; GPx_number++) {
+        libgpio_pin_t* gpx_pin = &pins[GPx_number];
+        libgpio_update_pin(
+            self, gpx_pin, (gpx_pin->mapped) ? gpx_pin->pin : self->gpio_base_address + offset + GPx_number);
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  (Re)build the pin map of all GPIs or GPOs for the given count. This drops
+//  explicit mappings and closes sessions when the count changes
+
+static void libgpio_resize_pin_map(libgpio_t* self, int direction, int count)
+{
+    libgpio_pin_t** pins_p    = (direction == GPIO_DIRECTION_IN) ? &self->gpi_pins : &self->gpo_pins;
+    int*            count_p   = (direction == GPIO_DIRECTION_IN) ? &self->gpi_count : &self->gpo_count;
+    const char*     sysfs_dir = (self->test_mode) ? SELFTEST_DIR_RW : ""; // trick #1 to allow testing
+
+    snprintf(self->export_path, GPIO_VALUE_MAX, "%s/sys/class/gpio/export", sysfs_dir);
+    snprintf(self->unexport_path, GPIO_VALUE_MAX, "%s/sys/class/gpio/unexport", sysfs_dir);
+
+    if (count < 0)
+        count = 0;
+    if ((*pins_p == NULL) || (count != *count_p)) {
+        if (*pins_p) {
+            for (int GPx_number = 0; GPx_number <= *count_p; GPx_number++)
+                libgpio_session_close(self, &(*pins_p)[GPx_number]);
+            free(*pins_p);
         }
-        *p = '/';
+        // GPx numbers start at 1, hence count + 1 entries
+        *pins_p = static_cast<libgpio_pin_t*>(zmalloc(size_t(count + 1) * sizeof(libgpio_pin_t)));
+        assert(*pins_p);
+        for (int GPx_number = 0; GPx_number <= count; GPx_number++) {
+            (*pins_p)[GPx_number].pin      = -1;
+            (*pins_p)[GPx_number].value_fd = -1;
+        }
+        *count_p = count;
     }
-    return 0;
+    libgpio_update_pin_map(self, direction);
 }
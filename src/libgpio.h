@@ -35,43 +35,194 @@
 #define GPIO_STATE_CLOSED  0
 #define GPIO_STATE_OPENED  1
 
+// Edges triggering an interrupt on the value fd (POLLPRI)
+#define GPIO_EDGE_NONE 0
+#define GPIO_EDGE_BOTH 1
+
 // Defines
-#define GPIO_BUFFER_MAX    4
+#define GPIO_BUFFER_MAX    12
 #define GPIO_DIRECTION_MAX 64 // 35
 #define GPIO_VALUE_MAX     64 // 30
-#define GPIO_MAX_RETRY     3
+#define GPIO_READY_TIMEOUT 1500 // ms to wait for udev to setup an exported pin
+#define GPIO_READY_POLL    100  // ms between readiness checks, if no inotify event
+
+// Per-pin circuit breaker: after GPIO_BREAKER_THRESHOLD consecutive failures,
+// the pin is quarantined and retried with an exponential backoff (ms)
+#define GPIO_BREAKER_CLOSED      0 // pin healthy, accessed normally
+#define GPIO_BREAKER_OPEN        1 // pin quarantined, accesses fail immediately
+#define GPIO_BREAKER_THRESHOLD   3
+#define GPIO_BREAKER_BACKOFF_MIN 1000
+#define GPIO_BREAKER_BACKOFF_MAX 300000
 
 #define GPIO_POWERED_SELF     1
 #define GPIO_POWERED_EXTERNAL 2
 
+///  Resolved GPx: HW pin number with its precomputed sysfs paths, and its
+///  session (pin exported, direction set and value fd kept opened)
+struct libgpio_pin_t
+{
+    int     pin;                                // HW pin number
+    bool    mapped;                             // true if the pin number comes from an explicit mapping
+    int     direction;                          // direction applied on the pin
+    bool    opened;                             // true if the pin session is opened
+    int     value_fd;                           // 'value' fd of the session, polled for edges (-1 if none)
+    int     edge;                               // edge applied on the pin (GPIO_EDGE_xxx)
+    char    value_path[GPIO_VALUE_MAX];         // sysfs 'value' attribute
+    char    direction_path[GPIO_DIRECTION_MAX]; // sysfs 'direction' attribute
+    char    edge_path[GPIO_VALUE_MAX];          // sysfs 'edge' attribute
+    int     failures;                           // consecutive failed accesses
+    int     backoff;                            // current quarantine duration (ms), 0 if breaker closed
+    int64_t retry_at;                           // monotonic time (ms) of the next allowed access
+    int64_t edge_timestamp;                     // kernel timestamp (ns since epoch) of the last edge, 0 if unknown
+};
+
+///  Point-in-time snapshot of GPx states, as packed bitmaps indexed by GPx number
+struct libgpio_snapshot_t
+{
+    int64_t   timestamp;  // time at which the snapshot was taken (ms since epoch)
+    int       gpi_count;  // number of GPIs covered
+    int       gpo_count;  // number of GPOs covered
+    uint64_t* gpi_mask;   // GPIs to read
+    uint64_t* gpi_valid;  // GPIs successfully read
+    uint64_t* gpi_state;  // GPIs read as opened
+    uint64_t* gpo_mask;   // GPOs to read
+    uint64_t* gpo_valid;  // GPOs successfully read
+    uint64_t* gpo_state;  // GPOs read as opened
+};
+
+struct libgpio_t;
+
+///  GPIO access backend: how pins are exported, configured and accessed.
+///  Operations return 0 (or the value read) on success, -1 otherwise
+struct libgpio_backend_t
+{
+    const char* name;
+    // Export a pin, and wait for it to be ready for use
+    int (*export_pin)(libgpio_t* self, libgpio_pin_t* gpx_pin);
+    // Release an exported pin
+    int (*unexport_pin)(libgpio_t* self, libgpio_pin_t* gpx_pin);
+    // Get the direction currently configured on an exported pin, -1 if unknown
+    int (*get_direction)(libgpio_t* self, libgpio_pin_t* gpx_pin);
+    int (*set_direction)(libgpio_t* self, libgpio_pin_t* gpx_pin, int direction);
+    // Open and close the value access of an exported pin
+    int (*open_value)(libgpio_t* self, libgpio_pin_t* gpx_pin);
+    void (*close_value)(libgpio_t* self, libgpio_pin_t* gpx_pin);
+    int (*read_value)(libgpio_t* self, libgpio_pin_t* gpx_pin);
+    int (*write_value)(libgpio_t* self, libgpio_pin_t* gpx_pin, int value);
+    // Set the edges signaled on the pin value_fd, as edge_events poll events
+    int (*set_edge)(libgpio_t* self, libgpio_pin_t* gpx_pin, int edge);
+    short edge_events;
+    // Release the backend private data (may be NULL)
+    void (*destroy)(libgpio_t* self);
+    // Optional bulk accesses of opened pins (may be NULL), values being indexed
+    // like gpx_pins. Read values are -1 for the pins which failed, and both
+    // return -1 if the whole access failed
+    int (*read_values)(libgpio_t* self, libgpio_pin_t** gpx_pins, int count, int* values);
+    int (*write_values)(libgpio_t* self, libgpio_pin_t** gpx_pins, int count, const int* values);
+};
+
+///  Linux sysfs backend (/sys/class/gpio), the default one
+extern const libgpio_backend_t libgpio_sysfs_backend;
+///  In-memory simulation backend (see libgpio_sim.h)
+extern const libgpio_backend_t libgpio_sim_backend;
+///  Linux GPIO character device backend (/dev/gpiochipN, uAPI v2, see libgpio_cdev.h)
+extern const libgpio_backend_t libgpio_cdev_backend;
+
 ///  Structure of our class
 struct libgpio_t
 {
-    int       gpio_base_address; // Base address of the GPIOs chipset
-    bool      test_mode;         // true if we are in test mode, false otherwise
-    int       gpo_offset;        // offset to access GPO pins
-    int       gpi_offset;        // offset to access GPI pins
-    int       gpo_count;         // number of supported GPO
-    int       gpi_count;         // number of supported GPI
-    zhashx_t* gpi_mapping;       // mapping for GPIs
-    zhashx_t* gpo_mapping;       // mapping for GPOs
+    const libgpio_backend_t* backend;                       // GPIO access backend
+    void*                    backend_data;                  // backend private data
+    int                      gpio_base_address;             // Base address of the GPIOs chipset
+    bool                     test_mode;                     // true if we are in test mode, false otherwise
+    bool                     persistent;                    // true to keep pin sessions opened between accesses
+    bool                     batched_io;                    // true to read and write several pins at once (sysfs)
+    int                      gpo_offset;                    // offset to access GPO pins
+    int                      gpi_offset;                    // offset to access GPI pins
+    int                      gpo_count;                     // number of supported GPO
+    int                      gpi_count;                     // number of supported GPI
+    libgpio_pin_t*           gpi_pins;                      // GPI pins, indexed by GPI number (0 to gpi_count)
+    libgpio_pin_t*           gpo_pins;                      // GPO pins, indexed by GPO number (0 to gpo_count)
+    char                     export_path[GPIO_VALUE_MAX];   // sysfs 'export' file
+    char                     unexport_path[GPIO_VALUE_MAX]; // sysfs 'unexport' file
+    int                      breaker_threshold;             // consecutive failures before quarantining a pin
+    int                      breaker_backoff_min;           // initial quarantine duration (ms)
+    int                      breaker_backoff_max;           // maximum quarantine duration (ms)
+    uint64_t                 direction_writes;              // number of writes to 'direction' attributes
+    uint64_t                 direction_writes_avoided;      // number of 'direction' writes avoided, already configured
+    uint64_t                 io_batches;                    // number of batched I/O submissions
 };
 
 ///  Create a new libgpio
 libgpio_t* libgpio_new(void);
 
-///  Compute and store HW pin number
+///  Set the GPIO access backend, closing all opened pin sessions
+void libgpio_set_backend(libgpio_t* self, const libgpio_backend_t* backend);
+
+///  Get a backend by its name (sysfs, sim, cdev), or NULL if unknown
+const libgpio_backend_t* libgpio_lookup_backend(const char* name);
+
+///  Get the poll events signaling an edge on the value fds (ZMQ_POLLxxx)
+short libgpio_get_edge_events(libgpio_t* self);
+
+///  Get the HW pin number of a GPI or GPO, or -1 if it is out of range
 int libgpio_compute_pin_number(libgpio_t* self, int GPx_number, int direction);
 
 ///  Read a GPI or GPO status
 int libgpio_read(libgpio_t* self_p, int GPx_number, int direction = GPIO_DIRECTION_IN);
 
+///  Create a new snapshot covering all supported GPIs and GPOs, with none selected
+libgpio_snapshot_t* libgpio_snapshot_new(libgpio_t* self);
+
+///  Select a GPI or GPO to be read in the snapshot
+void libgpio_snapshot_select(libgpio_snapshot_t* snapshot, int GPx_number, int direction);
+
+///  Select all GPIs and GPOs to be read in the snapshot
+///  Note: as for libgpio_read, reading a GPO sets its direction
+void libgpio_snapshot_select_all(libgpio_snapshot_t* snapshot);
+
+///  Get the state of a GPI or GPO from the snapshot, GPIO_STATE_UNKNOWN if not read
+int libgpio_snapshot_get(const libgpio_snapshot_t* snapshot, int GPx_number, int direction);
+
+///  Destroy the snapshot
+void libgpio_snapshot_destroy(libgpio_snapshot_t** snapshot_p);
+
+///  Read all the GPIs and GPOs selected in the snapshot, back to back (or at
+///  once, if the backend supports it), and timestamp it.
+///  Return the number of GPx successfully read
+int libgpio_read_all(libgpio_t* self, libgpio_snapshot_t* snapshot);
+
 ///  Write a GPO (to enable or disable it)
 int libgpio_write(libgpio_t* self_p, int GPO_number, int value);
 
+///  Write several GPOs, at once if the backend supports it. If results is
+///  set, it receives the result of each write (0 on success, -1 otherwise).
+///  Return the number of GPOs successfully written
+int libgpio_write_many(libgpio_t* self, const int* GPO_numbers, const int* values, int count, int* results = NULL);
+
+///  Get the kernel timestamp (ns since epoch) of the last edge signaled on a
+///  GPI, or 0 if unknown (not supported by the backend)
+int64_t libgpio_get_edge_timestamp(libgpio_t* self, int GPI_number);
+
+///  Set the edge(s) (GPIO_EDGE_xxx) on which a GPI value change is signaled
+///  on its value fd (see libgpio_get_edge_events). This opens the pin session.
+///  Return 0 on success, -1 otherwise
+int libgpio_set_edge(libgpio_t* self, int GPI_number, int edge);
+
+///  Get the edge(s) (GPIO_EDGE_xxx) signaled on a GPI value fd, GPIO_EDGE_NONE
+///  if its session is not opened (a reopened session has no edge set)
+int libgpio_get_edge(libgpio_t* self, int GPI_number);
+
+///  Get the value fd of a GPI or GPO, polled for edges (see libgpio_get_edge_events),
+///  or -1 if none (session not opened, or no edge armed with the sim and cdev backends)
+int libgpio_get_value_fd(libgpio_t* self, int GPx_number, int direction = GPIO_DIRECTION_IN);
+
 ///  Get the textual name for a status
 std::string libgpio_get_status_string(int value);
 
+///  Get the textual name for a status, as a static string
+const char* libgpio_get_status_name(int value);
+
 ///  Get the numeric value for a status name
 int libgpio_get_status_value(const char* status_name);
 
@@ -105,6 +256,40 @@ void libgpio_add_gpo_mapping(libgpio_t* self, int port_num, int pin_num);
 ///  Set the test mode
 void libgpio_set_test_mode(libgpio_t* self, bool test_mode);
 
+///  Set the pin session mode: when true (default), pins are exported once and
+///  their value fd kept opened; otherwise, pins are unexported after each access
+void libgpio_set_persistent(libgpio_t* self, bool persistent);
+
+///  Close all opened pin sessions (close value fd and unexport pins)
+void libgpio_close_sessions(libgpio_t* self);
+
+///  Set the batched I/O mode of the sysfs backend: when true, the values of a
+///  snapshot (or of several GPOs) are read (or written) through io_uring with
+///  one system call per batch, if available
+void libgpio_set_batched_io(libgpio_t* self, bool batched_io);
+
+///  Set the circuit breaker parameters: number of consecutive failures before
+///  quarantining a pin, and bounds of the exponential retry backoff (ms)
+void libgpio_set_breaker(libgpio_t* self, int threshold, int backoff_min, int backoff_max);
+
+///  Get the circuit breaker state of a GPI or GPO (GPIO_BREAKER_xxx), or -1
+///  if it is out of range. If retry_in is set, it receives the time (ms)
+///  before the next access attempt of a quarantined pin
+int libgpio_get_breaker_state(libgpio_t* self, int GPx_number, int direction, int64_t* retry_in = NULL);
+
+///  Get the number of quarantined GPIs and GPOs
+int libgpio_get_quarantined_count(libgpio_t* self);
+
+///  Get the number of writes to the pins 'direction' attribute
+uint64_t libgpio_get_direction_writes(libgpio_t* self);
+
+///  Get the number of writes to the pins 'direction' attribute that were
+///  avoided, since the pin was already configured with the requested direction
+uint64_t libgpio_get_direction_writes_avoided(libgpio_t* self);
+
+///  Get the number of batched I/O submissions (see libgpio_set_batched_io)
+uint64_t libgpio_get_io_batches(libgpio_t* self);
+
 ///  Set the verbosity
 void libgpio_set_verbose(libgpio_t* self, bool verbose);
 
@@ -0,0 +1,549 @@
+/*  =========================================================================
+    libgpio_cdev - Linux GPIO character device backend
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    libgpio_cdev - Linux GPIO character device backend
+@discuss
+    Accesses the lines of a GPIO chip (/dev/gpiochipN) through the uAPI v2
+    ioctls. A GPx line offset on the chip is its HW pin number minus the
+    chipset base address, so the sysfs pin map applies unchanged.
+    All the exported lines without edges share a single line request, so
+    that a whole snapshot is read (or a set of GPOs written) with a single
+    ioctl. This request is rebuilt when lines join or leave it, the outputs
+    being re-driven with their last written values, and reconfigured in
+    place when a direction changes. It holds at most GPIO_V2_LINES_MAX lines.
+    A GPI armed for edges gets its own line request, whose fd is its value
+    fd (POLLIN), and whose events carry the kernel (realtime) timestamp of
+    the edge.
+    The ioctls can be replaced (libgpio_cdev_set_ioctl), to test without a
+    GPIO chip.
+@end
+*/
+
+#include "libgpio_cdev.h"
+#include <fcntl.h>
+#include <fty_log.h>
+#include <linux/gpio.h>
+#include <sys/ioctl.h>
+
+#define GPIO_CDEV_CHIP     "/dev/gpiochip0"
+#define GPIO_CDEV_CONSUMER "fty-sensor-gpio"
+
+///  Line of the GPIO chip
+struct libgpio_cdev_line_t
+{
+    bool exported;  // true if the line is in use
+    int  direction; // configured direction, -1 if not yet
+    int  value;     // last value written, for outputs
+    int  index;     // index in the bulk line request, -1 if none
+    int  edge_fd;   // line request signaling edges, -1 if not armed
+};
+
+///  Character device state, stored as libgpio backend data
+struct libgpio_cdev_t
+{
+    char*                 chip_path;                  // GPIO chip device path
+    int                   chip_fd;                    // GPIO chip fd, -1 if not opened yet
+    libgpio_cdev_ioctl_fn ioctl_fn;                   // ioctl() replacement, NULL if none
+    uint64_t              ioctls;                     // number of ioctls issued
+    libgpio_cdev_line_t*  lines;                      // lines, indexed by offset
+    int                   line_count;                 // number of allocated lines
+    int                   request_fd;                 // bulk line request, -1 if none
+    uint32_t              offsets[GPIO_V2_LINES_MAX]; // offsets of the bulk request lines
+    int                   request_count;              // number of lines in the bulk request
+    bool                  dirty;                      // true if the bulk request must be rebuilt
+};
+
+//  --------------------------------------------------------------------------
+//  Get the character device state, created on first use, or NULL if libgpio
+//  does not use the character device backend
+
+static libgpio_cdev_t* s_cdev(libgpio_t* self)
+{
+    if (self->backend != &libgpio_cdev_backend)
+        return NULL;
+    if (!self->backend_data) {
+        libgpio_cdev_t* cdev = static_cast<libgpio_cdev_t*>(zmalloc(sizeof(libgpio_cdev_t)));
+        assert(cdev);
+        cdev->chip_path    = strdup(GPIO_CDEV_CHIP);
+        cdev->chip_fd      = -1;
+        cdev->request_fd   = -1;
+        self->backend_data = cdev;
+    }
+    return static_cast<libgpio_cdev_t*>(self->backend_data);
+}
+
+//  --------------------------------------------------------------------------
+//  Get the chip line of a pin, allocated on first use, or NULL if invalid
+
+static libgpio_cdev_line_t* s_cdev_line(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_cdev_t* cdev   = s_cdev(self);
+    int             offset = gpx_pin->pin - self->gpio_base_address;
+    if (!cdev || (gpx_pin->pin < 0) || (offset < 0)) {
+        log_error("pin %d is not a line of the GPIO chip", gpx_pin->pin);
+        return NULL;
+    }
+    if (offset >= cdev->line_count) {
+        int line_count = (cdev->line_count == 0) ? 64 : cdev->line_count;
+        while (line_count <= offset)
+            line_count *= 2;
+        cdev->lines =
+            static_cast<libgpio_cdev_line_t*>(realloc(cdev->lines, size_t(line_count) * sizeof(libgpio_cdev_line_t)));
+        assert(cdev->lines);
+        memset(&cdev->lines[cdev->line_count], 0, size_t(line_count - cdev->line_count) * sizeof(libgpio_cdev_line_t));
+        for (int i = cdev->line_count; i < line_count; i++) {
+            cdev->lines[i].direction = -1;
+            cdev->lines[i].index     = -1;
+            cdev->lines[i].edge_fd   = -1;
+        }
+        cdev->line_count = line_count;
+    }
+    return &cdev->lines[offset];
+}
+
+//  --------------------------------------------------------------------------
+//  Issue an ioctl, through its replacement if any
+
+static int s_cdev_ioctl(libgpio_cdev_t* cdev, int fd, unsigned long request, void* arg)
+{
+    cdev->ioctls++;
+    return (cdev->ioctl_fn) ? cdev->ioctl_fn(fd, request, arg) : ioctl(fd, request, arg);
+}
+
+//  --------------------------------------------------------------------------
+//  Build the configuration of the bulk request lines: inputs by default, and
+//  outputs driven with their last written values
+
+static void s_cdev_config(libgpio_cdev_t* cdev, gpio_v2_line_config* config)
+{
+    uint64_t outputs = 0;
+    uint64_t values  = 0;
+    for (int i = 0; i < cdev->request_count; i++) {
+        libgpio_cdev_line_t* line = &cdev->lines[cdev->offsets[i]];
+        if (line->direction == GPIO_DIRECTION_OUT) {
+            outputs |= 1ULL << i;
+            values |= (line->value == GPIO_STATE_OPENED) ? (1ULL << i) : 0;
+        }
+    }
+
+    memset(config, 0, sizeof(*config));
+    config->flags = GPIO_V2_LINE_FLAG_INPUT;
+    if (outputs) {
+        config->attrs[0].attr.id     = GPIO_V2_LINE_ATTR_ID_FLAGS;
+        config->attrs[0].attr.flags  = GPIO_V2_LINE_FLAG_OUTPUT;
+        config->attrs[0].mask        = outputs;
+        config->attrs[1].attr.id     = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+        config->attrs[1].attr.values = values;
+        config->attrs[1].mask        = outputs;
+        config->num_attrs            = 2;
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Request lines of the GPIO chip. Return the line request fd, -1 on failure
+
+static int s_cdev_request(libgpio_cdev_t* cdev, const uint32_t* offsets, int count, const gpio_v2_line_config* config)
+{
+    if (cdev->chip_fd == -1) {
+        cdev->chip_fd = open(cdev->chip_path, O_RDWR | O_CLOEXEC);
+        if (cdev->chip_fd == -1) {
+            log_error("Failed to open GPIO chip %s (errno %i)", cdev->chip_path, errno);
+            return -1;
+        }
+    }
+
+    gpio_v2_line_request request;
+    memset(&request, 0, sizeof(request));
+    memcpy(request.offsets, offsets, size_t(count) * sizeof(uint32_t));
+    strncpy(request.consumer, GPIO_CDEV_CONSUMER, GPIO_MAX_NAME_SIZE - 1);
+    request.config    = *config;
+    request.num_lines = uint32_t(count);
+    if (s_cdev_ioctl(cdev, cdev->chip_fd, GPIO_V2_GET_LINE_IOCTL, &request) == -1) {
+        log_error("Failed to request %i line(s) of GPIO chip %s (errno %i)", count, cdev->chip_path, errno);
+        return -1;
+    }
+    return request.fd;
+}
+
+//  --------------------------------------------------------------------------
+//  Release the bulk line request, to be rebuilt on next use
+
+static void s_cdev_release(libgpio_cdev_t* cdev)
+{
+    if (cdev->request_fd != -1)
+        close(cdev->request_fd);
+    cdev->request_fd = -1;
+    cdev->dirty      = true;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the bulk line request fd, (re)building it if needed, or -1
+
+static int s_cdev_bulk_request(libgpio_cdev_t* cdev)
+{
+    if (!cdev->dirty)
+        return cdev->request_fd;
+    s_cdev_release(cdev);
+
+    cdev->request_count = 0;
+    for (int offset = 0; offset < cdev->line_count; offset++) {
+        libgpio_cdev_line_t* line = &cdev->lines[offset];
+        line->index               = -1;
+        if (!line->exported || (line->edge_fd != -1))
+            continue;
+        if (cdev->request_count == GPIO_V2_LINES_MAX) {
+            log_error("Too many GPIO lines in use (max %i)", GPIO_V2_LINES_MAX);
+            return -1;
+        }
+        line->index                         = cdev->request_count;
+        cdev->offsets[cdev->request_count++] = uint32_t(offset);
+    }
+    if (cdev->request_count == 0)
+        return -1;
+
+    gpio_v2_line_config config;
+    s_cdev_config(cdev, &config);
+    cdev->request_fd = s_cdev_request(cdev, cdev->offsets, cdev->request_count, &config);
+    if (cdev->request_fd == -1)
+        return -1;
+    cdev->dirty = false;
+    log_debug("%i line(s) of GPIO chip %s requested", cdev->request_count, cdev->chip_path);
+    return cdev->request_fd;
+}
+
+//  --------------------------------------------------------------------------
+//  Disarm the edges of a line, which then rejoins the bulk line request
+
+static void s_cdev_disarm(libgpio_cdev_t* cdev, libgpio_cdev_line_t* line)
+{
+    if (line->edge_fd == -1)
+        return;
+    close(line->edge_fd);
+    line->edge_fd = -1;
+    cdev->dirty   = true;
+}
+
+//  --------------------------------------------------------------------------
+//  Acknowledge the pending edge events of a line, keeping the timestamp of
+//  the last one
+
+static void s_cdev_drain(libgpio_cdev_line_t* line, libgpio_pin_t* gpx_pin)
+{
+    gpio_v2_line_event events[16];
+    ssize_t            size;
+    while ((size = read(line->edge_fd, events, sizeof(events))) >= ssize_t(sizeof(gpio_v2_line_event))) {
+        gpx_pin->edge_timestamp = int64_t(events[size_t(size) / sizeof(gpio_v2_line_event) - 1].timestamp_ns);
+        if (size_t(size) < sizeof(events))
+            break;
+    }
+    if ((size == -1) && (errno != EAGAIN))
+        log_warning("Failed to acknowledge edge events of pin %d (errno %i)", gpx_pin->pin, errno);
+}
+
+//  --------------------------------------------------------------------------
+//  Backend operations
+
+static int s_export(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_cdev_t*      cdev = s_cdev(self);
+    libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pin);
+    if (!line)
+        return -1;
+    if (line->exported)
+        return 0;
+    line->exported  = true;
+    line->direction = -1;
+    line->value     = GPIO_STATE_CLOSED;
+    cdev->dirty     = true;
+    return 0;
+}
+
+static int s_unexport(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_cdev_t*      cdev = s_cdev(self);
+    libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pin);
+    if (!line)
+        return -1;
+    s_cdev_disarm(cdev, line);
+    line->exported  = false;
+    line->direction = -1;
+    cdev->dirty     = true;
+    return 0;
+}
+
+static int s_get_direction(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pin);
+    return (line && line->exported) ? line->direction : -1;
+}
+
+static int s_set_direction(libgpio_t* self, libgpio_pin_t* gpx_pin, int direction)
+{
+    libgpio_cdev_t*      cdev = s_cdev(self);
+    libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pin);
+    if (!line || !line->exported)
+        return -1;
+    // As with sysfs, switching to output drives the line low
+    if ((direction == GPIO_DIRECTION_OUT) && (line->direction != GPIO_DIRECTION_OUT)) {
+        s_cdev_disarm(cdev, line);
+        line->value = GPIO_STATE_CLOSED;
+    }
+    line->direction = direction;
+
+    // Reconfigure the bulk line request in place, unless it is rebuilt anyway
+    if (cdev->dirty || (line->index == -1))
+        return 0;
+    gpio_v2_line_config config;
+    s_cdev_config(cdev, &config);
+    if (s_cdev_ioctl(cdev, cdev->request_fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &config) == -1) {
+        log_error("Failed to set direction of pin %d (errno %i)", gpx_pin->pin, errno);
+        s_cdev_release(cdev);
+        return -1;
+    }
+    return 0;
+}
+
+static int s_open_value(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pin);
+    if (!line || !line->exported)
+        return -1;
+    // No fd until edges are armed
+    gpx_pin->value_fd = line->edge_fd;
+    return 0;
+}
+
+static void s_close_value(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pin);
+    if (line)
+        s_cdev_disarm(s_cdev(self), line);
+    gpx_pin->value_fd = -1;
+}
+
+static int s_read_value(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_cdev_t*      cdev = s_cdev(self);
+    libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pin);
+    if (!line || !line->exported)
+        return -1;
+
+    gpio_v2_line_values values = {0, 1};
+    int                 fd     = line->edge_fd;
+    if (fd != -1)
+        s_cdev_drain(line, gpx_pin);
+    else {
+        fd = s_cdev_bulk_request(cdev);
+        if (fd == -1)
+            return -1;
+        values.mask = 1ULL << line->index;
+    }
+    if (s_cdev_ioctl(cdev, fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) == -1) {
+        log_error("Failed to read value of pin %d (errno %i)", gpx_pin->pin, errno);
+        return -1;
+    }
+    return (values.bits & values.mask) ? GPIO_STATE_OPENED : GPIO_STATE_CLOSED;
+}
+
+static int s_write_value(libgpio_t* self, libgpio_pin_t* gpx_pin, int value)
+{
+    libgpio_cdev_t*      cdev = s_cdev(self);
+    libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pin);
+    if (!line || !line->exported)
+        return -1;
+
+    line->value = (value == GPIO_STATE_CLOSED) ? GPIO_STATE_CLOSED : GPIO_STATE_OPENED;
+    int fd      = s_cdev_bulk_request(cdev);
+    if ((fd == -1) || (line->index == -1))
+        return -1;
+    uint64_t            mask   = 1ULL << line->index;
+    gpio_v2_line_values values = {(line->value == GPIO_STATE_OPENED) ? mask : 0, mask};
+    if (s_cdev_ioctl(cdev, fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) == -1) {
+        log_error("Failed to write value of pin %d (errno %i)", gpx_pin->pin, errno);
+        return -1;
+    }
+    return 0;
+}
+
+static int s_set_edge(libgpio_t* self, libgpio_pin_t* gpx_pin, int edge)
+{
+    libgpio_cdev_t*      cdev = s_cdev(self);
+    libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pin);
+    if (!line || !line->exported)
+        return -1;
+    if (edge == GPIO_EDGE_NONE) {
+        s_close_value(self, gpx_pin);
+        return 0;
+    }
+
+    if (line->edge_fd == -1) {
+        // The line must leave the bulk request before being requested alone
+        if (line->index != -1)
+            s_cdev_release(cdev);
+        gpio_v2_line_config config;
+        memset(&config, 0, sizeof(config));
+        config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING |
+                       GPIO_V2_LINE_FLAG_EVENT_CLOCK_REALTIME;
+        uint32_t offset = uint32_t(gpx_pin->pin - self->gpio_base_address);
+        int      fd     = s_cdev_request(cdev, &offset, 1, &config);
+        if (fd == -1)
+            return -1;
+        // Edge events are drained without blocking
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        line->edge_fd = fd;
+        line->index   = -1;
+        // Get the other lines back at once
+        s_cdev_bulk_request(cdev);
+    }
+    gpx_pin->value_fd = line->edge_fd;
+    return 0;
+}
+
+static int s_read_values(libgpio_t* self, libgpio_pin_t** gpx_pins, int count, int* gpx_values)
+{
+    libgpio_cdev_t* cdev = s_cdev(self);
+    int             fd   = s_cdev_bulk_request(cdev);
+
+    // Read the lines of the bulk request at once, and the ones armed for
+    // edges one by one
+    gpio_v2_line_values values = {0, 0};
+    for (int i = 0; i < count; i++) {
+        libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pins[i]);
+        gpx_values[i]             = -1;
+        if (!line || !line->exported)
+            continue;
+        if (line->edge_fd != -1)
+            gpx_values[i] = s_read_value(self, gpx_pins[i]);
+        else if (line->index != -1)
+            values.mask |= 1ULL << line->index;
+    }
+    if (values.mask == 0)
+        return 0;
+    if ((fd == -1) || (s_cdev_ioctl(cdev, fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) == -1)) {
+        log_error("Failed to read values of %i line(s) (errno %i)", count, errno);
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pins[i]);
+        if (line && line->exported && (line->edge_fd == -1) && (line->index != -1))
+            gpx_values[i] = (values.bits & (1ULL << line->index)) ? GPIO_STATE_OPENED : GPIO_STATE_CLOSED;
+    }
+    return 0;
+}
+
+static int s_write_values(libgpio_t* self, libgpio_pin_t** gpx_pins, int count, const int* gpx_values)
+{
+    libgpio_cdev_t* cdev = s_cdev(self);
+
+    gpio_v2_line_values values = {0, 0};
+    for (int i = 0; i < count; i++) {
+        libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pins[i]);
+        if (!line || !line->exported)
+            return -1;
+        line->value = (gpx_values[i] == GPIO_STATE_CLOSED) ? GPIO_STATE_CLOSED : GPIO_STATE_OPENED;
+    }
+    int fd = s_cdev_bulk_request(cdev);
+    if (fd == -1)
+        return -1;
+    for (int i = 0; i < count; i++) {
+        libgpio_cdev_line_t* line = s_cdev_line(self, gpx_pins[i]);
+        if (line->index == -1)
+            return -1;
+        values.mask |= 1ULL << line->index;
+        values.bits |= (line->value == GPIO_STATE_OPENED) ? (1ULL << line->index) : 0;
+    }
+    if (s_cdev_ioctl(cdev, fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) == -1) {
+        log_error("Failed to write values of %i line(s) (errno %i)", count, errno);
+        return -1;
+    }
+    return 0;
+}
+
+static void s_destroy(libgpio_t* self)
+{
+    libgpio_cdev_t* cdev = static_cast<libgpio_cdev_t*>(self->backend_data);
+    if (!cdev)
+        return;
+    for (int i = 0; i < cdev->line_count; i++)
+        s_cdev_disarm(cdev, &cdev->lines[i]);
+    s_cdev_release(cdev);
+    if (cdev->chip_fd != -1)
+        close(cdev->chip_fd);
+    free(cdev->lines);
+    free(cdev->chip_path);
+    free(cdev);
+    self->backend_data = NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Backend definition
+
+const libgpio_backend_t libgpio_cdev_backend = {"cdev", s_export, s_unexport, s_get_direction, s_set_direction,
+    s_open_value, s_close_value, s_read_value, s_write_value, s_set_edge, ZMQ_POLLIN, s_destroy, s_read_values,
+    s_write_values};
+
+//  --------------------------------------------------------------------------
+//  Set the GPIO chip device path
+
+int libgpio_cdev_set_chip(libgpio_t* self, const char* chip_path)
+{
+    libgpio_cdev_t* cdev = s_cdev(self);
+    if (!cdev || !chip_path) {
+        log_error("libgpio is not using the character device backend!");
+        return -1;
+    }
+    if (streq(cdev->chip_path, chip_path))
+        return 0;
+    libgpio_close_sessions(self);
+    s_cdev_release(cdev);
+    if (cdev->chip_fd != -1)
+        close(cdev->chip_fd);
+    cdev->chip_fd = -1;
+    free(cdev->chip_path);
+    cdev->chip_path = strdup(chip_path);
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Set the ioctl() replacement
+
+int libgpio_cdev_set_ioctl(libgpio_t* self, libgpio_cdev_ioctl_fn ioctl_fn)
+{
+    libgpio_cdev_t* cdev = s_cdev(self);
+    if (!cdev) {
+        log_error("libgpio is not using the character device backend!");
+        return -1;
+    }
+    cdev->ioctl_fn = ioctl_fn;
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of ioctls issued
+
+uint64_t libgpio_cdev_get_ioctls(libgpio_t* self)
+{
+    libgpio_cdev_t* cdev = s_cdev(self);
+    return (cdev) ? cdev->ioctls : 0;
+}
@@ -0,0 +1,39 @@
+/*  =========================================================================
+    libgpio_cdev - Linux GPIO character device backend
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+#include "libgpio.h"
+
+///  Note: these functions only apply when libgpio uses libgpio_cdev_backend,
+///  and otherwise fail (-1)
+
+///  ioctl() replacement, to run the backend without a GPIO chip (tests)
+typedef int (*libgpio_cdev_ioctl_fn)(int fd, unsigned long request, void* arg);
+
+///  Set the GPIO chip device path (default: /dev/gpiochip0), releasing the
+///  lines requested on the previous one
+int libgpio_cdev_set_chip(libgpio_t* self, const char* chip_path);
+
+///  Set the ioctl() replacement, or NULL to use the real one
+int libgpio_cdev_set_ioctl(libgpio_t* self, libgpio_cdev_ioctl_fn ioctl_fn);
+
+///  Get the number of ioctls issued
+uint64_t libgpio_cdev_get_ioctls(libgpio_t* self);
@@ -0,0 +1,418 @@
+/*  =========================================================================
+    libgpio_sim - In-memory simulated GPIO backend
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    libgpio_sim - In-memory simulated GPIO backend
+@discuss
+    Simulates any number of pins, indexed by HW pin number, without touching
+    the filesystem: export state, direction and value are kept in memory.
+    A pin value is either constant (set by libgpio_sim_set_value or written
+    as a GPO), or follows a looped waveform. Edges are signaled on an eventfd
+    (POLLIN) per armed pin, when the value is set or written, and when
+    waveforms are evaluated by libgpio_sim_step.
+    A latency can be injected in every access, to load test consumers.
+@end
+*/
+
+#include "libgpio_sim.h"
+#include <fty_log.h>
+#include <sys/eventfd.h>
+
+///  Waveform step: value held for a duration
+struct libgpio_sim_step_t
+{
+    int value;    // GPIO_STATE_CLOSED | GPIO_STATE_OPENED
+    int duration; // ms
+};
+
+///  Simulated pin
+struct libgpio_sim_pin_t
+{
+    bool                exported;   // true if the pin is exported
+    int                 direction;  // configured direction
+    int                 value;      // constant value, when no waveform
+    libgpio_sim_step_t* steps;      // looped waveform, NULL if none
+    int                 step_count; // number of waveform steps
+    int                 period;     // waveform period (ms)
+    int64_t             origin;     // waveform start (monotonic ms)
+    int                 edge_fd;    // eventfd signaling edges, -1 if not armed
+    int                 last_value; // value when last read or signaled
+};
+
+///  Simulation state, stored as libgpio backend data
+struct libgpio_sim_t
+{
+    libgpio_sim_pin_t* pins;      // simulated pins, indexed by HW pin number
+    int                pin_count; // number of allocated pins
+    int                latency;   // latency injected in each access (us)
+    uint64_t           accesses;  // number of pin accesses
+};
+
+//  --------------------------------------------------------------------------
+//  Get the simulation state, created on first use, or NULL if libgpio does
+//  not use the simulated backend
+
+static libgpio_sim_t* s_sim(libgpio_t* self)
+{
+    if (self->backend != &libgpio_sim_backend)
+        return NULL;
+    if (!self->backend_data) {
+        self->backend_data = zmalloc(sizeof(libgpio_sim_t));
+        assert(self->backend_data);
+    }
+    return static_cast<libgpio_sim_t*>(self->backend_data);
+}
+
+//  --------------------------------------------------------------------------
+//  Get a simulated pin, allocated on first use, or NULL if invalid
+
+static libgpio_sim_pin_t* s_sim_pin(libgpio_sim_t* sim, int pin)
+{
+    if (pin < 0)
+        return NULL;
+    if (pin >= sim->pin_count) {
+        int pin_count = (sim->pin_count == 0) ? 64 : sim->pin_count;
+        while (pin_count <= pin)
+            pin_count *= 2;
+        sim->pins = static_cast<libgpio_sim_pin_t*>(realloc(sim->pins, size_t(pin_count) * sizeof(libgpio_sim_pin_t)));
+        assert(sim->pins);
+        memset(&sim->pins[sim->pin_count], 0, size_t(pin_count - sim->pin_count) * sizeof(libgpio_sim_pin_t));
+        for (int i = sim->pin_count; i < pin_count; i++)
+            sim->pins[i].edge_fd = -1;
+        sim->pin_count = pin_count;
+    }
+    return &sim->pins[pin];
+}
+
+//  --------------------------------------------------------------------------
+//  Account an access, with its injected latency
+
+static void s_sim_access(libgpio_sim_t* sim)
+{
+    sim->accesses++;
+    if (sim->latency > 0)
+        usleep(useconds_t(sim->latency));
+}
+
+//  --------------------------------------------------------------------------
+//  Get the current value of a simulated pin
+
+static int s_sim_value(libgpio_sim_pin_t* sim_pin, int64_t now)
+{
+    if (!sim_pin->steps)
+        return sim_pin->value;
+
+    int64_t offset = (now - sim_pin->origin) % sim_pin->period;
+    for (int i = 0; i < sim_pin->step_count; i++) {
+        if (offset < sim_pin->steps[i].duration)
+            return sim_pin->steps[i].value;
+        offset -= sim_pin->steps[i].duration;
+    }
+    return sim_pin->steps[sim_pin->step_count - 1].value;
+}
+
+//  --------------------------------------------------------------------------
+//  Signal an edge on a simulated pin, if armed
+
+static void s_sim_signal(libgpio_sim_pin_t* sim_pin, int value)
+{
+    sim_pin->last_value = value;
+    if (sim_pin->edge_fd == -1)
+        return;
+    uint64_t event = 1;
+    if (write(sim_pin->edge_fd, &event, sizeof(event)) != sizeof(event))
+        log_warning("Failed to signal simulated edge");
+}
+
+//  --------------------------------------------------------------------------
+//  Set a constant value on a simulated pin, signaling an edge if it changed
+
+static void s_sim_set_value(libgpio_sim_pin_t* sim_pin, int value)
+{
+    int previous = s_sim_value(sim_pin, zclock_mono());
+
+    free(sim_pin->steps);
+    sim_pin->steps      = NULL;
+    sim_pin->step_count = 0;
+    sim_pin->value      = value;
+    if (previous != value)
+        s_sim_signal(sim_pin, value);
+}
+
+//  --------------------------------------------------------------------------
+//  Backend operations
+
+static int s_export(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_sim_t*     sim     = s_sim(self);
+    libgpio_sim_pin_t* sim_pin = s_sim_pin(sim, gpx_pin->pin);
+    if (!sim_pin)
+        return -1;
+    s_sim_access(sim);
+    sim_pin->exported = true;
+    return 0;
+}
+
+static int s_unexport(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_sim_t*     sim     = s_sim(self);
+    libgpio_sim_pin_t* sim_pin = s_sim_pin(sim, gpx_pin->pin);
+    if (!sim_pin)
+        return -1;
+    s_sim_access(sim);
+    sim_pin->exported = false;
+    return 0;
+}
+
+static int s_get_direction(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_sim_t*     sim     = s_sim(self);
+    libgpio_sim_pin_t* sim_pin = s_sim_pin(sim, gpx_pin->pin);
+    if (!sim_pin || !sim_pin->exported)
+        return -1;
+    s_sim_access(sim);
+    return sim_pin->direction;
+}
+
+static int s_set_direction(libgpio_t* self, libgpio_pin_t* gpx_pin, int direction)
+{
+    libgpio_sim_t*     sim     = s_sim(self);
+    libgpio_sim_pin_t* sim_pin = s_sim_pin(sim, gpx_pin->pin);
+    if (!sim_pin || !sim_pin->exported)
+        return -1;
+    s_sim_access(sim);
+    // As with the kernel, switching to output drives the line low
+    if ((direction == GPIO_DIRECTION_OUT) && (sim_pin->direction != GPIO_DIRECTION_OUT))
+        s_sim_set_value(sim_pin, GPIO_STATE_CLOSED);
+    sim_pin->direction = direction;
+    return 0;
+}
+
+static int s_open_value(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_sim_t*     sim     = s_sim(self);
+    libgpio_sim_pin_t* sim_pin = s_sim_pin(sim, gpx_pin->pin);
+    if (!sim_pin || !sim_pin->exported)
+        return -1;
+    // No fd until edges are armed
+    gpx_pin->value_fd = -1;
+    return 0;
+}
+
+static void s_close_value(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_sim_pin_t* sim_pin = s_sim_pin(s_sim(self), gpx_pin->pin);
+    if (sim_pin && (gpx_pin->value_fd != -1) && (sim_pin->edge_fd == gpx_pin->value_fd)) {
+        close(sim_pin->edge_fd);
+        sim_pin->edge_fd = -1;
+    }
+    gpx_pin->value_fd = -1;
+}
+
+static int s_read_value(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    libgpio_sim_t*     sim     = s_sim(self);
+    libgpio_sim_pin_t* sim_pin = s_sim_pin(sim, gpx_pin->pin);
+    if (!sim_pin || !sim_pin->exported)
+        return -1;
+    s_sim_access(sim);
+    // Acknowledge the pending edges
+    if (sim_pin->edge_fd != -1) {
+        uint64_t events;
+        if (read(sim_pin->edge_fd, &events, sizeof(events)) == -1 && errno != EAGAIN)
+            log_warning("Failed to acknowledge simulated edges");
+    }
+    sim_pin->last_value = s_sim_value(sim_pin, zclock_mono());
+    return sim_pin->last_value;
+}
+
+static int s_write_value(libgpio_t* self, libgpio_pin_t* gpx_pin, int value)
+{
+    libgpio_sim_t*     sim     = s_sim(self);
+    libgpio_sim_pin_t* sim_pin = s_sim_pin(sim, gpx_pin->pin);
+    if (!sim_pin || !sim_pin->exported)
+        return -1;
+    s_sim_access(sim);
+    s_sim_set_value(sim_pin, (value == GPIO_STATE_CLOSED) ? GPIO_STATE_CLOSED : GPIO_STATE_OPENED);
+    return 0;
+}
+
+static int s_set_edge(libgpio_t* self, libgpio_pin_t* gpx_pin, int edge)
+{
+    libgpio_sim_t*     sim     = s_sim(self);
+    libgpio_sim_pin_t* sim_pin = s_sim_pin(sim, gpx_pin->pin);
+    if (!sim_pin || !sim_pin->exported)
+        return -1;
+    s_sim_access(sim);
+    if (edge == GPIO_EDGE_NONE) {
+        s_close_value(self, gpx_pin);
+        return 0;
+    }
+    if (sim_pin->edge_fd == -1) {
+        sim_pin->edge_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (sim_pin->edge_fd == -1) {
+            log_error("Failed to create simulated edge fd for pin %d (errno %i)", gpx_pin->pin, errno);
+            return -1;
+        }
+    }
+    gpx_pin->value_fd = sim_pin->edge_fd;
+    // Only the next changes are signaled
+    sim_pin->last_value = s_sim_value(sim_pin, zclock_mono());
+    return 0;
+}
+
+static void s_destroy(libgpio_t* self)
+{
+    libgpio_sim_t* sim = static_cast<libgpio_sim_t*>(self->backend_data);
+    if (!sim)
+        return;
+    for (int i = 0; i < sim->pin_count; i++) {
+        free(sim->pins[i].steps);
+        if (sim->pins[i].edge_fd != -1)
+            close(sim->pins[i].edge_fd);
+    }
+    free(sim->pins);
+    free(sim);
+    self->backend_data = NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Backend definition
+
+const libgpio_backend_t libgpio_sim_backend = {"sim", s_export, s_unexport, s_get_direction, s_set_direction,
+    s_open_value, s_close_value, s_read_value, s_write_value, s_set_edge, ZMQ_POLLIN, s_destroy, NULL, NULL};
+
+//  --------------------------------------------------------------------------
+//  Get the simulated pin of a GPI or GPO, or NULL
+
+static libgpio_sim_pin_t* s_sim_gpx(libgpio_t* self, int GPx_number, int direction)
+{
+    libgpio_sim_t* sim = s_sim(self);
+    if (!sim) {
+        log_error("libgpio is not using the simulated backend!");
+        return NULL;
+    }
+    return s_sim_pin(sim, libgpio_compute_pin_number(self, GPx_number, direction));
+}
+
+//  --------------------------------------------------------------------------
+//  Set the value of a simulated GPI or GPO
+
+int libgpio_sim_set_value(libgpio_t* self, int GPx_number, int direction, int value)
+{
+    libgpio_sim_pin_t* sim_pin = s_sim_gpx(self, GPx_number, direction);
+    if (!sim_pin)
+        return -1;
+    s_sim_set_value(sim_pin, (value == GPIO_STATE_CLOSED) ? GPIO_STATE_CLOSED : GPIO_STATE_OPENED);
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Set the waveform of a simulated GPI or GPO
+
+int libgpio_sim_set_waveform(libgpio_t* self, int GPx_number, int direction, const char* waveform)
+{
+    libgpio_sim_pin_t* sim_pin = s_sim_gpx(self, GPx_number, direction);
+    if (!sim_pin || !waveform)
+        return -1;
+
+    int step_count = 1;
+    for (const char* c = waveform; *c; c++)
+        step_count += (*c == ',') ? 1 : 0;
+
+    libgpio_sim_step_t* steps =
+        static_cast<libgpio_sim_step_t*>(zmalloc(size_t(step_count) * sizeof(libgpio_sim_step_t)));
+    assert(steps);
+    int         period = 0;
+    const char* c      = waveform;
+    for (int i = 0; i < step_count; i++) {
+        char* end;
+        steps[i].value = int(strtol(c, &end, 10));
+        if ((end == c) || (*end != ':') ||
+            ((steps[i].value != GPIO_STATE_CLOSED) && (steps[i].value != GPIO_STATE_OPENED))) {
+            log_error("Invalid simulated waveform '%s'", waveform);
+            free(steps);
+            return -1;
+        }
+        c                 = end + 1;
+        steps[i].duration = int(strtol(c, &end, 10));
+        if ((end == c) || (steps[i].duration <= 0) || ((*end != ',') && (*end != '\0'))) {
+            log_error("Invalid simulated waveform '%s'", waveform);
+            free(steps);
+            return -1;
+        }
+        period += steps[i].duration;
+        c = end + 1;
+    }
+
+    free(sim_pin->steps);
+    sim_pin->steps      = steps;
+    sim_pin->step_count = step_count;
+    sim_pin->period     = period;
+    sim_pin->origin     = zclock_mono();
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Set the latency injected in every simulated pin access
+
+int libgpio_sim_set_latency(libgpio_t* self, int latency)
+{
+    libgpio_sim_t* sim = s_sim(self);
+    if (!sim)
+        return -1;
+    sim->latency = latency;
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Evaluate the waveforms of the pins armed for edges
+
+int libgpio_sim_step(libgpio_t* self)
+{
+    libgpio_sim_t* sim = s_sim(self);
+    if (!sim)
+        return -1;
+
+    int     edges = 0;
+    int64_t now   = zclock_mono();
+    for (int i = 0; i < sim->pin_count; i++) {
+        libgpio_sim_pin_t* sim_pin = &sim->pins[i];
+        if ((sim_pin->edge_fd == -1) || !sim_pin->steps)
+            continue;
+        int value = s_sim_value(sim_pin, now);
+        if (value != sim_pin->last_value) {
+            s_sim_signal(sim_pin, value);
+            edges++;
+        }
+    }
+    return edges;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the number of simulated pin accesses
+
+uint64_t libgpio_sim_get_accesses(libgpio_t* self)
+{
+    libgpio_sim_t* sim = s_sim(self);
+    return (sim) ? sim->accesses : 0;
+}
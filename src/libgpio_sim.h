@@ -0,0 +1,44 @@
+/*  =========================================================================
+    libgpio_sim - In-memory simulated GPIO backend
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+#include "libgpio.h"
+
+///  Note: these functions only apply when libgpio uses libgpio_sim_backend,
+///  and otherwise fail (-1)
+
+///  Set the value of a simulated GPI or GPO, dropping its waveform, and
+///  signal an edge if it changed
+int libgpio_sim_set_value(libgpio_t* self, int GPx_number, int direction, int value);
+
+///  Set the waveform of a simulated GPI or GPO, looped from now on, as a
+///  comma separated list of <value>:<duration in ms> steps (i.e. "1:500,0:1500")
+int libgpio_sim_set_waveform(libgpio_t* self, int GPx_number, int direction, const char* waveform);
+
+///  Set the latency (us) injected in every simulated pin access
+int libgpio_sim_set_latency(libgpio_t* self, int latency);
+
+///  Evaluate the waveforms of the pins armed for edges, and signal the ones
+///  which changed since their last read. Return the number of edges signaled
+int libgpio_sim_step(libgpio_t* self);
+
+///  Get the number of simulated pin accesses
+uint64_t libgpio_sim_get_accesses(libgpio_t* self);
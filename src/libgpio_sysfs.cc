@@ -0,0 +1,453 @@
+/*  =========================================================================
+    libgpio_sysfs - Linux sysfs GPIO backend
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    libgpio_sysfs - Linux sysfs GPIO backend
+@discuss
+    Pins are accessed through /sys/class/gpio: export/unexport, then the
+    'direction', 'value' and 'edge' attributes of gpioN.
+    In test mode, the tree is created on the fly under SELFTEST_DIR_RW.
+    With batched I/O, the values of a whole snapshot (or a set of GPOs) are
+    read (or written) through io_uring, with a single system call per
+    GPIO_URING_ENTRIES pins, falling back to per pin I/O if unavailable.
+@end
+*/
+
+#include "libgpio.h"
+#include "libgpio_uring.h"
+#include <fty_log.h>
+#include <inttypes.h>
+#include <libgen.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+static int s_unexport(libgpio_t* self, libgpio_pin_t* gpx_pin);
+static int mkpath(char* file_path, mode_t mode);
+
+//  --------------------------------------------------------------------------
+//  Wait for the 'direction' attribute of a freshly exported pin to exist and
+//  be writable, i.e. for udev to have applied its rules. Changes are watched
+//  with inotify, with a periodic check as a safety net.
+//  Return 0 when ready, -1 on timeout (in ms)
+
+static int s_wait_ready(libgpio_t* self, libgpio_pin_t* gpx_pin, int timeout)
+{
+    // Test mode creates the attributes on the fly
+    if (self->test_mode || (access(gpx_pin->direction_path, W_OK) == 0))
+        return 0;
+
+    int64_t deadline = zclock_mono() + timeout;
+    int     fd       = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int     wd_class = -1;
+    int     wd_pin   = -1;
+    int     retval   = -1;
+    char    pin_path[GPIO_DIRECTION_MAX];
+    char    class_path[GPIO_DIRECTION_MAX];
+
+    // <class>/gpioN/direction
+    snprintf(pin_path, GPIO_DIRECTION_MAX, "%s", gpx_pin->direction_path);
+    dirname(pin_path);
+    snprintf(class_path, GPIO_DIRECTION_MAX, "%s", pin_path);
+    dirname(class_path);
+
+    if (fd == -1)
+        log_warning("Failed to initialize inotify (errno %i), falling back to polling", errno);
+
+    while (true) {
+        if (fd != -1) {
+            // Watch the pin directory creation, then its attributes privileges
+            if (wd_class == -1)
+                wd_class = inotify_add_watch(fd, class_path, IN_CREATE);
+            if (wd_pin == -1)
+                wd_pin = inotify_add_watch(fd, pin_path, IN_CREATE | IN_ATTRIB);
+        }
+        if (access(gpx_pin->direction_path, W_OK) == 0) {
+            retval = 0;
+            break;
+        }
+
+        int64_t remaining = deadline - zclock_mono();
+        if (remaining <= 0)
+            break;
+
+        struct pollfd item = {fd, POLLIN, 0};
+        int           wait = int((remaining < GPIO_READY_POLL) ? remaining : GPIO_READY_POLL);
+        if (fd == -1)
+            zclock_sleep(wait);
+        else if (poll(&item, 1, wait) > 0) {
+            // Drain the events, we only care about the attribute state
+            char events[sizeof(struct inotify_event) + NAME_MAX + 1];
+            while (read(fd, events, sizeof(events)) > 0)
+                ;
+        }
+    }
+
+    if (fd != -1)
+        close(fd);
+    log_debug("pin %d %s after %" PRIi64 " ms", gpx_pin->pin, (retval == 0) ? "ready" : "not ready",
+        zclock_mono() - deadline + timeout);
+    return retval;
+}
+
+//  --------------------------------------------------------------------------
+//  Export a pin, and wait for it to be ready
+
+static int s_export(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    char    buffer[GPIO_BUFFER_MAX];
+    ssize_t bytes_written;
+    int     fd;
+    int     retval = 0;
+
+    // trick #2 to allow testing
+    if (self->test_mode)
+        mkpath(self->export_path, 0777);
+    fd = open(self->export_path, O_WRONLY | ((self->test_mode) ? O_CREAT : 0), 0777);
+    if (fd == -1) {
+        log_error("Failed to open %s for writing! %i", self->export_path, errno);
+        return -1;
+    }
+    log_debug("exporting pin %d", gpx_pin->pin);
+
+    bytes_written = snprintf(buffer, GPIO_BUFFER_MAX, "%d", gpx_pin->pin);
+    if (write(fd, buffer, size_t(bytes_written)) < bytes_written) {
+        // EBUSY means that the pin is already exported, which is fine
+        if (errno == EBUSY)
+            log_debug("pin %d already exported", gpx_pin->pin);
+        else {
+            log_error("wrote less than %i bytes (errno %i)", bytes_written, errno);
+            retval = -1;
+        }
+    }
+
+    close(fd);
+    if (retval == -1)
+        return -1;
+
+    // Wait for the sysfs to be created and udev rules to be applied, so that
+    // we get the right privileges applied
+    if (s_wait_ready(self, gpx_pin, GPIO_READY_TIMEOUT) == -1) {
+        log_error("Pin %d not ready after %i ms. Aborting!", gpx_pin->pin, GPIO_READY_TIMEOUT);
+        s_unexport(self, gpx_pin);
+        return -1;
+    }
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Unexport a pin
+
+static int s_unexport(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    char    buffer[GPIO_BUFFER_MAX];
+    ssize_t bytes_written;
+    int     fd;
+    int     retval = 0;
+
+    // trick #2 to allow testing
+    if (self->test_mode)
+        mkpath(self->unexport_path, 0777);
+    fd = open(self->unexport_path, O_WRONLY | ((self->test_mode) ? O_CREAT : 0), 0777);
+    if (fd == -1) {
+        log_error("Failed to open unexport for writing!");
+        return -1;
+    }
+
+    bytes_written = snprintf(buffer, GPIO_BUFFER_MAX, "%d", gpx_pin->pin);
+    if (write(fd, buffer, size_t(bytes_written)) < bytes_written) {
+        log_error("wrote less than %i bytes", bytes_written);
+        retval = -1;
+    }
+
+    close(fd);
+    return retval;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the current GPIO direction, as configured in the kernel, or -1 if
+//  it can't be read
+
+static int s_get_direction(libgpio_t* /*self*/, libgpio_pin_t* gpx_pin)
+{
+    char direction_str[4];
+
+    memset(&direction_str[0], 0, 4);
+
+    int fd = open(gpx_pin->direction_path, O_RDONLY);
+    if (fd == -1)
+        return -1;
+    ssize_t bytes_read = read(fd, direction_str, 3);
+    close(fd);
+
+    if ((bytes_read >= 2) && (strncmp(direction_str, "in", 2) == 0))
+        return GPIO_DIRECTION_IN;
+    if ((bytes_read == 3) && (strncmp(direction_str, "out", 3) == 0))
+        return GPIO_DIRECTION_OUT;
+    log_trace("unknown direction '%s' for pin %d", direction_str, gpx_pin->pin);
+    return -1;
+}
+
+//  --------------------------------------------------------------------------
+//  Set the current GPIO direction to 'in' (read) or 'out' (write)
+
+static int s_set_direction(libgpio_t* self, libgpio_pin_t* gpx_pin, int direction)
+{
+    static const char s_directions_str[] = "in\0out";
+    int               retval             = 0;
+    int               fd;
+
+    // trick #2 to allow testing
+    if (self->test_mode)
+        mkpath(gpx_pin->direction_path, 0777);
+    fd = open(gpx_pin->direction_path, O_WRONLY | ((self->test_mode) ? O_CREAT : 0), 0777);
+    if (fd == -1) {
+        log_error("Failed to open %s for writing!", gpx_pin->direction_path);
+        return -1;
+    }
+
+    if (write(fd, &s_directions_str[GPIO_DIRECTION_IN == direction ? 0 : 3], GPIO_DIRECTION_IN == direction ? 2 : 3) ==
+        -1) {
+        log_error("Failed to set direction!");
+        retval = -1;
+    }
+
+    close(fd);
+    return retval;
+}
+
+//  --------------------------------------------------------------------------
+//  Open the 'value' attribute of an exported pin
+
+static int s_open_value(libgpio_t* self, libgpio_pin_t* gpx_pin)
+{
+    // trick #2 to allow testing
+    if (self->test_mode)
+        mkpath(gpx_pin->value_path, 0777);
+    int fd = open(gpx_pin->value_path, O_RDWR | ((self->test_mode) ? O_CREAT : 0), 0777);
+    if (fd == -1) {
+        log_error("Failed to open gpio value '%s'!", gpx_pin->value_path);
+        return -1;
+    }
+    gpx_pin->value_fd = fd;
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Close the 'value' attribute of a pin
+
+static void s_close_value(libgpio_t* /*self*/, libgpio_pin_t* gpx_pin)
+{
+    if (gpx_pin->value_fd != -1)
+        close(gpx_pin->value_fd);
+    gpx_pin->value_fd = -1;
+}
+
+//  --------------------------------------------------------------------------
+//  Read the value of a pin
+
+static int s_read_value(libgpio_t* /*self*/, libgpio_pin_t* gpx_pin)
+{
+    char value_str[3];
+
+    memset(&value_str[0], 0, 3);
+
+    if (pread(gpx_pin->value_fd, value_str, 3, 0) <= 0)
+        return -1;
+
+    log_trace("read value '%c'", value_str[0]);
+    return atoi(&value_str[0]);
+}
+
+//  --------------------------------------------------------------------------
+//  Write the value of a pin
+
+static int s_write_value(libgpio_t* /*self*/, libgpio_pin_t* gpx_pin, int value)
+{
+    static const char s_values_str[] = "01";
+
+    if (pwrite(gpx_pin->value_fd, &s_values_str[GPIO_STATE_CLOSED == value ? 0 : 1], 1, 0) != 1)
+        return -1;
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Get the batched I/O ring, created on first use, or NULL if batched I/O is
+//  disabled or not available
+
+static libgpio_uring_t* s_uring(libgpio_t* self)
+{
+    if (!self->batched_io)
+        return NULL;
+    if (!self->backend_data) {
+        self->backend_data = libgpio_uring_new();
+        if (!self->backend_data) {
+            log_warning("Batched I/O is not available, falling back to per pin I/O");
+            self->batched_io = false;
+        }
+    }
+    return static_cast<libgpio_uring_t*>(self->backend_data);
+}
+
+//  --------------------------------------------------------------------------
+//  Submit batched I/O, dropping the ring (and batched I/O) on failure.
+//  Return 0 on success, -1 otherwise
+
+static int s_uring_submit(libgpio_t* self, libgpio_uring_io_t* ios, int count, bool write)
+{
+    libgpio_uring_t* uring   = static_cast<libgpio_uring_t*>(self->backend_data);
+    int              batches = libgpio_uring_submit(uring, ios, count, write);
+    if (batches == -1) {
+        log_warning("Batched I/O failed, falling back to per pin I/O");
+        libgpio_uring_destroy(&uring);
+        self->backend_data = NULL;
+        self->batched_io   = false;
+        return -1;
+    }
+    self->io_batches += uint64_t(batches);
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Read the values of several pins, at once with batched I/O
+
+static int s_read_values(libgpio_t* self, libgpio_pin_t** gpx_pins, int count, int* values)
+{
+    libgpio_uring_io_t* ios     = NULL;
+    char*               buffers = NULL;
+    if (s_uring(self)) {
+        ios     = static_cast<libgpio_uring_io_t*>(zmalloc(size_t(count) * sizeof(libgpio_uring_io_t)));
+        buffers = static_cast<char*>(zmalloc(size_t(count) * 3));
+        assert(ios && buffers);
+        for (int i = 0; i < count; i++)
+            ios[i] = {gpx_pins[i]->value_fd, &buffers[i * 3], 2, 0};
+        if (s_uring_submit(self, ios, count, false) == -1) {
+            free(ios);
+            ios = NULL;
+        }
+    }
+
+    // The pins which failed in the batch are read again on their own
+    for (int i = 0; i < count; i++) {
+        if (!ios || (ios[i].result <= 0))
+            values[i] = s_read_value(self, gpx_pins[i]);
+        else
+            values[i] = atoi(ios[i].buffer);
+    }
+    free(buffers);
+    free(ios);
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Write the values of several pins, at once with batched I/O
+
+static int s_write_values(libgpio_t* self, libgpio_pin_t** gpx_pins, int count, const int* values)
+{
+    static const char   s_values_str[] = "01";
+    libgpio_uring_io_t* ios            = NULL;
+    if (s_uring(self)) {
+        ios = static_cast<libgpio_uring_io_t*>(zmalloc(size_t(count) * sizeof(libgpio_uring_io_t)));
+        assert(ios);
+        for (int i = 0; i < count; i++) {
+            char* value_str = const_cast<char*>(&s_values_str[GPIO_STATE_CLOSED == values[i] ? 0 : 1]);
+            ios[i]          = {gpx_pins[i]->value_fd, value_str, 1, 0};
+        }
+        if (s_uring_submit(self, ios, count, true) == -1) {
+            free(ios);
+            ios = NULL;
+        }
+    }
+
+    // The pins which failed in the batch are written again on their own
+    int retval = 0;
+    for (int i = 0; i < count; i++) {
+        if (!ios || (ios[i].result != 1))
+            retval = (s_write_value(self, gpx_pins[i], values[i]) == -1) ? -1 : retval;
+    }
+    free(ios);
+    return retval;
+}
+
+//  --------------------------------------------------------------------------
+//  Release the batched I/O ring
+
+static void s_destroy(libgpio_t* self)
+{
+    libgpio_uring_t* uring = static_cast<libgpio_uring_t*>(self->backend_data);
+    libgpio_uring_destroy(&uring);
+    self->backend_data = NULL;
+}
+
+//  --------------------------------------------------------------------------
+//  Set the edge(s) on which a value change is signaled (POLLPRI on value fd)
+
+static int s_set_edge(libgpio_t* self, libgpio_pin_t* gpx_pin, int edge)
+{
+    static const char s_edges_str[] = "none\0both";
+    char              value_str[3];
+
+    int fd = open(gpx_pin->edge_path, O_WRONLY | ((self->test_mode) ? O_CREAT : 0), 0777);
+    if (fd == -1) {
+        log_error("Failed to open %s for writing!", gpx_pin->edge_path);
+        return -1;
+    }
+    if (write(fd, &s_edges_str[GPIO_EDGE_NONE == edge ? 0 : 5], 4) != 4) {
+        log_error("Failed to set edge on pin %d!", gpx_pin->pin);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    // Consume the current value, so that only the next changes are signaled
+    if (pread(gpx_pin->value_fd, value_str, 3, 0) < 0)
+        log_warning("Failed to read value of pin %d", gpx_pin->pin);
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Helper function to recursively create directories
+
+// FIXME: replace with zsys_dir_create (const char *pathname, ...);
+static int mkpath(char* file_path, mode_t mode)
+{
+    assert(file_path && *file_path);
+    char* p;
+    for (p = strchr(file_path + 1, '/'); p; p = strchr(p + 1, '/')) {
+        *p = '\0';
+        if (mkdir(file_path, mode) == -1) {
+            if (errno != EEXIST) {
+                *p = '/';
+                return -1;
+            }
+        }
+        *p = '/';
+    }
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Backend definition
+
+const libgpio_backend_t libgpio_sysfs_backend = {"sysfs", s_export, s_unexport, s_get_direction, s_set_direction,
+    s_open_value, s_close_value, s_read_value, s_write_value, s_set_edge, ZMQ_POLLPRI, s_destroy, s_read_values,
+    s_write_values};
@@ -0,0 +1,226 @@
+/*  =========================================================================
+    libgpio_uring - Batched pin I/O through io_uring
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    libgpio_uring - Batched pin I/O through io_uring
+@discuss
+    Minimal io_uring wrapper (without liburing), used to read or write the
+    value fds of a whole poll cycle with a single io_uring_enter() call per
+    GPIO_URING_ENTRIES pins, instead of a pread()/pwrite() call per pin.
+@end
+*/
+
+#include "libgpio_uring.h"
+#include <czmq.h>
+#include <fty_log.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+///  Structure of our class
+struct libgpio_uring_t
+{
+    int           fd;           // io_uring fd
+    void*         sq_ring;      // submission queue ring mapping
+    size_t        sq_ring_size; // submission queue ring mapping size
+    void*         cq_ring;      // completion queue ring mapping (may be sq_ring)
+    size_t        cq_ring_size; // completion queue ring mapping size
+    io_uring_sqe* sqes;         // submission queue entries
+    size_t        sqes_size;    // submission queue entries mapping size
+    unsigned*     sq_tail;      // submission queue tail
+    unsigned*     sq_mask;      // submission queue index mask
+    unsigned*     sq_array;     // submission queue entries indexes
+    unsigned*     cq_head;      // completion queue head
+    unsigned*     cq_tail;      // completion queue tail
+    unsigned*     cq_mask;      // completion queue index mask
+    io_uring_cqe* cqes;         // completion queue entries
+};
+
+//  --------------------------------------------------------------------------
+//  Check that the ring supports the read and write operations: they came
+//  with Linux 5.6 (as the probe itself), and older kernels fail them with
+//  -EINVAL. Return true if supported
+
+static bool s_uring_probe(int fd)
+{
+    size_t          size  = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    io_uring_probe* probe = static_cast<io_uring_probe*>(zmalloc(size));
+    assert(probe);
+    bool supported = (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0) &&
+                     (probe->last_op >= IORING_OP_READ) && (probe->last_op >= IORING_OP_WRITE) &&
+                     (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+                     (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return supported;
+}
+
+//  --------------------------------------------------------------------------
+//  Create a batched I/O ring
+
+libgpio_uring_t* libgpio_uring_new(void)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = int(syscall(__NR_io_uring_setup, GPIO_URING_ENTRIES, &params));
+    if (fd == -1) {
+        log_debug("io_uring is not available (errno %i)", errno);
+        return NULL;
+    }
+    if (!s_uring_probe(fd)) {
+        log_debug("io_uring doesn't support read and write operations");
+        close(fd);
+        return NULL;
+    }
+
+    libgpio_uring_t* self = static_cast<libgpio_uring_t*>(zmalloc(sizeof(libgpio_uring_t)));
+    assert(self);
+    self->fd           = fd;
+    self->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    self->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    self->sqes_size    = params.sq_entries * sizeof(io_uring_sqe);
+    // Both rings may share a single mapping
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (self->cq_ring_size > self->sq_ring_size)
+            self->sq_ring_size = self->cq_ring_size;
+        self->cq_ring_size = self->sq_ring_size;
+    }
+
+    self->sq_ring =
+        mmap(NULL, self->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (self->sq_ring == MAP_FAILED) {
+        self->sq_ring = NULL;
+        libgpio_uring_destroy(&self);
+        return NULL;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        self->cq_ring = self->sq_ring;
+    else {
+        self->cq_ring =
+            mmap(NULL, self->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (self->cq_ring == MAP_FAILED) {
+            self->cq_ring = NULL;
+            libgpio_uring_destroy(&self);
+            return NULL;
+        }
+    }
+    void* sqes = mmap(NULL, self->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        libgpio_uring_destroy(&self);
+        return NULL;
+    }
+    self->sqes = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq_ring  = static_cast<char*>(self->sq_ring);
+    char* cq_ring  = static_cast<char*>(self->cq_ring);
+    self->sq_tail  = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+    self->sq_mask  = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+    self->sq_array = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+    self->cq_head  = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+    self->cq_tail  = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+    self->cq_mask  = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+    self->cqes     = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+    return self;
+}
+
+//  --------------------------------------------------------------------------
+//  Submit a batch of up to GPIO_URING_ENTRIES I/O, and reap their completions.
+//  Return 0 on success, -1 otherwise
+
+static int s_uring_batch(libgpio_uring_t* self, libgpio_uring_io_t* ios, int count, bool write)
+{
+    unsigned tail = *self->sq_tail;
+    for (int i = 0; i < count; i++) {
+        unsigned      index = tail & *self->sq_mask;
+        io_uring_sqe* sqe   = &self->sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode           = (write) ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe->fd               = ios[i].fd;
+        sqe->addr             = reinterpret_cast<uint64_t>(ios[i].buffer);
+        sqe->len              = ios[i].length;
+        sqe->off              = 0;
+        sqe->user_data        = uint64_t(i);
+        self->sq_array[index] = index;
+        tail++;
+    }
+    __atomic_store_n(self->sq_tail, tail, __ATOMIC_RELEASE);
+
+    unsigned to_submit = unsigned(count);
+    int      reaped    = 0;
+    while (reaped < count) {
+        int rc = int(syscall(
+            __NR_io_uring_enter, self->fd, to_submit, unsigned(count - reaped), IORING_ENTER_GETEVENTS, NULL, 0));
+        if (rc == -1) {
+            if (errno == EINTR)
+                continue;
+            log_error("Failed to submit batched I/O (errno %i)", errno);
+            return -1;
+        }
+        to_submit -= (unsigned(rc) < to_submit) ? unsigned(rc) : to_submit;
+
+        unsigned head = *self->cq_head;
+        while (head != __atomic_load_n(self->cq_tail, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe* cqe = &self->cqes[head & *self->cq_mask];
+            if (cqe->user_data < uint64_t(count)) {
+                ios[cqe->user_data].result = cqe->res;
+                reaped++;
+            }
+            head++;
+        }
+        __atomic_store_n(self->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Read (or write) all the I/O at once
+
+int libgpio_uring_submit(libgpio_uring_t* self, libgpio_uring_io_t* ios, int count, bool write)
+{
+    int batches = 0;
+    for (int done = 0; done < count; done += GPIO_URING_ENTRIES) {
+        int batch = (count - done < GPIO_URING_ENTRIES) ? count - done : GPIO_URING_ENTRIES;
+        if (s_uring_batch(self, &ios[done], batch, write) == -1)
+            return -1;
+        batches++;
+    }
+    return batches;
+}
+
+//  --------------------------------------------------------------------------
+//  Destroy the batched I/O ring
+
+void libgpio_uring_destroy(libgpio_uring_t** self_p)
+{
+    assert(self_p);
+    if (*self_p) {
+        libgpio_uring_t* self = *self_p;
+        if (self->sqes)
+            munmap(self->sqes, self->sqes_size);
+        if (self->cq_ring && (self->cq_ring != self->sq_ring))
+            munmap(self->cq_ring, self->cq_ring_size);
+        if (self->sq_ring)
+            munmap(self->sq_ring, self->sq_ring_size);
+        close(self->fd);
+        free(self);
+        *self_p = NULL;
+    }
+}
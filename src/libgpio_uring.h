@@ -0,0 +1,48 @@
+/*  =========================================================================
+    libgpio_uring - Batched pin I/O through io_uring
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+#include <stdint.h>
+
+///  Number of I/O submitted at once (bigger batches are split)
+#define GPIO_URING_ENTRIES 64
+
+///  Batched I/O ring (opaque)
+struct libgpio_uring_t;
+
+///  I/O of a batch, at offset 0 of its fd
+struct libgpio_uring_io_t
+{
+    int      fd;     // fd to read or write
+    char*    buffer; // data read or written
+    unsigned length; // buffer length
+    int      result; // number of bytes read or written, or -errno
+};
+
+///  Create a batched I/O ring, or return NULL if io_uring is not available
+libgpio_uring_t* libgpio_uring_new(void);
+
+///  Read (or write) all the I/O at once, and wait for their completion.
+///  Return the number of batches submitted, -1 on failure
+int libgpio_uring_submit(libgpio_uring_t* self, libgpio_uring_io_t* ios, int count, bool write);
+
+///  Destroy the batched I/O ring
+void libgpio_uring_destroy(libgpio_uring_t** self_p);
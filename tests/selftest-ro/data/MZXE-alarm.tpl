@@ -5,4 +5,6 @@ normal-state   = opened
 gpx-direction  = GPI
 power-source   = internal
 alarm-severity = CRITICAL
+alarm-delay    = 200
+clear-delay    = 10000
 alarm-message  = Fire detected (alarm) in $location, initiating fire suppression activation countdown
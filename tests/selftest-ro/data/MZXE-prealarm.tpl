@@ -5,4 +5,6 @@ normal-state   = opened
 gpx-direction  = GPI
 power-source   = internal
 alarm-severity = WARNING
+alarm-delay    = 500
+clear-delay    = 10000
 alarm-message  = Fire detected (pre-alarm)
@@ -5,4 +5,6 @@ normal-state   = closed
 gpx-direction  = GPI
 power-source   = internal
 alarm-severity = WARNING
+alarm-delay    = 500
+clear-delay    = 5000
 alarm-message  = Vibrations detected
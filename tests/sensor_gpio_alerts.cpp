@@ -0,0 +1,387 @@
+/*  ========================================================================
+    Copyright (C) 2021 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "src/fty_sensor_gpio_alerts.h"
+#include "src/libgpio.h"
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <fty_proto.h>
+#include <string>
+#include <vector>
+
+//  Pop the next queued alert, and check its state. Return its description
+
+static std::string s_pop_alert(fty_sensor_gpio_alerts_t* alerts, const char* state)
+{
+    char*   subject = nullptr;
+    zmsg_t* message = fty_sensor_gpio_alerts_pop(alerts, &subject);
+    REQUIRE(message);
+    CHECK(streq(subject, "door-contact.state-change@sensorgpio-10/CRITICAL@sensorgpio-10"));
+    fty_proto_t* alert = fty_proto_decode(&message);
+    REQUIRE(alert);
+    CHECK(fty_proto_id(alert) == FTY_PROTO_ALERT);
+    CHECK(streq(fty_proto_rule(alert), "door-contact.state-change@sensorgpio-10"));
+    CHECK(streq(fty_proto_name(alert), "sensorgpio-10"));
+    CHECK(streq(fty_proto_state(alert), state));
+    CHECK(streq(fty_proto_severity(alert), "CRITICAL"));
+    CHECK(fty_proto_ttl(alert) == 60);
+    std::string description = fty_proto_description(alert);
+    fty_proto_destroy(&alert);
+    zstr_free(&subject);
+    return description;
+}
+
+TEST_CASE("sensor gpio alerts test")
+{
+    //  @selftest
+    char       asset_name[]    = "sensorgpio-10";
+    char       ext_name[]      = "Door Rack01";
+    char       type[]          = "door-contact";
+    char       alarm_message[] = "$device_name has been $status";
+    char       severity[]      = "CRITICAL";
+    gpx_info_t sensor{};
+    sensor.asset_name     = asset_name;
+    sensor.gpx_direction  = GPIO_DIRECTION_IN;
+    sensor.normal_state   = GPIO_STATE_CLOSED;
+    sensor.ext_name       = ext_name;
+    sensor.type           = type;
+    sensor.alarm_message  = alarm_message;
+    sensor.alarm_severity = severity;
+
+    fty_sensor_gpio_alerts_t* alerts = fty_sensor_gpio_alerts_new("gpio-alerts-test");
+    REQUIRE(alerts);
+    alerts->alert_ttl = 60;
+    int64_t  now      = zclock_mono();
+    uint64_t time     = uint64_t(zclock_time() / 1000);
+    char*    subject  = nullptr;
+
+    // A normal state raises nothing, nor does an unknown one
+    CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_CLOSED, time, now) == 0);
+    CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_UNKNOWN, time, now) == 0);
+    CHECK(fty_sensor_gpio_alerts_pop(alerts, &subject) == nullptr);
+
+    // An abnormal state raises the alert once, however long it lasts
+    CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_OPENED, time, now) == 1);
+    CHECK(sensor.alert_triggered);
+    for (int poll = 1; poll <= 100; poll++)
+        CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_OPENED, time, now + poll * 100) == 0);
+    CHECK(s_pop_alert(alerts, "ACTIVE") == "Door Rack01 has been opened");
+    CHECK(fty_sensor_gpio_alerts_pop(alerts, &subject) == nullptr);
+
+    // Until it is refreshed, at half its TTL, on its own timer
+    CHECK(fty_sensor_gpio_alerts_next_deadline(alerts) >= now + 30000);
+    CHECK(fty_sensor_gpio_alerts_expire(alerts, now + 29000) == 0);
+    CHECK(fty_sensor_gpio_alerts_expire(alerts, now + 31000) == 1);
+    CHECK(s_pop_alert(alerts, "ACTIVE") == "Door Rack01 has been opened");
+
+    // Then back to normal, the alert resolves once
+    CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_CLOSED, time, now + 30100) == 1);
+    CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_CLOSED, time, now + 90000) == 0);
+    CHECK(!sensor.alert_triggered);
+    CHECK(s_pop_alert(alerts, "RESOLVED") == "Door Rack01 has been closed");
+
+    // A change of normal state is taken into account at the next status
+    sensor.normal_state = GPIO_STATE_OPENED;
+    CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_CLOSED, time, now + 90100) == 1);
+    s_pop_alert(alerts, "ACTIVE");
+
+    // GPO are not alerted on
+    sensor.gpx_direction = GPIO_DIRECTION_OUT;
+    CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_OPENED, time, now + 90200) == 0);
+
+    CHECK(alerts->alerts_raised == 2);
+    CHECK(alerts->alerts_resolved == 1);
+    CHECK(alerts->alerts_refreshed == 1);
+    CHECK(alerts->evaluations == 107);
+
+    fty_sensor_gpio_alerts_forget(alerts, asset_name);
+    fty_sensor_gpio_alerts_destroy(&alerts);
+    CHECK(alerts == nullptr);
+    //  @end
+}
+
+//  Drain the queued alerts. Return their number
+
+static size_t s_drain_alerts(fty_sensor_gpio_alerts_t* alerts)
+{
+    size_t  count   = 0;
+    char*   subject = nullptr;
+    zmsg_t* message = fty_sensor_gpio_alerts_pop(alerts, &subject);
+    while (message) {
+        count++;
+        zmsg_destroy(&message);
+        zstr_free(&subject);
+        message = fty_sensor_gpio_alerts_pop(alerts, &subject);
+    }
+    return count;
+}
+
+TEST_CASE("sensor gpio alerts qualification test")
+{
+    char       asset_name[] = "sensorgpio-11";
+    gpx_info_t sensor{};
+    sensor.asset_name    = asset_name;
+    sensor.gpx_direction = GPIO_DIRECTION_IN;
+    sensor.normal_state  = GPIO_STATE_CLOSED;
+    sensor.alarm_delay   = 500;
+    sensor.clear_delay   = 1000;
+
+    fty_sensor_gpio_alerts_t* alerts = fty_sensor_gpio_alerts_new("gpio-alerts-test");
+    REQUIRE(alerts);
+    int64_t  now  = zclock_mono();
+    uint64_t time = uint64_t(zclock_time() / 1000);
+
+    // Evaluate a state for some time, read every period (ms) plus some jitter,
+    // and qualify the changes as they are due. Return the number of alerts
+    uint32_t seed     = 42;
+    auto     evaluate = [&](int state, int duration, int period, int jitter) -> size_t {
+        int64_t end   = now + duration;
+        size_t  count = 0;
+        while (now < end) {
+            count += size_t(fty_sensor_gpio_alerts_evaluate(alerts, &sensor, state, time, now));
+            seed = seed * 1103515245 + 12345;
+            int64_t next = now + period + ((jitter) ? int64_t((seed >> 16) % uint32_t(2 * jitter)) - jitter : 0);
+            int64_t deadline = fty_sensor_gpio_alerts_next_deadline(alerts);
+            while ((deadline != -1) && (deadline <= std::min(next, end))) {
+                count += fty_sensor_gpio_alerts_expire(alerts, deadline);
+                deadline = fty_sensor_gpio_alerts_next_deadline(alerts);
+            }
+            now = std::min(next, end);
+        }
+        CHECK(s_drain_alerts(alerts) == count);
+        return count;
+    };
+
+    // A sensor chattering every 50 ms raises nothing
+    for (int burst = 0; burst < 100; burst++) {
+        CHECK(evaluate(GPIO_STATE_OPENED, 50, 10, 0) == 0);
+        CHECK(evaluate(GPIO_STATE_CLOSED, 50, 10, 0) == 0);
+    }
+    CHECK(alerts->changes_filtered == 100);
+    CHECK(fty_sensor_gpio_alerts_next_deadline(alerts) == -1);
+
+    // Abnormal for 600 ms then normal for 200 ms: raised once, never resolved
+    CHECK(evaluate(GPIO_STATE_OPENED, 600, 100, 40) == 1);
+    for (int burst = 0; burst < 20; burst++) {
+        CHECK(evaluate(GPIO_STATE_CLOSED, 200, 100, 40) == 0);
+        CHECK(evaluate(GPIO_STATE_OPENED, 600, 100, 40) == 0);
+    }
+    // Then resolved once normal for 1 s, despite the poll jitter
+    CHECK(evaluate(GPIO_STATE_CLOSED, 900, 100, 40) == 0);
+    CHECK(evaluate(GPIO_STATE_CLOSED, 200, 100, 40) == 1);
+    CHECK(alerts->alerts_raised == 1);
+    CHECK(alerts->alerts_resolved == 1);
+
+    // Bursts of random lengths never yield more alerts than the delays allow
+    size_t  count = 0;
+    int64_t start = now;
+    for (int burst = 0; burst < 500; burst++) {
+        seed = seed * 1103515245 + 12345;
+        count += evaluate((burst % 2) ? GPIO_STATE_CLOSED : GPIO_STATE_OPENED, 20 + int((seed >> 16) % 1500), 20, 10);
+    }
+    CHECK(count > 0);
+    CHECK(count <= size_t((now - start) / (sensor.alarm_delay + sensor.clear_delay)) * 2 + 1);
+    CHECK(alerts->alerts_raised - alerts->alerts_resolved <= 1);
+
+    // A forgotten sensor has no change left to qualify
+    bool active = (alerts->alerts_raised > alerts->alerts_resolved);
+    CHECK(evaluate((active) ? GPIO_STATE_CLOSED : GPIO_STATE_OPENED, 10, 10, 0) == 0);
+    CHECK(fty_sensor_gpio_alerts_next_deadline(alerts) != -1);
+    fty_sensor_gpio_alerts_forget(alerts, asset_name);
+    CHECK(fty_sensor_gpio_alerts_next_deadline(alerts) == -1);
+
+    fty_sensor_gpio_alerts_destroy(&alerts);
+}
+
+//  Pop the queued alerts. Return their subjects
+
+static std::vector<std::string> s_pop_subjects(fty_sensor_gpio_alerts_t* alerts)
+{
+    std::vector<std::string> subjects;
+    char*                    subject = nullptr;
+    zmsg_t*                  message = fty_sensor_gpio_alerts_pop(alerts, &subject);
+    while (message) {
+        subjects.push_back(subject);
+        zmsg_destroy(&message);
+        zstr_free(&subject);
+        message = fty_sensor_gpio_alerts_pop(alerts, &subject);
+    }
+    return subjects;
+}
+
+static std::string s_sensor_subject(const std::string& asset_name)
+{
+    return "sensorgpio.state-change@" + asset_name + "/WARNING@" + asset_name;
+}
+
+TEST_CASE("sensor gpio alerts storm test")
+{
+    char                     parent[] = "rackcontroller-0";
+    std::vector<std::string> names;
+    std::vector<gpx_info_t>  sensors;
+    names.reserve(10);
+    sensors.reserve(10);
+    for (int index = 0; index < 10; index++) {
+        names.push_back("sensorgpio-" + std::to_string(20 + index));
+        gpx_info_t sensor{};
+        sensor.asset_name    = &names.back()[0];
+        sensor.gpx_direction = GPIO_DIRECTION_IN;
+        sensor.normal_state  = GPIO_STATE_CLOSED;
+        sensor.parent        = parent;
+        sensors.push_back(sensor);
+    }
+
+    fty_sensor_gpio_alerts_t* alerts = fty_sensor_gpio_alerts_new("gpio-alerts-test");
+    REQUIRE(alerts);
+    alerts->storm_threshold = 4;
+    alerts->storm_window    = 1000;
+    alerts->storm_rate      = 2;
+    alerts->storm_burst     = 2;
+    int64_t  now            = zclock_mono();
+    uint64_t time           = uint64_t(zclock_time() / 1000);
+
+    // All the GPIs of the parent flip at once: the first 4 alerts go through,
+    // then the storm alert, and as many alerts as the burst allows
+    int queued = 0;
+    for (gpx_info_t& sensor : sensors)
+        queued += fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_OPENED, time, now);
+    CHECK(queued == 7);
+    std::vector<std::string> subjects = s_pop_subjects(alerts);
+    REQUIRE(subjects.size() == 7);
+    CHECK(subjects[3] == s_sensor_subject(names[3]));
+    CHECK(subjects[4] == "gpio-storm@rackcontroller-0/WARNING@rackcontroller-0");
+    CHECK(subjects[6] == s_sensor_subject(names[5]));
+    CHECK(fty_sensor_gpio_alerts_storms(alerts) == 1);
+    CHECK(alerts->storms_detected == 1);
+    CHECK(alerts->alerts_deferred == 6);
+
+    // Held sensors back to normal are coalesced, nothing gets published
+    CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensors[6], GPIO_STATE_CLOSED, time, now + 100) == 0);
+    CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensors[7], GPIO_STATE_CLOSED, time, now + 100) == 0);
+    CHECK(alerts->alerts_coalesced == 2);
+
+    // The other held alerts are released at the storm rate, then the storm
+    // resolves once the changes left the window
+    CHECK(fty_sensor_gpio_alerts_next_deadline(alerts) == now + 500);
+    CHECK(fty_sensor_gpio_alerts_expire(alerts, now + 500) == 1);
+    CHECK(s_pop_subjects(alerts) == std::vector<std::string>{s_sensor_subject(names[8])});
+    CHECK(fty_sensor_gpio_alerts_next_deadline(alerts) == now + 1000);
+    CHECK(fty_sensor_gpio_alerts_expire(alerts, now + 1000) == 2);
+    CHECK(s_pop_subjects(alerts) ==
+          std::vector<std::string>{
+              s_sensor_subject(names[9]), "gpio-storm@rackcontroller-0/WARNING@rackcontroller-0"});
+    // Only the refreshes of the active alerts are left
+    CHECK(fty_sensor_gpio_alerts_next_deadline(alerts) >= now + alerts->alert_ttl * 1000 / 2);
+    CHECK(fty_sensor_gpio_alerts_storms(alerts) == 0);
+    CHECK(alerts->alerts_metered == 4);
+    CHECK(alerts->alerts_coalesced == 4);
+    CHECK(alerts->alerts_raised == 10);
+    CHECK(alerts->alerts_resolved == 2);
+
+    // Once steady, a single change goes through at once
+    CHECK(fty_sensor_gpio_alerts_evaluate(alerts, &sensors[0], GPIO_STATE_CLOSED, time, now + 5000) == 1);
+    CHECK(s_pop_subjects(alerts) == std::vector<std::string>{s_sensor_subject(names[0])});
+
+    // With storm control disabled, the alerts are never held
+    alerts->storm_threshold = 0;
+    for (gpx_info_t& sensor : sensors)
+        fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_OPENED, time, now + 6000);
+    CHECK(s_pop_subjects(alerts).size() == 3);
+    CHECK(alerts->storms_detected == 1);
+    fty_sensor_gpio_alerts_destroy(&alerts);
+
+    // The active alerts of a parent in storm are only refreshed once it
+    // resolved
+    alerts = fty_sensor_gpio_alerts_new("gpio-alerts-test");
+    REQUIRE(alerts);
+    alerts->alert_ttl       = 2;
+    alerts->storm_threshold = 4;
+    alerts->storm_window    = 5000;
+    alerts->storm_rate      = 100;
+    alerts->storm_burst     = 100;
+    now                     = zclock_mono();
+    for (gpx_info_t& sensor : sensors) {
+        sensor.normal_state = GPIO_STATE_OPENED;
+        fty_sensor_gpio_alerts_evaluate(alerts, &sensor, GPIO_STATE_CLOSED, time, now);
+    }
+    CHECK(s_pop_subjects(alerts).size() == 11);
+    CHECK(fty_sensor_gpio_alerts_storms(alerts) == 1);
+    CHECK(fty_sensor_gpio_alerts_expire(alerts, now + 3000) == 0);
+    CHECK(alerts->alerts_refreshed == 0);
+    CHECK(fty_sensor_gpio_alerts_expire(alerts, now + 6000) == 1);
+    CHECK(fty_sensor_gpio_alerts_storms(alerts) == 0);
+    CHECK(fty_sensor_gpio_alerts_expire(alerts, now + 10000) == 10);
+    CHECK(alerts->alerts_refreshed == 10);
+    s_pop_subjects(alerts);
+
+    fty_sensor_gpio_alerts_destroy(&alerts);
+}
+
+TEST_CASE("sensor gpio alerts benchmark", "[.]")
+{
+    const int sensor_count = 5000;
+    const int rounds       = 200;
+
+    std::vector<std::string> names;
+    std::vector<gpx_info_t>  sensors;
+    names.reserve(sensor_count);
+    sensors.reserve(sensor_count);
+    for (int index = 0; index < sensor_count; index++) {
+        names.push_back("sensorgpio-" + std::to_string(index));
+        gpx_info_t sensor{};
+        sensor.asset_name    = &names.back()[0];
+        sensor.gpx_direction = GPIO_DIRECTION_IN;
+        sensor.normal_state  = GPIO_STATE_CLOSED;
+        sensors.push_back(sensor);
+    }
+
+    fty_sensor_gpio_alerts_t* alerts = fty_sensor_gpio_alerts_new("gpio-alerts-bench");
+    REQUIRE(alerts);
+    uint64_t time = uint64_t(zclock_time() / 1000);
+    int64_t  now  = zclock_mono();
+
+    // Each round, 1% of the sensors change state, the others are steady
+    uint32_t seed      = 42;
+    size_t   published = 0;
+    int64_t  start     = zclock_usecs();
+    for (int round = 0; round < rounds; round++) {
+        for (gpx_info_t& sensor : sensors) {
+            seed = seed * 1103515245 + 12345;
+            if ((seed >> 16) % 100 == 0)
+                sensor.current_state = (sensor.current_state == GPIO_STATE_OPENED) ? GPIO_STATE_CLOSED
+                                                                                    : GPIO_STATE_OPENED;
+            else if (sensor.current_state == GPIO_STATE_UNKNOWN)
+                sensor.current_state = GPIO_STATE_CLOSED;
+            fty_sensor_gpio_alerts_evaluate(alerts, &sensor, sensor.current_state, time, now + round * 100);
+        }
+        char*   subject = nullptr;
+        zmsg_t* message = fty_sensor_gpio_alerts_pop(alerts, &subject);
+        while (message) {
+            published++;
+            zmsg_destroy(&message);
+            zstr_free(&subject);
+            message = fty_sensor_gpio_alerts_pop(alerts, &subject);
+        }
+    }
+    int64_t elapsed = zclock_usecs() - start;
+
+    uint64_t evaluations = uint64_t(sensor_count) * rounds;
+    CHECK(alerts->evaluations == evaluations);
+    CHECK(published == alerts->alerts_raised + alerts->alerts_resolved);
+    printf("Sensor states evaluated per second: %.0f, with %i sensors (%zu alerts)\n",
+        double(evaluations) * 1000000 / double(std::max(elapsed, int64_t(1))), sensor_count, published);
+
+    fty_sensor_gpio_alerts_destroy(&alerts);
+}
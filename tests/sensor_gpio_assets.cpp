@@ -4,7 +4,10 @@
 #include <catch2/catch.hpp>
 #include <fty_log.h>
 #include <fty_proto.h>
+#include <algorithm>
 #include <malamute.h>
+#include <string>
+#include <vector>
 
 TEST_CASE("sensor gpio assets test", "[.]")
 {
@@ -331,3 +334,123 @@ TEST_CASE("sensor gpio assets test", "[.]")
     zactor_destroy(&assets);
     zactor_destroy(&server);
 }
+
+//  Add a GPI sensor to the registry
+
+static int s_add_gpi(fty_sensor_gpio_assets_t* assets, const char* operation, const std::string& asset_name,
+    const std::string& ext_name, int gpi_number)
+{
+    return add_sensor(assets, operation, "Eaton", asset_name.c_str(), ext_name.c_str(), "DCS001", "door-contact",
+        "closed", std::to_string(gpi_number).c_str(), "GPI", "rackcontroller-1", "Rack1", "",
+        "$device_name has been $status", "WARNING");
+}
+
+TEST_CASE("sensor gpio assets registry test")
+{
+    fty_sensor_gpio_assets_t* assets = fty_sensor_gpio_assets_new("gpio-assets-registry");
+    REQUIRE(assets);
+    assets->test_mode = true;
+
+    REQUIRE(s_add_gpi(assets, "create", "sensorgpio-10", "Door1", 1) == 0);
+    REQUIRE(s_add_gpi(assets, "create", "sensorgpio-11", "Door2", 2) == 0);
+    REQUIRE(s_add_gpi(assets, "create", "sensorgpio-12", "Door2", 3) == 0);
+    // Already monitored, skipped
+    REQUIRE(s_add_gpi(assets, "create", "sensorgpio-10", "Door3", 4) == 0);
+
+    pthread_mutex_lock(&gpx_list_mutex);
+    CHECK(zlistx_size(get_gpx_list()) == 3);
+    // The first sensor is found by both names
+    gpx_info_t* gpx_info = get_gpx_info("sensorgpio-10");
+    REQUIRE(gpx_info);
+    CHECK(gpx_info == zlistx_first(get_gpx_list()));
+    CHECK(gpx_info->gpx_number == 1);
+    CHECK(get_gpx_info_by_name("Door1") == gpx_info);
+    CHECK(get_gpx_info_by_name("sensorgpio-10") == gpx_info);
+    CHECK(get_gpx_info_by_name("Door3") == nullptr);
+    // A shared ext name gives the oldest sensor
+    CHECK(get_gpx_info_by_name("Door2") == get_gpx_info("sensorgpio-11"));
+    CHECK(get_gpx_info("Door2") == nullptr);
+    pthread_mutex_unlock(&gpx_list_mutex);
+
+    // An update is indexed under its new ext name only
+    REQUIRE(s_add_gpi(assets, "update", "sensorgpio-11", "Door4", 5) == 0);
+    pthread_mutex_lock(&gpx_list_mutex);
+    CHECK(zlistx_size(get_gpx_list()) == 3);
+    CHECK(get_gpx_info("sensorgpio-11")->gpx_number == 5);
+    CHECK(get_gpx_info_by_name("Door4") == get_gpx_info("sensorgpio-11"));
+    CHECK(get_gpx_info_by_name("Door2") == get_gpx_info("sensorgpio-12"));
+    pthread_mutex_unlock(&gpx_list_mutex);
+
+    // A deleted sensor is found by neither name, the others keep their order
+    CHECK(delete_sensor(assets, "sensorgpio-12") == 0);
+    CHECK(delete_sensor(assets, "sensorgpio-12") == 1);
+    pthread_mutex_lock(&gpx_list_mutex);
+    CHECK(get_gpx_info("sensorgpio-12") == nullptr);
+    CHECK(get_gpx_info_by_name("Door2") == nullptr);
+    std::vector<std::string> names;
+    gpx_info = static_cast<gpx_info_t*>(zlistx_first(get_gpx_list()));
+    while (gpx_info) {
+        names.push_back(gpx_info->asset_name);
+        gpx_info = static_cast<gpx_info_t*>(zlistx_next(get_gpx_list()));
+    }
+    CHECK(names == std::vector<std::string>{"sensorgpio-10", "sensorgpio-11"});
+    pthread_mutex_unlock(&gpx_list_mutex);
+
+    fty_sensor_gpio_assets_destroy(&assets);
+}
+
+TEST_CASE("sensor gpio assets lookup benchmark", "[.]")
+{
+    const int lookups = 1000000;
+    const int scans   = 1000;
+
+    for (int sensor_count : {10, 1000, 100000}) {
+        fty_sensor_gpio_assets_t* assets = fty_sensor_gpio_assets_new("gpio-assets-bench");
+        REQUIRE(assets);
+        assets->test_mode = true;
+        for (int index = 0; index < sensor_count; index++)
+            REQUIRE(s_add_gpi(assets, "create", "sensorgpio-" + std::to_string(index),
+                        "GPIO-Sensor-" + std::to_string(index), index % 10 + 1) == 0);
+
+        std::vector<std::string> asset_names;
+        std::vector<std::string> ext_names;
+        uint32_t                 seed = 42;
+        for (int index = 0; index < 1024; index++) {
+            seed = seed * 1103515245 + 12345;
+            asset_names.push_back("sensorgpio-" + std::to_string((seed >> 8) % uint32_t(sensor_count)));
+            ext_names.push_back("GPIO-Sensor-" + std::to_string((seed >> 8) % uint32_t(sensor_count)));
+        }
+
+        pthread_mutex_lock(&gpx_list_mutex);
+        size_t  found      = 0;
+        int64_t started_at = zclock_usecs();
+        for (int lookup = 0; lookup < lookups; lookup++)
+            found += (get_gpx_info(asset_names[size_t(lookup) % 1024].c_str())) ? 1 : 0;
+        int64_t asset_time = zclock_usecs() - started_at;
+
+        started_at = zclock_usecs();
+        for (int lookup = 0; lookup < lookups; lookup++)
+            found += (get_gpx_info_by_name(ext_names[size_t(lookup) % 1024].c_str())) ? 1 : 0;
+        int64_t ext_time = zclock_usecs() - started_at;
+
+        // Reference: the linear scan on both names the lookups replaced
+        started_at = zclock_usecs();
+        for (int scan = 0; scan < scans; scan++) {
+            const char* name     = ext_names[size_t(scan) % 1024].c_str();
+            gpx_info_t* gpx_info = static_cast<gpx_info_t*>(zlistx_first(get_gpx_list()));
+            while (gpx_info && !streq(gpx_info->asset_name, name) && !streq(gpx_info->ext_name, name))
+                gpx_info = static_cast<gpx_info_t*>(zlistx_next(get_gpx_list()));
+            found += (gpx_info) ? 1 : 0;
+        }
+        int64_t scan_time = zclock_usecs() - started_at;
+        pthread_mutex_unlock(&gpx_list_mutex);
+        CHECK(found == size_t(2 * lookups + scans));
+
+        printf("Lookups per second with %i sensors: %.0f by asset name, %.0f by ext name, %.0f by linear scan\n",
+            sensor_count, lookups * 1000000.0 / double(std::max(asset_time, int64_t(1))),
+            lookups * 1000000.0 / double(std::max(ext_time, int64_t(1))),
+            scans * 1000000.0 / double(std::max(scan_time, int64_t(1))));
+
+        fty_sensor_gpio_assets_destroy(&assets);
+    }
+}
@@ -0,0 +1,155 @@
+/*  ========================================================================
+    Copyright (C) 2021 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "src/fty_sensor_gpio_catalog.h"
+#include <catch2/catch.hpp>
+#include <stdio.h>
+#include <string>
+
+static void s_write_file(const std::string& filename, const char* content)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    REQUIRE(file);
+    fputs(content, file);
+    fclose(file);
+}
+
+static void s_write_template(const std::string& template_dir, const char* model, const char* content)
+{
+    s_write_file(template_dir + model + ".tpl", content);
+}
+
+//  Wait for the template changes, and refresh the catalog
+static size_t s_refresh(fty_sensor_gpio_catalog_t* catalog)
+{
+    zmq_pollitem_t item = {nullptr, fty_sensor_gpio_catalog_fd(catalog), ZMQ_POLLIN, 0};
+    REQUIRE(zmq_poll(&item, 1, 1000) == 1);
+    return fty_sensor_gpio_catalog_refresh(catalog);
+}
+
+TEST_CASE("sensor gpio catalog test")
+{
+    //  @selftest
+    std::string template_dir = "./catalog-templates/";
+    zsys_dir_create(template_dir.c_str());
+    s_write_template(template_dir, "DCS001",
+        "manufacturer   = Eaton\n"
+        "part-number    = DCS001\n"
+        "type           = door-contact-sensor\n"
+        "normal-state   = closed\n"
+        "gpx-direction  = GPI\n"
+        "power-source   = internal\n"
+        "alarm-severity = CRITICAL\n"
+        "alarm-message  = Door has been $status\n"
+        "alarm-delay    = 500\n");
+    s_write_template(template_dir, "WLD012",
+        "manufacturer   = Eaton\n"
+        "type           = water-leak-detector\n"
+        "normal-state   = opened\n");
+    s_write_file(template_dir + "README", "not a template\n");
+
+    fty_sensor_gpio_catalog_t* catalog = fty_sensor_gpio_catalog_new(template_dir.c_str());
+    REQUIRE(catalog);
+    CHECK(fty_sensor_gpio_catalog_size(catalog) == 2);
+    CHECK(fty_sensor_gpio_catalog_loads(catalog) == 2);
+    REQUIRE(fty_sensor_gpio_catalog_fd(catalog) != -1);
+
+    // All the keys are parsed, the missing ones get their defaults
+    const fty_sensor_gpio_template_t* dcs001 = fty_sensor_gpio_catalog_lookup(catalog, "DCS001");
+    REQUIRE(dcs001);
+    CHECK(streq(dcs001->model, "DCS001"));
+    CHECK(streq(dcs001->type, "door-contact-sensor"));
+    CHECK(streq(dcs001->normal_state, "closed"));
+    CHECK(streq(dcs001->alarm_severity, "CRITICAL"));
+    CHECK(streq(dcs001->alarm_message, "Door has been $status"));
+    CHECK(streq(dcs001->alarm_delay, "500"));
+    CHECK(streq(dcs001->clear_delay, ""));
+    const fty_sensor_gpio_template_t* wld012 = fty_sensor_gpio_catalog_lookup(catalog, "WLD012");
+    REQUIRE(wld012);
+    CHECK(streq(wld012->gpx_direction, "GPI"));
+    CHECK(streq(wld012->alarm_severity, "WARNING"));
+    CHECK(streq(wld012->power_source, ""));
+
+    // Lookups, hits or misses, never parse a file again
+    for (int i = 0; i < 100; i++) {
+        CHECK(fty_sensor_gpio_catalog_lookup(catalog, "DCS001") == dcs001);
+        CHECK(fty_sensor_gpio_catalog_lookup(catalog, "NOPE") == nullptr);
+    }
+    CHECK(fty_sensor_gpio_catalog_loads(catalog) == 2);
+    CHECK(fty_sensor_gpio_catalog_refresh(catalog) == 0);
+
+    // A template written is parsed again, on its own
+    s_write_template(template_dir, "WLD012",
+        "manufacturer   = Eaton\n"
+        "type           = water-leak-detector\n"
+        "normal-state   = closed\n");
+    CHECK(s_refresh(catalog) == 1);
+    CHECK(fty_sensor_gpio_catalog_loads(catalog) == 3);
+    wld012 = fty_sensor_gpio_catalog_lookup(catalog, "WLD012");
+    REQUIRE(wld012);
+    CHECK(streq(wld012->normal_state, "closed"));
+    CHECK(fty_sensor_gpio_catalog_lookup(catalog, "DCS001") == dcs001);
+
+    // A template added shows up, a template removed goes away
+    s_write_template(template_dir, "GPOGEN",
+        "manufacturer   = Generic\n"
+        "gpx-direction  = GPO\n");
+    CHECK(s_refresh(catalog) == 1);
+    const fty_sensor_gpio_template_t* gpogen = fty_sensor_gpio_catalog_lookup(catalog, "GPOGEN");
+    REQUIRE(gpogen);
+    CHECK(streq(gpogen->gpx_direction, "GPO"));
+    CHECK(fty_sensor_gpio_catalog_size(catalog) == 3);
+
+    zsys_file_delete((template_dir + "DCS001.tpl").c_str());
+    CHECK(s_refresh(catalog) == 1);
+    CHECK(fty_sensor_gpio_catalog_lookup(catalog, "DCS001") == nullptr);
+    CHECK(fty_sensor_gpio_catalog_size(catalog) == 2);
+    CHECK(fty_sensor_gpio_catalog_loads(catalog) == 4);
+
+    // A template directory removed drops its templates, and is watched again
+    // once it is back
+    zdir_t* dir = zdir_new(template_dir.c_str(), nullptr);
+    REQUIRE(dir);
+    zdir_remove(dir, true);
+    zdir_destroy(&dir);
+    s_refresh(catalog);
+    CHECK(fty_sensor_gpio_catalog_size(catalog) == 0);
+    CHECK(fty_sensor_gpio_catalog_fd(catalog) == -1);
+
+    zsys_dir_create(template_dir.c_str());
+    s_write_template(template_dir, "WLD012",
+        "manufacturer   = Eaton\n"
+        "normal-state   = opened\n");
+    wld012 = fty_sensor_gpio_catalog_lookup(catalog, "WLD012");
+    REQUIRE(wld012);
+    CHECK(streq(wld012->normal_state, "opened"));
+    REQUIRE(fty_sensor_gpio_catalog_fd(catalog) != -1);
+    s_write_template(template_dir, "WLD012",
+        "manufacturer   = Eaton\n"
+        "normal-state   = closed\n");
+    CHECK(s_refresh(catalog) == 1);
+    wld012 = fty_sensor_gpio_catalog_lookup(catalog, "WLD012");
+    REQUIRE(wld012);
+    CHECK(streq(wld012->normal_state, "closed"));
+
+    fty_sensor_gpio_catalog_destroy(&catalog);
+    CHECK(catalog == nullptr);
+
+    dir = zdir_new(template_dir.c_str(), nullptr);
+    REQUIRE(dir);
+    zdir_remove(dir, true);
+    zdir_destroy(&dir);
+    //  @end
+}
@@ -0,0 +1,215 @@
+/*  ========================================================================
+    Copyright (C) 2021 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "src/fty_sensor_gpio_metric.h"
+#include "src/libgpio.h"
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <fty_proto.h>
+#include <malamute.h>
+#include <string>
+#include <vector>
+
+TEST_CASE("sensor gpio metric test")
+{
+    //  @selftest
+    char       asset_name[] = "sensorgpio-10";
+    char       parent[]     = "IPC1";
+    gpx_info_t sensor{};
+    sensor.asset_name    = asset_name;
+    sensor.parent        = parent;
+    sensor.gpx_number    = 1;
+    sensor.gpx_direction = GPIO_DIRECTION_IN;
+    sensor.current_state = GPIO_STATE_OPENED;
+
+    fty_sensor_gpio_metric_t* metric = fty_sensor_gpio_metric_new(&sensor);
+    REQUIRE(metric);
+    CHECK(streq(fty_sensor_gpio_metric_type(metric), "status.GPI1"));
+    CHECK(streq(fty_sensor_gpio_metric_topic(metric), "status.GPI1@IPC1"));
+    CHECK(fty_sensor_gpio_metric_matches(metric, &sensor));
+
+    // Only the value, time and TTL are filled in at publish time
+    zmsg_t* msg = fty_sensor_gpio_metric_encode(metric, GPIO_STATE_OPENED, 1000, 300);
+    REQUIRE(msg);
+    fty_proto_t* decoded = fty_proto_decode(&msg);
+    REQUIRE(decoded);
+    CHECK(streq(fty_proto_name(decoded), "IPC1"));
+    CHECK(streq(fty_proto_type(decoded), "status.GPI1"));
+    CHECK(streq(fty_proto_value(decoded), "opened"));
+    CHECK(fty_proto_time(decoded) == 1000);
+    CHECK(fty_proto_ttl(decoded) == 300);
+    CHECK(streq(fty_proto_aux_string(decoded, FTY_PROTO_METRICS_SENSOR_AUX_PORT, ""), "GPI1"));
+    CHECK(streq(fty_proto_aux_string(decoded, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, ""), "sensorgpio-10"));
+    fty_proto_destroy(&decoded);
+
+    msg = fty_sensor_gpio_metric_encode(metric, GPIO_STATE_CLOSED, 1001, 300);
+    REQUIRE(msg);
+    decoded = fty_proto_decode(&msg);
+    REQUIRE(decoded);
+    CHECK(streq(fty_proto_value(decoded), "closed"));
+    fty_proto_destroy(&decoded);
+
+    // A sensor moved to another GPx or parent needs a new template
+    sensor.gpx_number = 2;
+    CHECK(!fty_sensor_gpio_metric_matches(metric, &sensor));
+    sensor.gpx_number    = 1;
+    sensor.gpx_direction = GPIO_DIRECTION_OUT;
+    CHECK(!fty_sensor_gpio_metric_matches(metric, &sensor));
+    sensor.gpx_direction = GPIO_DIRECTION_IN;
+    char other_parent[]  = "IPC2";
+    sensor.parent        = other_parent;
+    CHECK(!fty_sensor_gpio_metric_matches(metric, &sensor));
+
+    fty_sensor_gpio_metric_destroy(&metric);
+    CHECK(metric == nullptr);
+    //  @end
+}
+
+//  Encode a status metric the way it was before the templates: everything
+//  is built again for every publication
+static zmsg_t* s_encode_legacy(gpx_info_t* sensor, int ttl, std::string& topic)
+{
+    zhash_t* aux = zhash_new();
+    zhash_autofree(aux);
+    char port[6];
+    memset(&port[0], 0, 6);
+    snprintf(&port[0], 6, "GP%c%i", ((sensor->gpx_direction == GPIO_DIRECTION_IN) ? 'I' : 'O'), sensor->gpx_number);
+    zhash_insert(aux, FTY_PROTO_METRICS_SENSOR_AUX_PORT, static_cast<void*>(&port[0]));
+    zhash_insert(aux, FTY_PROTO_METRICS_SENSOR_AUX_SNAME, static_cast<void*>(sensor->asset_name));
+    std::string msg_type = std::string("status.") + &port[0];
+    zmsg_t*     msg      = fty_proto_encode_metric(aux, uint64_t(time(nullptr)), uint32_t(ttl), msg_type.c_str(),
+        sensor->parent, libgpio_get_status_string(sensor->current_state).c_str(), "");
+    zhash_destroy(&aux);
+    topic = msg_type + std::string("@") + sensor->parent;
+    return msg;
+}
+
+TEST_CASE("sensor gpio metric benchmark", "[.]")
+{
+    const int  publishes    = 200000;
+    char       asset_name[] = "sensorgpio-10";
+    char       parent[]     = "IPC1";
+    gpx_info_t sensor{};
+    sensor.asset_name    = asset_name;
+    sensor.parent        = parent;
+    sensor.gpx_number    = 1;
+    sensor.gpx_direction = GPIO_DIRECTION_IN;
+    sensor.current_state = GPIO_STATE_OPENED;
+
+    int64_t     started_at = zclock_usecs();
+    std::string topic;
+    for (int i = 0; i < publishes; i++) {
+        zmsg_t* msg = s_encode_legacy(&sensor, 300, topic);
+        REQUIRE(msg);
+        zmsg_destroy(&msg);
+    }
+    int64_t legacy_time = zclock_usecs() - started_at;
+
+    fty_sensor_gpio_metric_t* metric = fty_sensor_gpio_metric_new(&sensor);
+    started_at                       = zclock_usecs();
+    uint64_t now                     = uint64_t(time(nullptr));
+    for (int i = 0; i < publishes; i++) {
+        zmsg_t* msg = fty_sensor_gpio_metric_encode(metric, sensor.current_state, now, 300);
+        REQUIRE(msg);
+        zmsg_destroy(&msg);
+    }
+    int64_t template_time = zclock_usecs() - started_at;
+    fty_sensor_gpio_metric_destroy(&metric);
+
+    printf("Status metrics encoded per second: %.0f before, %.0f with templates\n",
+        publishes * 1000000.0 / double(std::max(legacy_time, int64_t(1))),
+        publishes * 1000000.0 / double(std::max(template_time, int64_t(1))));
+    CHECK(template_time <= legacy_time);
+}
+
+//  Publish rounds of the statuses of sensors over malamute, either one
+//  message per status or one batch per round, and return the time (us)
+//  until the consumer received them all
+static int64_t s_publish_rounds(const char* endpoint, std::vector<fty_sensor_gpio_metric_t*>& metrics, int rounds,
+    bool batched)
+{
+    mlm_client_t* producer = mlm_client_new();
+    mlm_client_connect(producer, endpoint, 1000, "fty_sensor_gpio_bench_producer");
+    mlm_client_set_producer(producer, FTY_PROTO_STREAM_METRICS_SENSOR);
+    mlm_client_t* consumer = mlm_client_new();
+    mlm_client_connect(consumer, endpoint, 1000, "fty_sensor_gpio_bench_consumer");
+    mlm_client_set_consumer(consumer, FTY_PROTO_STREAM_METRICS_SENSOR, ".*");
+    zclock_sleep(500);
+
+    int64_t  started_at = zclock_usecs();
+    uint64_t now        = uint64_t(time(nullptr));
+    for (int round = 0; round < rounds; round++) {
+        zmsg_t* batch = (batched) ? zmsg_new() : nullptr;
+        for (fty_sensor_gpio_metric_t* metric : metrics) {
+            zmsg_t* msg = fty_sensor_gpio_metric_encode(metric, GPIO_STATE_OPENED, now, 300);
+            if (batched) {
+                zframe_t* frame = zmsg_pop(msg);
+                zmsg_append(batch, &frame);
+                zmsg_destroy(&msg);
+            } else
+                mlm_client_send(producer, fty_sensor_gpio_metric_topic(metric), &msg);
+        }
+        if (batched)
+            mlm_client_send(producer, "status-batch", &batch);
+    }
+    size_t expected = size_t(rounds) * metrics.size();
+    size_t received = 0;
+    while (received < expected) {
+        zmsg_t* msg = mlm_client_recv(consumer);
+        REQUIRE(msg);
+        received += zmsg_size(msg);
+        zmsg_destroy(&msg);
+    }
+    int64_t elapsed = zclock_usecs() - started_at;
+
+    mlm_client_destroy(&consumer);
+    mlm_client_destroy(&producer);
+    return elapsed;
+}
+
+TEST_CASE("sensor gpio metric publish benchmark", "[.]")
+{
+    static const char* endpoint = "inproc://fty_sensor_gpio_metric_bench";
+    zactor_t*          server   = zactor_new(mlm_server, const_cast<char*>("Malamute"));
+    zstr_sendx(server, "BIND", endpoint, nullptr);
+
+    // The statuses of 100 GPIs, as published by a loaded controller
+    const int                              rounds = 100;
+    std::vector<std::string>               names;
+    std::vector<fty_sensor_gpio_metric_t*> metrics;
+    char                                   parent[] = "IPC1";
+    for (int i = 0; i < 100; i++)
+        names.push_back("sensorgpio-" + std::to_string(i));
+    for (int i = 0; i < 100; i++) {
+        gpx_info_t sensor{};
+        sensor.asset_name    = const_cast<char*>(names[size_t(i)].c_str());
+        sensor.parent        = parent;
+        sensor.gpx_number    = i + 1;
+        sensor.gpx_direction = GPIO_DIRECTION_IN;
+        sensor.current_state = GPIO_STATE_OPENED;
+        metrics.push_back(fty_sensor_gpio_metric_new(&sensor));
+    }
+
+    int64_t single_time  = s_publish_rounds(endpoint, metrics, rounds, false);
+    int64_t batched_time = s_publish_rounds(endpoint, metrics, rounds, true);
+    printf("Status metrics delivered per second: %.0f one by one, %.0f batched\n",
+        double(rounds * metrics.size()) * 1000000.0 / double(std::max(single_time, int64_t(1))),
+        double(rounds * metrics.size()) * 1000000.0 / double(std::max(batched_time, int64_t(1))));
+    CHECK(batched_time <= single_time);
+
+    for (fty_sensor_gpio_metric_t* metric : metrics)
+        fty_sensor_gpio_metric_destroy(&metric);
+    zactor_destroy(&server);
+}
@@ -0,0 +1,77 @@
+/*  ========================================================================
+    Copyright (C) 2021 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "src/fty_sensor_gpio_ring.h"
+#include <catch2/catch.hpp>
+#include <thread>
+
+TEST_CASE("sensor gpio ring test")
+{
+    //  @selftest
+    fty_sensor_gpio_ring_t* ring = fty_sensor_gpio_ring_new(5);
+    REQUIRE(ring);
+    CHECK(fty_sensor_gpio_ring_capacity(ring) == 8);
+
+    // Samples are popped in order, and pushes fail once the ring is full
+    {
+        fty_sensor_gpio_sample_t sample = {1, 0, 1000};
+        for (int i = 0; i < 8; i++) {
+            sample.gpx_number = i;
+            CHECK(fty_sensor_gpio_ring_push(ring, &sample));
+        }
+        CHECK(!fty_sensor_gpio_ring_push(ring, &sample));
+        CHECK(fty_sensor_gpio_ring_depth(ring) == 8);
+        for (int i = 0; i < 8; i++) {
+            CHECK(fty_sensor_gpio_ring_pop(ring, &sample));
+            CHECK(sample.gpx_number == i);
+            CHECK(sample.sampled_at == 1000);
+        }
+        CHECK(!fty_sensor_gpio_ring_pop(ring, &sample));
+        CHECK(fty_sensor_gpio_ring_depth(ring) == 0);
+    }
+
+    // A producer and a consumer thread exchange samples without loss nor
+    // reordering, the producer retrying when the ring is full
+    {
+        const int   count    = 1000000;
+        std::thread producer = std::thread([ring]() {
+            fty_sensor_gpio_sample_t sample = {0, 1, 0};
+            for (int i = 0; i < count; i++) {
+                sample.gpx_number = i;
+                sample.sampled_at = i * 2;
+                while (!fty_sensor_gpio_ring_push(ring, &sample))
+                    std::this_thread::yield();
+            }
+        });
+        int  expected = 0;
+        bool ordered  = true;
+        while (expected < count) {
+            fty_sensor_gpio_sample_t sample;
+            if (!fty_sensor_gpio_ring_pop(ring, &sample)) {
+                std::this_thread::yield();
+                continue;
+            }
+            ordered = ordered && (sample.gpx_number == expected) && (sample.sampled_at == expected * 2);
+            expected++;
+        }
+        producer.join();
+        CHECK(ordered);
+        CHECK(fty_sensor_gpio_ring_depth(ring) == 0);
+    }
+
+    fty_sensor_gpio_ring_destroy(&ring);
+    CHECK(ring == nullptr);
+    //  @end
+}
@@ -2,14 +2,59 @@
 #include "src/fty_sensor_gpio_assets.h"
 #include "src/fty_sensor_gpio_server.h"
 #include "src/libgpio.h"
+#include "src/libgpio_cdev.h"
+#include "src/libgpio_sim.h"
 #include <catch2/catch.hpp>
 #include <czmq.h>
 #include <fty_proto.h>
+#include <fty_shm.h>
+#include <linux/gpio.h>
 #include <malamute.h>
+#include <map>
+#include <poll.h>
+#include <vector>
 
 extern zmsg_t* hw_cap_test_reply_gpi;
 extern zmsg_t* hw_cap_test_reply_gpo;
 
+// Mocked GPIO chip, for the character device backend: line values, and the
+// lines and event pipe (write end) of each line request fd
+static uint64_t                                               s_mock_lines = 0;
+static std::map<int, std::pair<std::vector<uint32_t>, int>> s_mock_requests;
+
+static int s_mock_ioctl(int fd, unsigned long request, void* arg)
+{
+    if (request == GPIO_V2_GET_LINE_IOCTL) {
+        gpio_v2_line_request* line_request = static_cast<gpio_v2_line_request*>(arg);
+        int                   pipe_fds[2];
+        if (pipe(pipe_fds) == -1)
+            return -1;
+        if (s_mock_requests.count(pipe_fds[0]))
+            close(s_mock_requests[pipe_fds[0]].second);
+        s_mock_requests[pipe_fds[0]] = {
+            std::vector<uint32_t>(line_request->offsets, line_request->offsets + line_request->num_lines), pipe_fds[1]};
+        line_request->fd = pipe_fds[0];
+        return 0;
+    }
+    if (!s_mock_requests.count(fd))
+        return -1;
+    const std::vector<uint32_t>& offsets = s_mock_requests[fd].first;
+    if (request == GPIO_V2_LINE_GET_VALUES_IOCTL) {
+        gpio_v2_line_values* values = static_cast<gpio_v2_line_values*>(arg);
+        values->bits                = 0;
+        for (size_t i = 0; i < offsets.size(); i++)
+            if ((values->mask & (1ULL << i)) && (s_mock_lines & (1ULL << offsets[i])))
+                values->bits |= 1ULL << i;
+    } else if (request == GPIO_V2_LINE_SET_VALUES_IOCTL) {
+        gpio_v2_line_values* values = static_cast<gpio_v2_line_values*>(arg);
+        for (size_t i = 0; i < offsets.size(); i++)
+            if (values->mask & (1ULL << i))
+                s_mock_lines = (values->bits & (1ULL << i)) ? (s_mock_lines | (1ULL << offsets[i]))
+                                                            : (s_mock_lines & ~(1ULL << offsets[i]));
+    }
+    return 0;
+}
+
 void libgpio_test()
 {
     const char* SELFTEST_DIR_RW = ".";
@@ -42,11 +87,152 @@ void libgpio_test()
     // Read test
     CHECK(libgpio_read(self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED);
 
+    // Pin sessions test: the pin is kept exported with its value fd opened
+    CHECK(libgpio_get_value_fd(self, 1, GPIO_DIRECTION_IN) >= 0);
+    CHECK(libgpio_write(self, 1, GPIO_STATE_OPENED) == 0);
+    CHECK(libgpio_read(self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED);
+    CHECK(libgpio_get_value_fd(self, 1, GPIO_DIRECTION_IN) >= 0);
+    CHECK(libgpio_get_value_fd(self, 1, GPIO_DIRECTION_OUT) >= 0);
+    // ... and released after each access otherwise
+    libgpio_set_persistent(self, false);
+    CHECK(libgpio_get_value_fd(self, 1, GPIO_DIRECTION_IN) == -1);
+    CHECK(libgpio_write(self, 1, GPIO_STATE_CLOSED) == 0);
+    CHECK(libgpio_read(self, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED);
+    CHECK(libgpio_get_value_fd(self, 1, GPIO_DIRECTION_IN) == -1);
+    CHECK(libgpio_get_value_fd(self, 1, GPIO_DIRECTION_OUT) == -1);
+    libgpio_set_persistent(self, true);
+
+    // Pin map test: pins are resolved from the base address and offset,
+    // unless explicitly mapped, including multi-digit port numbers
+    CHECK(libgpio_compute_pin_number(self, 4, GPIO_DIRECTION_IN) == 4);
+    CHECK(libgpio_compute_pin_number(self, 11, GPIO_DIRECTION_IN) == -1);
+    CHECK(libgpio_compute_pin_number(self, 6, GPIO_DIRECTION_OUT) == -1);
+    libgpio_add_gpi_mapping(self, 10, 42);
+    CHECK(libgpio_compute_pin_number(self, 10, GPIO_DIRECTION_IN) == 42);
+    libgpio_add_gpi_mapping(self, 11, 43);
+    CHECK(libgpio_compute_pin_number(self, 11, GPIO_DIRECTION_IN) == -1);
+    CHECK(libgpio_read(self, 11, GPIO_DIRECTION_IN) == -1);
+    CHECK(libgpio_write(self, 6, GPIO_STATE_CLOSED) == -1);
+
+    // Direction caching test: the direction is only written when it differs
+    // from the one already configured
+    {
+        uint64_t writes  = libgpio_get_direction_writes(self);
+        uint64_t avoided = libgpio_get_direction_writes_avoided(self);
+        CHECK(libgpio_write(self, 5, GPIO_STATE_CLOSED) == 0);
+        CHECK(libgpio_write(self, 5, GPIO_STATE_OPENED) == 0);
+        CHECK(libgpio_get_direction_writes(self) == writes + 1);
+        CHECK(libgpio_get_direction_writes_avoided(self) == avoided + 1);
+        // ... including when the pin is exported again
+        libgpio_set_persistent(self, false);
+        CHECK(libgpio_write(self, 5, GPIO_STATE_CLOSED) == 0);
+        CHECK(libgpio_get_direction_writes(self) == writes + 1);
+        CHECK(libgpio_get_direction_writes_avoided(self) == avoided + 2);
+        libgpio_set_persistent(self, true);
+    }
+
+    // Circuit breaker test: a failing pin is quarantined, and accesses fail
+    // immediately until it is retried
+    {
+        // The value can't be opened as a file
+        std::string value_fn = std::string(SELFTEST_DIR_RW) + "/sys/class/gpio/gpio7/value";
+        REQUIRE(zsys_dir_create(value_fn.c_str()) == 0);
+        libgpio_set_breaker(self, 2, 50, 1000);
+        CHECK(libgpio_read(self, 7, GPIO_DIRECTION_IN) == GPIO_STATE_UNKNOWN);
+        CHECK(libgpio_get_breaker_state(self, 7, GPIO_DIRECTION_IN) == GPIO_BREAKER_CLOSED);
+        CHECK(libgpio_read(self, 7, GPIO_DIRECTION_IN) == GPIO_STATE_UNKNOWN);
+        int64_t retry_in = 0;
+        CHECK(libgpio_get_breaker_state(self, 7, GPIO_DIRECTION_IN, &retry_in) == GPIO_BREAKER_OPEN);
+        CHECK(retry_in > 0);
+        CHECK(retry_in <= 50);
+        CHECK(libgpio_get_quarantined_count(self) == 1);
+        CHECK(libgpio_get_breaker_state(self, 42, GPIO_DIRECTION_IN) == -1);
+        // A failed retry doubles the quarantine
+        zclock_sleep(60);
+        CHECK(libgpio_read(self, 7, GPIO_DIRECTION_IN) == GPIO_STATE_UNKNOWN);
+        CHECK(libgpio_get_breaker_state(self, 7, GPIO_DIRECTION_IN, &retry_in) == GPIO_BREAKER_OPEN);
+        CHECK(retry_in > 50);
+        // ... and a successful one closes the breaker
+        zsys_dir_delete(value_fn.c_str());
+        FILE* value_file = fopen(value_fn.c_str(), "w");
+        REQUIRE(value_file);
+        fputs("1", value_file);
+        fclose(value_file);
+        zclock_sleep(110);
+        CHECK(libgpio_read(self, 7, GPIO_DIRECTION_IN) != GPIO_STATE_UNKNOWN);
+        CHECK(libgpio_get_breaker_state(self, 7, GPIO_DIRECTION_IN) == GPIO_BREAKER_CLOSED);
+        CHECK(libgpio_get_quarantined_count(self) == 0);
+    }
+
+    // Edge test: value changes are signaled on the opened value fd
+    CHECK(libgpio_get_value_fd(self, 2, GPIO_DIRECTION_IN) == -1);
+    CHECK(libgpio_get_edge(self, 2) == GPIO_EDGE_NONE);
+    CHECK(libgpio_set_edge(self, 2, GPIO_EDGE_BOTH) == 0);
+    CHECK(libgpio_get_edge(self, 2) == GPIO_EDGE_BOTH);
+    CHECK(libgpio_get_value_fd(self, 2, GPIO_DIRECTION_IN) >= 0);
+    {
+        char        edge_buf[5] = {0};
+        std::string edge_fn     = std::string(SELFTEST_DIR_RW) + "/sys/class/gpio/gpio2/edge";
+        int         edge_fd     = open(edge_fn.c_str(), O_RDONLY);
+        REQUIRE(edge_fd >= 0);
+        CHECK(read(edge_fd, edge_buf, 4) == 4);
+        close(edge_fd);
+        CHECK(streq(edge_buf, "both"));
+    }
+
+    // Snapshot test: read several GPx at once, at the same point in time
+    {
+        CHECK(libgpio_write(self, 1, GPIO_STATE_OPENED) == 0);
+        CHECK(libgpio_write(self, 3, GPIO_STATE_CLOSED) == 0);
+        libgpio_snapshot_t* snapshot = libgpio_snapshot_new(self);
+        REQUIRE(snapshot);
+        libgpio_snapshot_select(snapshot, 1, GPIO_DIRECTION_IN);
+        libgpio_snapshot_select(snapshot, 3, GPIO_DIRECTION_OUT);
+        CHECK(libgpio_read_all(self, snapshot) == 2);
+        CHECK(snapshot->timestamp > 0);
+        CHECK(libgpio_snapshot_get(snapshot, 1, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED);
+        CHECK(libgpio_snapshot_get(snapshot, 3, GPIO_DIRECTION_OUT) == GPIO_STATE_CLOSED);
+        // Not selected, or out of range
+        CHECK(libgpio_snapshot_get(snapshot, 2, GPIO_DIRECTION_IN) == GPIO_STATE_UNKNOWN);
+        CHECK(libgpio_snapshot_get(snapshot, 11, GPIO_DIRECTION_IN) == GPIO_STATE_UNKNOWN);
+        libgpio_snapshot_destroy(&snapshot);
+        CHECK(snapshot == NULL);
+    }
+
+    // Batched I/O test: the same values are written and read at once,
+    // through io_uring when available
+    {
+        libgpio_set_batched_io(self, true);
+        int gpo_numbers[4] = {1, 2, 3, 6};
+        int gpo_values[4]  = {GPIO_STATE_CLOSED, GPIO_STATE_OPENED, GPIO_STATE_OPENED, GPIO_STATE_OPENED};
+        int gpo_results[4];
+        CHECK(libgpio_write_many(self, gpo_numbers, gpo_values, 4, gpo_results) == 3);
+        CHECK(gpo_results[1] == 0);
+        CHECK(gpo_results[3] == -1);
+        uint64_t            batches  = libgpio_get_io_batches(self);
+        libgpio_snapshot_t* snapshot = libgpio_snapshot_new(self);
+        libgpio_snapshot_select(snapshot, 1, GPIO_DIRECTION_IN);
+        libgpio_snapshot_select(snapshot, 2, GPIO_DIRECTION_IN);
+        libgpio_snapshot_select(snapshot, 3, GPIO_DIRECTION_IN);
+        CHECK(libgpio_read_all(self, snapshot) == 3);
+        CHECK(libgpio_snapshot_get(snapshot, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED);
+        CHECK(libgpio_snapshot_get(snapshot, 2, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED);
+        CHECK(libgpio_snapshot_get(snapshot, 3, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED);
+        libgpio_snapshot_destroy(&snapshot);
+        // A single submission for the whole snapshot, unless io_uring is not
+        // available (then batched I/O gets disabled)
+        CHECK(((libgpio_get_io_batches(self) == batches + 1) || !self->batched_io));
+        libgpio_set_batched_io(self, false);
+    }
+
     // Value resolution test
     CHECK(libgpio_get_status_value("opened") == GPIO_STATE_OPENED);
     CHECK(libgpio_get_status_value("closed") == GPIO_STATE_CLOSED);
     CHECK(libgpio_get_status_value(libgpio_get_status_string(GPIO_STATE_CLOSED).c_str()) == GPIO_STATE_CLOSED);
 
+    // Release the pins before deleting their files
+    libgpio_close_sessions(self);
+
     // Delete all test files
     std::string sys_fn = std::string(SELFTEST_DIR_RW) + "/sys";
     zdir_t*     dir    = zdir_new(sys_fn.c_str(), NULL);
@@ -54,9 +240,163 @@ void libgpio_test()
     zdir_remove(dir, true);
     zdir_destroy(&dir);
 
+    // Simulated backend test, far beyond the IPC3000 capabilities
+    CHECK(libgpio_sim_set_value(self, 1, GPIO_DIRECTION_IN, GPIO_STATE_OPENED) == -1);
+    CHECK(libgpio_lookup_backend("sim") == &libgpio_sim_backend);
+    CHECK(libgpio_lookup_backend("sysfs") == &libgpio_sysfs_backend);
+    CHECK(libgpio_lookup_backend("foo") == NULL);
+    libgpio_set_backend(self, &libgpio_sim_backend);
+    libgpio_set_test_mode(self, false);
+    libgpio_set_gpi_count(self, 2000);
+    libgpio_set_gpo_count(self, 1000);
+    libgpio_set_gpi_offset(self, 0);
+    libgpio_set_gpo_offset(self, 2000);
+    {
+        int written = 0;
+        for (int gpo = 1; gpo <= 1000; gpo++)
+            written += (libgpio_write(self, gpo, (gpo % 2) ? GPIO_STATE_OPENED : GPIO_STATE_CLOSED) == 0) ? 1 : 0;
+        CHECK(written == 1000);
+        for (int gpi = 1; gpi <= 2000; gpi += 2)
+            libgpio_sim_set_value(self, gpi, GPIO_DIRECTION_IN, GPIO_STATE_OPENED);
+        libgpio_snapshot_t* snapshot = libgpio_snapshot_new(self);
+        libgpio_snapshot_select_all(snapshot);
+        CHECK(libgpio_read_all(self, snapshot) == 3000);
+        CHECK(libgpio_snapshot_get(snapshot, 1999, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED);
+        CHECK(libgpio_snapshot_get(snapshot, 2000, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED);
+        CHECK(libgpio_snapshot_get(snapshot, 999, GPIO_DIRECTION_OUT) == GPIO_STATE_OPENED);
+        CHECK(libgpio_snapshot_get(snapshot, 1000, GPIO_DIRECTION_OUT) == GPIO_STATE_CLOSED);
+        libgpio_snapshot_destroy(&snapshot);
+        // Nothing was written on the filesystem
+        CHECK(!zsys_file_exists((std::string(SELFTEST_DIR_RW) + "/sys").c_str()));
+        CHECK(!zsys_file_exists("/sys/class/gpio/gpio2999"));
+    }
+    {
+        // Waveforms
+        CHECK(libgpio_sim_set_waveform(self, 4, GPIO_DIRECTION_IN, "1:") == -1);
+        CHECK(libgpio_sim_set_waveform(self, 4, GPIO_DIRECTION_IN, "2:100") == -1);
+        CHECK(libgpio_sim_set_waveform(self, 4, GPIO_DIRECTION_IN, "1:100,0:100") == 0);
+        CHECK(libgpio_read(self, 4, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED);
+        zclock_sleep(110);
+        CHECK(libgpio_read(self, 4, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED);
+    }
+    {
+        // Edges, signaled on an eventfd
+        CHECK(libgpio_get_edge_events(self) == ZMQ_POLLIN);
+        CHECK(libgpio_set_edge(self, 6, GPIO_EDGE_BOTH) == 0);
+        struct pollfd item = {libgpio_get_value_fd(self, 6, GPIO_DIRECTION_IN), POLLIN, 0};
+        REQUIRE(item.fd >= 0);
+        CHECK(poll(&item, 1, 0) == 0);
+        CHECK(libgpio_sim_set_value(self, 6, GPIO_DIRECTION_IN, GPIO_STATE_OPENED) == 0);
+        CHECK(poll(&item, 1, 0) == 1);
+        CHECK(libgpio_read(self, 6, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED);
+        CHECK(poll(&item, 1, 0) == 0);
+        // ... including waveform transitions
+        CHECK(libgpio_sim_set_waveform(self, 6, GPIO_DIRECTION_IN, "1:30,0:30") == 0);
+        CHECK(libgpio_sim_step(self) == 0);
+        zclock_sleep(40);
+        CHECK(libgpio_sim_step(self) == 1);
+        CHECK(poll(&item, 1, 0) == 1);
+        CHECK(libgpio_read(self, 6, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED);
+        CHECK(libgpio_set_edge(self, 6, GPIO_EDGE_NONE) == 0);
+        CHECK(libgpio_get_value_fd(self, 6, GPIO_DIRECTION_IN) == -1);
+    }
+    {
+        // Injected latency
+        uint64_t accesses = libgpio_sim_get_accesses(self);
+        CHECK(libgpio_sim_set_latency(self, 2000) == 0);
+        int64_t start = zclock_usecs();
+        CHECK(libgpio_read(self, 8, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED);
+        CHECK(zclock_usecs() - start >= 2000);
+        CHECK(libgpio_sim_get_accesses(self) > accesses);
+        CHECK(libgpio_sim_set_latency(self, 0) == 0);
+    }
+
+    // Character device backend test, on a mocked GPIO chip
+    CHECK(libgpio_cdev_set_ioctl(self, s_mock_ioctl) == -1);
+    CHECK(libgpio_lookup_backend("cdev") == &libgpio_cdev_backend);
+    libgpio_set_backend(self, &libgpio_cdev_backend);
+    CHECK(libgpio_cdev_set_chip(self, "/dev/null") == 0);
+    CHECK(libgpio_cdev_set_ioctl(self, s_mock_ioctl) == 0);
+    libgpio_set_gpi_count(self, 40);
+    libgpio_set_gpo_count(self, 20);
+    libgpio_set_gpo_offset(self, 41);
+    {
+        // A whole snapshot is read with a single ioctl, once lines are requested
+        s_mock_lines                 = 0x5;
+        libgpio_snapshot_t* snapshot = libgpio_snapshot_new(self);
+        libgpio_snapshot_select_all(snapshot);
+        CHECK(libgpio_read_all(self, snapshot) == 60);
+        uint64_t ioctls = libgpio_cdev_get_ioctls(self);
+        CHECK(libgpio_read_all(self, snapshot) == 60);
+        CHECK(libgpio_cdev_get_ioctls(self) == ioctls + 1);
+        CHECK(libgpio_snapshot_get(snapshot, 1, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED);
+        CHECK(libgpio_snapshot_get(snapshot, 2, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED);
+        CHECK(libgpio_snapshot_get(snapshot, 3, GPIO_DIRECTION_IN) == GPIO_STATE_CLOSED);
+        libgpio_snapshot_destroy(&snapshot);
+        // ... and as many GPOs written with a single ioctl
+        int gpo_numbers[3] = {1, 2, 21};
+        int gpo_values[3]  = {GPIO_STATE_OPENED, GPIO_STATE_OPENED, GPIO_STATE_OPENED};
+        int gpo_results[3];
+        ioctls = libgpio_cdev_get_ioctls(self);
+        CHECK(libgpio_write_many(self, gpo_numbers, gpo_values, 3, gpo_results) == 2);
+        CHECK(libgpio_cdev_get_ioctls(self) == ioctls + 1);
+        CHECK(gpo_results[0] == 0);
+        CHECK(gpo_results[2] == -1);
+        CHECK(s_mock_lines == ((1ULL << 42) | (1ULL << 43) | 0x5));
+        CHECK(libgpio_read(self, 2, GPIO_DIRECTION_OUT) == GPIO_STATE_OPENED);
+    }
+    {
+        // Edges, signaled on their own line request, with kernel timestamps
+        CHECK(libgpio_get_edge_events(self) == ZMQ_POLLIN);
+        CHECK(libgpio_set_edge(self, 3, GPIO_EDGE_BOTH) == 0);
+        struct pollfd item = {libgpio_get_value_fd(self, 3, GPIO_DIRECTION_IN), POLLIN, 0};
+        REQUIRE(item.fd >= 0);
+        CHECK(poll(&item, 1, 0) == 0);
+        gpio_v2_line_event event;
+        memset(&event, 0, sizeof(event));
+        event.timestamp_ns = 1600000000123456789ULL;
+        event.id           = GPIO_V2_LINE_EVENT_RISING_EDGE;
+        event.offset       = 3;
+        s_mock_lines |= 1ULL << 3;
+        CHECK(write(s_mock_requests[item.fd].second, &event, sizeof(event)) == sizeof(event));
+        CHECK(poll(&item, 1, 0) == 1);
+        CHECK(libgpio_read(self, 3, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED);
+        CHECK(poll(&item, 1, 0) == 0);
+        CHECK(libgpio_get_edge_timestamp(self, 3) == 1600000000123456789LL);
+        // The other lines are still read (and outputs kept) at once
+        CHECK(libgpio_read(self, 2, GPIO_DIRECTION_IN) == GPIO_STATE_OPENED);
+        CHECK(libgpio_read(self, 2, GPIO_DIRECTION_OUT) == GPIO_STATE_OPENED);
+        CHECK(libgpio_set_edge(self, 3, GPIO_EDGE_NONE) == 0);
+        CHECK(libgpio_get_value_fd(self, 3, GPIO_DIRECTION_IN) == -1);
+    }
+
     libgpio_destroy(&self);
+    for (auto& mock_request : s_mock_requests)
+        close(mock_request.second.second);
+    s_mock_requests.clear();
 }
 
+// Request the server statistics (GPIO_STATS), by name
+static std::map<std::string, uint64_t> s_gpio_stats(mlm_client_t* client)
+{
+    zmsg_t* msg = zmsg_new();
+    zmsg_addstr(msg, "uuid");
+    REQUIRE(mlm_client_sendto(client, FTY_SENSOR_GPIO_AGENT, "GPIO_STATS", nullptr, 5000, &msg) == 0);
+    zmsg_t* recv = mlm_client_recv(client);
+    REQUIRE(recv);
+
+    std::map<std::string, uint64_t> stats;
+    char*                           name = zmsg_popstr(recv);
+    while (name) {
+        char* value = zmsg_popstr(recv);
+        stats[name] = (value) ? strtoull(value, nullptr, 10) : 0;
+        zstr_free(&name);
+        zstr_free(&value);
+        name = zmsg_popstr(recv);
+    }
+    zmsg_destroy(&recv);
+    return stats;
+}
 
 TEST_CASE("sensor gpio server test")
 {
@@ -208,6 +548,20 @@ TEST_CASE("sensor gpio server test")
         zmsg_destroy(&recv);
         zmsg_destroy(&msg);
 
+        // Unchanged statuses are not published again, until half their TTL
+        zstr_sendx(self, "UPDATE", endpoint, nullptr);
+        zpoller_t* poller = zpoller_new(mlm_client_msgpipe(metrics_listener), nullptr);
+        CHECK(zpoller_wait(poller, 1000) == nullptr);
+        zpoller_destroy(&poller);
+
+        std::map<std::string, uint64_t> stats = s_gpio_stats(mb_client);
+        CHECK(stats["metrics_published"] == 2);
+        CHECK(stats["metrics_suppressed"] == 2);
+        // The sensors are only locked to be copied, and merged back after
+        // the I/O and publications
+        CHECK(stats["lock_holds"] == 4);
+        CHECK(stats["lock_hold_max_us"] < 100000);
+
         mlm_client_destroy(&metrics_listener);
     }
 
@@ -393,7 +747,392 @@ TEST_CASE("sensor gpio server test")
         CHECK(readbuf[0] == '1'); // 1 == GPIO_STATE_OPENED
     }
 
-    // Test #7: Disable all GPI/GPO (as on OVA),
+    // Test #7: Add 2 GPI sensors powered by the same GPO (4), and check that
+    // it is activated once, and that both are only read once warmed up
+    {
+        std::string gpo4_sys_dir = str_SELFTEST_DIR_RW + "/sys/class/gpio/gpio502";
+        zsys_dir_create(gpo4_sys_dir.c_str());
+        for (const char* gpi : {"493", "494"}) {
+            std::string gpi_powered_sys_dir = str_SELFTEST_DIR_RW + "/sys/class/gpio/gpio" + gpi;
+            zsys_dir_create(gpi_powered_sys_dir.c_str());
+            handle = open((gpi_powered_sys_dir + "/value").c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0777);
+            REQUIRE(handle >= 0);
+            rc = int(write(handle, "1", 1)); // 1 == GPIO_STATE_OPENED
+            REQUIRE(rc == 1);
+            close(handle);
+        }
+        rv = add_sensor(assets_self, "create", "Eaton", "sensorgpio-14", "GPIO-Sensor-Leak1", "WLD012",
+            "water-leak-detector", "opened", "6", "GPI", "IPC1", "Room1", "4", "Water leak detected", "WARNING",
+            "300");
+        REQUIRE(rv == 0);
+        rv = add_sensor(assets_self, "create", "Eaton", "sensorgpio-15", "GPIO-Sensor-Leak2", "WLD012",
+            "water-leak-detector", "opened", "7", "GPI", "IPC1", "Room1", "4", "Water leak detected", "WARNING",
+            "200");
+        REQUIRE(rv == 0);
+
+        mlm_client_t* metrics_listener = mlm_client_new();
+        mlm_client_connect(metrics_listener, endpoint, 1000, "fty_sensor_gpio_powered_listener");
+        mlm_client_set_consumer(metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "status.GPI.*");
+        zclock_sleep(500);
+
+        // The update doesn't wait for the sensors warm-up
+        int64_t start = zclock_mono();
+        zstr_sendx(self, "UPDATE", endpoint, nullptr);
+        int powered_metrics = 0;
+        while (powered_metrics < 2) {
+            zmsg_t* recv = mlm_client_recv(metrics_listener);
+            REQUIRE(recv);
+            fty_proto_t* frecv = fty_proto_decode(&recv);
+            REQUIRE(frecv);
+            if (streq(fty_proto_type(frecv), "status.GPI6") || streq(fty_proto_type(frecv), "status.GPI7")) {
+                CHECK(zclock_mono() - start >= 200);
+                CHECK(streq(fty_proto_value(frecv), "opened"));
+                powered_metrics++;
+            }
+            fty_proto_destroy(&frecv);
+        }
+
+        // The GPO power source was activated once, and is left alone afterward
+        zstr_sendx(self, "UPDATE", endpoint, nullptr);
+        std::map<std::string, uint64_t> stats = s_gpio_stats(mb_client);
+        CHECK(stats["power_activations"] == 1);
+        CHECK(stats["sensors_deferred"] >= 2);
+
+        handle = open((gpo4_sys_dir + "/value").c_str(), O_RDONLY, 0);
+        REQUIRE(handle >= 0);
+        char readbuf[2];
+        rc = int(read(handle, &readbuf[0], 1));
+        REQUIRE(rc == 1);
+        close(handle);
+        CHECK(readbuf[0] == '1'); // 1 == GPIO_STATE_OPENED
+
+        mlm_client_destroy(&metrics_listener);
+    }
+
+    // Test #8: Add a GPI sensor polled every 100 ms, and check that a change
+    // is published without waiting for the next update
+    {
+        std::string gpi8_sys_dir = str_SELFTEST_DIR_RW + "/sys/class/gpio/gpio495";
+        zsys_dir_create(gpi8_sys_dir.c_str());
+        std::string gpi8_fn = gpi8_sys_dir + "/value";
+        handle              = open(gpi8_fn.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0777);
+        REQUIRE(handle >= 0);
+        rc = int(write(handle, "0", 1)); // 0 == GPIO_STATE_CLOSED
+        REQUIRE(rc == 1);
+        close(handle);
+        rv = add_sensor(assets_self, "create", "Eaton", "sensorgpio-16", "GPIO-Sensor-Door2", "DCS001",
+            "door-contact-sensor", "closed", "8", "GPI", "IPC1", "Rack1", "", "Door has been $status", "WARNING", "",
+            "100");
+        REQUIRE(rv == 0);
+
+        mlm_client_t* metrics_listener = mlm_client_new();
+        mlm_client_connect(metrics_listener, endpoint, 1000, "fty_sensor_gpio_polled_listener");
+        mlm_client_set_consumer(metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "status.GPI8.*");
+        zclock_sleep(500);
+
+        // The update schedules the sensor at its own poll interval
+        zstr_sendx(self, "UPDATE", endpoint, nullptr);
+        zmsg_t* recv = mlm_client_recv(metrics_listener);
+        REQUIRE(recv);
+        fty_proto_t* frecv = fty_proto_decode(&recv);
+        REQUIRE(frecv);
+        CHECK(streq(fty_proto_value(frecv), "closed"));
+        fty_proto_destroy(&frecv);
+
+        handle = open(gpi8_fn.c_str(), O_WRONLY | O_TRUNC, 0777);
+        REQUIRE(handle >= 0);
+        rc = int(write(handle, "1", 1)); // 1 == GPIO_STATE_OPENED
+        REQUIRE(rc == 1);
+        close(handle);
+
+        zpoller_t* poller = zpoller_new(mlm_client_msgpipe(metrics_listener), nullptr);
+        CHECK(zpoller_wait(poller, 1000) != nullptr);
+        zpoller_destroy(&poller);
+        recv = mlm_client_recv(metrics_listener);
+        REQUIRE(recv);
+        frecv = fty_proto_decode(&recv);
+        REQUIRE(frecv);
+        CHECK(streq(fty_proto_value(frecv), "opened"));
+        fty_proto_destroy(&frecv);
+
+        mlm_client_destroy(&metrics_listener);
+    }
+
+    // Test #9: Enable adaptive polling, check that a stable GPI backs off
+    // to the maximum poll interval, and is polled fast again once it changed
+    {
+        mlm_client_t* metrics_listener = mlm_client_new();
+        mlm_client_connect(metrics_listener, endpoint, 1000, "fty_sensor_gpio_adaptive_listener");
+        mlm_client_set_consumer(metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "status.GPI1.*");
+        zclock_sleep(500);
+
+        // Fast rate of 50 ms for 300 ms after a change, backing off up to 400 ms
+        zstr_sendx(self, "ADAPTIVE_POLLING", "true", "50", "300", "400", nullptr);
+        zstr_sendx(self, "UPDATE", endpoint, nullptr);
+        zclock_sleep(1500);
+
+        std::map<std::string, uint64_t> stats = s_gpio_stats(mb_client);
+        CHECK(stats["poll_rate/sensorgpio-10"] == 400);
+        CHECK(stats["poll_speedups/sensorgpio-10"] == 0);
+        CHECK(stats["poll_backoffs/sensorgpio-10"] == 3);
+
+        handle = open(gpi1_fn.c_str(), O_WRONLY | O_TRUNC, 0777);
+        REQUIRE(handle >= 0);
+        rc = int(write(handle, "1", 1)); // 1 == GPIO_STATE_OPENED
+        REQUIRE(rc == 1);
+        close(handle);
+
+        zpoller_t* poller = zpoller_new(mlm_client_msgpipe(metrics_listener), nullptr);
+        CHECK(zpoller_wait(poller, 1000) != nullptr);
+        zpoller_destroy(&poller);
+        zmsg_t* recv = mlm_client_recv(metrics_listener);
+        REQUIRE(recv);
+        fty_proto_t* frecv = fty_proto_decode(&recv);
+        REQUIRE(frecv);
+        CHECK(streq(fty_proto_value(frecv), "opened"));
+        fty_proto_destroy(&frecv);
+
+        stats = s_gpio_stats(mb_client);
+        CHECK(stats["poll_rate/sensorgpio-10"] == 50);
+        CHECK(stats["poll_speedups/sensorgpio-10"] == 1);
+
+        zstr_sendx(self, "ADAPTIVE_POLLING", "false", nullptr);
+        mlm_client_destroy(&metrics_listener);
+    }
+
+    // Test #10: Let the server run its own check cycles every 100 ms, and
+    // check that they are all accounted in the cycle durations histogram
+    {
+        zstr_sendx(self, "CHECK_INTERVAL", "100", nullptr);
+        zclock_sleep(1050);
+        zstr_sendx(self, "CHECK_INTERVAL", "0", nullptr);
+
+        std::map<std::string, uint64_t> stats     = s_gpio_stats(mb_client);
+        uint64_t                        histogram = 0;
+        for (const auto& stat : stats) {
+            if (stat.first.compare(0, 15, "cycle_duration/") == 0)
+                histogram += stat.second;
+        }
+        // Cycles started by UPDATE are accounted too, and the scheduled ones
+        // were either run or skipped
+        CHECK(stats["cycles"] >= 10);
+        CHECK(histogram == stats["cycles"]);
+        CHECK(stats["cycles_skipped"] <= 10);
+    }
+
+    // Test #11: Publish the statuses both one by one and in batches, and
+    // check that the batches hold the same metrics
+    {
+        mlm_client_t* single_listener = mlm_client_new();
+        mlm_client_connect(single_listener, endpoint, 1000, "fty_sensor_gpio_single_listener");
+        mlm_client_set_consumer(single_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "status\\..*");
+        mlm_client_t* batch_listener = mlm_client_new();
+        mlm_client_connect(batch_listener, endpoint, 1000, "fty_sensor_gpio_batch_listener");
+        mlm_client_set_consumer(batch_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "status-batch");
+        zclock_sleep(500);
+
+        // Unchanged statuses are refreshed after 1 s, i.e. all of them
+        zstr_sendx(self, "PUBLISH_MODE", "both", nullptr);
+        zstr_sendx(self, "METRIC_TTL", "2", nullptr);
+        zclock_sleep(1100);
+        zstr_sendx(self, "UPDATE", endpoint, nullptr);
+
+        std::map<std::string, int> singles, batched;
+        size_t                     batches = 0;
+        zpoller_t*                 poller =
+            zpoller_new(mlm_client_msgpipe(single_listener), mlm_client_msgpipe(batch_listener), nullptr);
+        void* which = zpoller_wait(poller, 1000);
+        while (which) {
+            if (which == mlm_client_msgpipe(single_listener)) {
+                zmsg_t*      recv  = mlm_client_recv(single_listener);
+                fty_proto_t* frecv = fty_proto_decode(&recv);
+                REQUIRE(frecv);
+                singles[fty_proto_type(frecv)]++;
+                fty_proto_destroy(&frecv);
+            } else {
+                zmsg_t* recv = mlm_client_recv(batch_listener);
+                REQUIRE(recv);
+                CHECK(streq(mlm_client_subject(batch_listener), "status-batch"));
+                batches++;
+                // Each frame is an encoded metric
+                zframe_t* frame = zmsg_pop(recv);
+                while (frame) {
+                    zmsg_t* metric = zmsg_new();
+                    zmsg_append(metric, &frame);
+                    fty_proto_t* frecv = fty_proto_decode(&metric);
+                    REQUIRE(frecv);
+                    CHECK(streq(fty_proto_name(frecv), "IPC1"));
+                    batched[fty_proto_type(frecv)]++;
+                    fty_proto_destroy(&frecv);
+                    frame = zmsg_pop(recv);
+                }
+                zmsg_destroy(&recv);
+            }
+            which = zpoller_wait(poller, 500);
+        }
+        zpoller_destroy(&poller);
+        CHECK(batches >= 1);
+        CHECK(singles.size() >= 2);
+        CHECK(batched == singles);
+
+        zstr_sendx(self, "METRIC_TTL", "300", nullptr);
+        zstr_sendx(self, "PUBLISH_MODE", "single", nullptr);
+        mlm_client_destroy(&batch_listener);
+        mlm_client_destroy(&single_listener);
+    }
+
+    // Test #12: Also write the statuses in fty_shm, and check that they
+    // expire with their TTL once no longer refreshed
+    {
+        std::string shm_dir = str_SELFTEST_DIR_RW + "/shm";
+        zsys_dir_create(shm_dir.c_str());
+        REQUIRE(fty_shm_set_test_dir(shm_dir.c_str()) == 0);
+
+        zstr_sendx(self, "PUBLISH_MODE", "single,shm", nullptr);
+        zstr_sendx(self, "METRIC_TTL", "2", nullptr);
+        zclock_sleep(1100);
+        zstr_sendx(self, "UPDATE", endpoint, nullptr);
+        zclock_sleep(500);
+
+        char* value = nullptr;
+        char* unit  = nullptr;
+        REQUIRE(fty_shm_read_metric("IPC1", "status.GPI1", &value, &unit) == 0);
+        CHECK(streq(value, "opened"));
+        zstr_free(&value);
+        zstr_free(&unit);
+
+        std::map<std::string, uint64_t> stats = s_gpio_stats(mb_client);
+        CHECK(stats["shm_writes"] >= 2);
+        CHECK(stats["shm_failures"] == 0);
+
+        // Without updates, the status expires after its 2 s TTL
+        zstr_sendx(self, "PUBLISH_MODE", "single", nullptr);
+        zstr_sendx(self, "METRIC_TTL", "300", nullptr);
+        zclock_sleep(2500);
+        CHECK(fty_shm_read_metric("IPC1", "status.GPI1", &value, &unit) != 0);
+        zstr_free(&value);
+        zstr_free(&unit);
+        fty_shm_delete_test_dir();
+    }
+
+    // Test #13: Sample the GPIs from the sampler thread, and check that a
+    // change is published without any check cycle
+    {
+        mlm_client_t* metrics_listener = mlm_client_new();
+        mlm_client_connect(metrics_listener, endpoint, 1000, "fty_sensor_gpio_sampler_listener");
+        mlm_client_set_consumer(metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "status.GPI1.*");
+        zclock_sleep(500);
+
+        // The check cycle hands the monitored GPIs over to the sampler
+        zstr_sendx(self, "SAMPLER", "20", nullptr);
+        zstr_sendx(self, "UPDATE", endpoint, nullptr);
+        zclock_sleep(300);
+
+        handle = open(gpi1_fn.c_str(), O_WRONLY | O_TRUNC, 0777);
+        REQUIRE(handle >= 0);
+        rc = int(write(handle, "0", 1)); // 0 == GPIO_STATE_CLOSED
+        REQUIRE(rc == 1);
+        close(handle);
+
+        zpoller_t* poller = zpoller_new(mlm_client_msgpipe(metrics_listener), nullptr);
+        CHECK(zpoller_wait(poller, 1000) != nullptr);
+        zpoller_destroy(&poller);
+        zmsg_t* recv = mlm_client_recv(metrics_listener);
+        REQUIRE(recv);
+        fty_proto_t* frecv = fty_proto_decode(&recv);
+        REQUIRE(frecv);
+        CHECK(streq(fty_proto_value(frecv), "closed"));
+        fty_proto_destroy(&frecv);
+
+        std::map<std::string, uint64_t> stats = s_gpio_stats(mb_client);
+        CHECK(stats["sampler_changes"] >= 1);
+        CHECK(stats["sampler_drops"] == 0);
+        CHECK(stats["samples_published"] >= 1);
+        CHECK(stats["samples_published"] <= stats["sampler_changes"]);
+
+        zstr_sendx(self, "SAMPLER", "0", nullptr);
+        mlm_client_destroy(&metrics_listener);
+    }
+
+    // Test #14: Read the GPIs with batched I/O, and check that their changes
+    // are published, whether io_uring is available or not
+    {
+        mlm_client_t* metrics_listener = mlm_client_new();
+        mlm_client_connect(metrics_listener, endpoint, 1000, "fty_sensor_gpio_batched_listener");
+        mlm_client_set_consumer(metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "status.GPI1.*");
+        zclock_sleep(500);
+
+        zstr_sendx(self, "BATCHED_IO", "true", nullptr);
+        zpoller_t* poller = zpoller_new(mlm_client_msgpipe(metrics_listener), nullptr);
+        for (const char* value : {"1", "0"}) {
+            handle = open(gpi1_fn.c_str(), O_WRONLY | O_TRUNC, 0777);
+            REQUIRE(handle >= 0);
+            rc = int(write(handle, value, 1));
+            REQUIRE(rc == 1);
+            close(handle);
+            zstr_sendx(self, "UPDATE", endpoint, nullptr);
+
+            CHECK(zpoller_wait(poller, 1000) != nullptr);
+            zmsg_t* recv = mlm_client_recv(metrics_listener);
+            REQUIRE(recv);
+            fty_proto_t* frecv = fty_proto_decode(&recv);
+            REQUIRE(frecv);
+            CHECK(streq(fty_proto_value(frecv), streq(value, "1") ? "opened" : "closed"));
+            fty_proto_destroy(&frecv);
+        }
+        zpoller_destroy(&poller);
+
+        zstr_sendx(self, "BATCHED_IO", "false", nullptr);
+        mlm_client_destroy(&metrics_listener);
+    }
+
+    // Test #15: Switch to the simulated backend with edge interrupts, and
+    // check that an edge is published without any check cycle, also once
+    // the GPI session was closed and reopened
+    {
+        mlm_client_t* metrics_listener = mlm_client_new();
+        mlm_client_connect(metrics_listener, endpoint, 1000, "fty_sensor_gpio_edge_listener");
+        mlm_client_set_consumer(metrics_listener, FTY_PROTO_STREAM_METRICS_SENSOR, "status.GPI1.*");
+        zclock_sleep(500);
+
+        // The check cycle arms the monitored GPIs, still closed
+        zstr_sendx(self, "BACKEND", "sim", "10", "5", nullptr);
+        zstr_sendx(self, "EDGE_TRIGGERED", "true", nullptr);
+        zstr_sendx(self, "UPDATE", endpoint, nullptr);
+        zclock_sleep(300);
+
+        zstr_sendx(self, "SIM_VALUE", "1", "GPI", "opened", nullptr);
+        zpoller_t* poller = zpoller_new(mlm_client_msgpipe(metrics_listener), nullptr);
+        CHECK(zpoller_wait(poller, 1000) != nullptr);
+        zmsg_t* recv = mlm_client_recv(metrics_listener);
+        REQUIRE(recv);
+        fty_proto_t* frecv = fty_proto_decode(&recv);
+        REQUIRE(frecv);
+        CHECK(streq(fty_proto_value(frecv), "opened"));
+        fty_proto_destroy(&frecv);
+
+        // Closing the pin sessions closes the polled value fd: the GPI is
+        // armed again on its new session
+        zstr_sendx(self, "PERSISTENT_PINS", "false", nullptr);
+        zstr_sendx(self, "PERSISTENT_PINS", "true", nullptr);
+        zclock_sleep(300);
+
+        zstr_sendx(self, "SIM_VALUE", "1", "GPI", "closed", nullptr);
+        CHECK(zpoller_wait(poller, 1000) != nullptr);
+        zpoller_destroy(&poller);
+        recv = mlm_client_recv(metrics_listener);
+        REQUIRE(recv);
+        frecv = fty_proto_decode(&recv);
+        REQUIRE(frecv);
+        CHECK(streq(fty_proto_value(frecv), "closed"));
+        fty_proto_destroy(&frecv);
+
+        zstr_sendx(self, "EDGE_TRIGGERED", "false", nullptr);
+        zstr_sendx(self, "BACKEND", "sysfs", nullptr);
+        mlm_client_destroy(&metrics_listener);
+    }
+
+    // Test #16: Disable all GPI/GPO (as on OVA),
     // Create a sensor and verify that it fails
     {
         // Forge the HW_CAP messages
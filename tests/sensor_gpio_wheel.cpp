@@ -0,0 +1,108 @@
+/*  ========================================================================
+    Copyright (C) 2021 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "src/fty_sensor_gpio_wheel.h"
+#include <catch2/catch.hpp>
+#include <map>
+#include <string>
+
+static void s_free_key(void** item)
+{
+    char* key = static_cast<char*>(*item);
+    zstr_free(&key);
+    *item = nullptr;
+}
+
+TEST_CASE("sensor gpio wheel test")
+{
+    //  @selftest
+    fty_sensor_gpio_wheel_t* wheel = fty_sensor_gpio_wheel_new(10);
+    REQUIRE(wheel);
+    zlistx_t* expired = zlistx_new();
+    zlistx_set_destructor(expired, s_free_key);
+    int64_t now = zclock_mono();
+
+    // Timers expire at their deadline, rounded up to the tick
+    {
+        CHECK(fty_sensor_gpio_wheel_next_deadline(wheel) == -1);
+        fty_sensor_gpio_wheel_schedule(wheel, "leak", now + 100);
+        fty_sensor_gpio_wheel_schedule(wheel, "door", now + 2000);
+        fty_sensor_gpio_wheel_schedule(wheel, "vibration", now + 3600000);
+        CHECK(fty_sensor_gpio_wheel_size(wheel) == 3);
+        CHECK(fty_sensor_gpio_wheel_deadline(wheel, "door") >= now + 2000);
+        CHECK(fty_sensor_gpio_wheel_deadline(wheel, "door") < now + 2010);
+        CHECK(fty_sensor_gpio_wheel_deadline(wheel, "smoke") == -1);
+        CHECK(fty_sensor_gpio_wheel_next_deadline(wheel) == fty_sensor_gpio_wheel_deadline(wheel, "leak"));
+
+        CHECK(fty_sensor_gpio_wheel_expire(wheel, now + 99, expired) == 0);
+        CHECK(fty_sensor_gpio_wheel_expire(wheel, now + 110, expired) == 1);
+        CHECK(streq(static_cast<char*>(zlistx_first(expired)), "leak"));
+        zlistx_purge(expired);
+        CHECK(fty_sensor_gpio_wheel_next_deadline(wheel) == fty_sensor_gpio_wheel_deadline(wheel, "door"));
+
+        // Reschedule, then cancel
+        fty_sensor_gpio_wheel_schedule(wheel, "door", now + 500);
+        CHECK(fty_sensor_gpio_wheel_size(wheel) == 2);
+        CHECK(fty_sensor_gpio_wheel_expire(wheel, now + 510, expired) == 1);
+        CHECK(streq(static_cast<char*>(zlistx_first(expired)), "door"));
+        zlistx_purge(expired);
+        CHECK(fty_sensor_gpio_wheel_cancel(wheel, "vibration") == 0);
+        CHECK(fty_sensor_gpio_wheel_cancel(wheel, "vibration") == -1);
+        CHECK(fty_sensor_gpio_wheel_size(wheel) == 0);
+        CHECK(fty_sensor_gpio_wheel_expire(wheel, now + 3600010, expired) == 0);
+    }
+
+    // Timers spread over all the levels (and beyond) expire in order, never
+    // early and at most one tick late
+    {
+        std::map<std::string, int64_t> deadlines;
+        now                = now + 3600010;
+        int64_t  deadline  = now;
+        uint32_t seed      = 42;
+        for (int i = 0; i < 2000; i++) {
+            seed = seed * 1103515245 + 12345;
+            deadline += (i % 100 == 0) ? int64_t(seed % 100000000) : int64_t(seed % 5000);
+            std::string key = "sensor-" + std::to_string(i);
+            deadlines[key]  = deadline;
+            fty_sensor_gpio_wheel_schedule(wheel, key.c_str(), deadline);
+        }
+        CHECK(fty_sensor_gpio_wheel_size(wheel) == 2000);
+
+        size_t count = 0;
+        while (fty_sensor_gpio_wheel_size(wheel) > 0) {
+            int64_t next = fty_sensor_gpio_wheel_next_deadline(wheel);
+            REQUIRE(next >= now);
+            CHECK(fty_sensor_gpio_wheel_expire(wheel, next - 1, expired) == 0);
+            size_t expired_count = fty_sensor_gpio_wheel_expire(wheel, next, expired);
+            REQUIRE(expired_count > 0);
+            char* key = static_cast<char*>(zlistx_first(expired));
+            while (key) {
+                int64_t expected = deadlines[key];
+                CHECK(expected <= next);
+                CHECK(expected > next - 10);
+                key = static_cast<char*>(zlistx_next(expired));
+            }
+            count += expired_count;
+            zlistx_purge(expired);
+            now = next;
+        }
+        CHECK(count == 2000);
+    }
+
+    zlistx_destroy(&expired);
+    fty_sensor_gpio_wheel_destroy(&wheel);
+    CHECK(wheel == nullptr);
+    //  @end
+}